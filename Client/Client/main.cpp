@@ -1,10 +1,47 @@
-﻿#include <iostream>
+﻿#ifdef CHECKERS_TESTS
+#undef NDEBUG // the self-tests are built on assert, also in Release
+#endif
+#include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <cstdlib>
+#include <cstdio>
 #include <cassert>
-#include <windows.h> // for sleep
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#ifdef _WIN32
+#define NOMINMAX          // keep std::min and std::max usable
+#include <windows.h> // for the console and file mapping functions
+#include <io.h>       // for _open, _commit
+#else
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close, isatty
+#include <termios.h>  // for the serial port settings
+#include <poll.h>     // for poll
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h> // for the SSE2 path of poscodec::expand
+#define CHECKERS_SSE2
+#endif
+#include "protocol.h" // framing shared with the firmware
 
 
 /**
@@ -150,6 +187,193 @@ namespace sq {
 }
 using namespace sq;
 
+/**
+ * @namespace prng
+ * @brief Namespace for the small seedable random number generator used by the AI.
+ */
+namespace prng {
+
+	/**
+	 * @struct Rng
+	 * @brief xoshiro128** generator with 128 bits of state.
+	 *
+	 * Unlike rand(), every generator carries its own state, so a game
+	 * started from the same seed replays the same AI moves bit-for-bit,
+	 * and games played on different threads do not disturb each other.
+	 */
+	struct Rng {
+		/**
+		 * @brief Constructor that seeds the generator.
+		 * @param seed_: Seed of the generator.
+		 */
+		explicit Rng(std::uint64_t seed_ = 1) { seed(seed_); }
+
+		/**
+		 * @brief Resets the generator state from a 64-bit seed (expanded with splitmix64).
+		 * @param seed_: Seed of the generator.
+		 */
+		void seed(std::uint64_t seed_);
+
+		/**
+		 * @brief Generates the next 32-bit random number.
+		 * @return Uniformly distributed 32-bit number.
+		 */
+		std::uint32_t next();
+
+		/**
+		 * @brief Generates an unbiased random number below a bound.
+		 * @param bound: Upper bound (exclusive), must be greater than 0.
+		 * @return Uniformly distributed number in [0, bound).
+		 */
+		std::uint32_t below(std::uint32_t bound);
+
+		/**
+		 * @brief Gets how many numbers were drawn since the generator was seeded.
+		 * @return Number of calls to next(), also those made by below().
+		 */
+		std::uint64_t draws() const { return drawn; }
+
+		/**
+		 * @brief Draws and drops numbers, to pick up a saved game's stream where it was.
+		 * @param count: Number of numbers to skip.
+		 */
+		void skip(std::uint64_t count);
+
+	private:
+		std::uint32_t s[4];        ///< Generator state.
+		std::uint64_t drawn = 0;   ///< Numbers drawn since the last seed().
+	};
+
+	/**
+	 * @brief Makes a fresh seed for a new game from the system entropy source.
+	 * @return A 64-bit seed.
+	 */
+	std::uint64_t newSeed();
+	void Rng_Test();
+}
+
+/**
+ * @namespace board
+ * @brief Namespace for the compact (bit mask) form of a position and of moves.
+ *
+ * Bit i of every mask stands for squares[i], so bit 0 is a1 and bit 31 is h8.
+ */
+namespace board {
+
+	/**
+	 * @struct Position
+	 * @brief A board position as three 32-bit masks.
+	 */
+	struct Position {
+		std::uint32_t red = 0;   ///< Squares holding a red piece (crowned or not).
+		std::uint32_t black = 0; ///< Squares holding a black piece (crowned or not).
+		std::uint32_t kings = 0; ///< Squares holding a crowned piece of either color.
+	};
+
+	/**
+	 * @struct Hop
+	 * @brief One step or one jump of a piece, as vector addresses of its squares.
+	 *
+	 * A move with consecutive captures is stored as several hops by the same side.
+	 */
+	struct Hop {
+		std::uint8_t from; ///< Vector address of the square the piece leaves.
+		std::uint8_t to;   ///< Vector address of the square the piece lands on.
+	};
+
+	/**
+	 * @brief Gets the name of the square at a vector address.
+	 * @param index: Vector address (0 to 31).
+	 * @return The name of the square (e.g., "a1", "h8").
+	 */
+	std::string squareName(int index);
+
+	/**
+	 * @brief Gets the vector address of a square from its name.
+	 * @param name: Name of the square.
+	 * @return The vector address, or -1 if the name is not an accessible square.
+	 */
+	int squareIndex(const std::string& name);
+
+	/**
+	 * @brief Builds the mask form of a board.
+	 * @param sqVect: The vector of Square objects representing the game board.
+	 * @return The position as bit masks.
+	 */
+	Position toPosition(const std::vector<Square>& sqVect);
+
+	/**
+	 * @brief Sets up a board from the mask form of a position.
+	 *
+	 * Squares that already have the right name are only recolored, so the
+	 * string-based Square constructor runs at most once per square.
+	 *
+	 * @param pos: The position as bit masks.
+	 * @param sqVect: Pointer to the vector of Square objects to set up.
+	 */
+	void fromPosition(const Position& pos, std::vector<Square>* sqVect);
+	void Position_Test();
+
+	/**
+	 * @brief Gets the position at the start of a game.
+	 * @return The position with 12 pieces on each side.
+	 */
+	Position startPosition();
+
+	/**
+	 * @brief Gets the square a number of rows and columns away from a square.
+	 * @param index: Vector address of the square.
+	 * @param dRow: Rows to go up (positive) or down (negative).
+	 * @param dCol: Columns to go right (positive) or left (negative).
+	 * @return The vector address of that square, or -1 if it is off the board.
+	 */
+	int neighbor(int index, int dRow, int dCol);
+
+	/**
+	 * @brief Checks if a hop jumps over a square (a capture).
+	 * @param hop: The hop.
+	 * @return True if the hop moves two rows, false otherwise.
+	 */
+	bool isJump(const Hop& hop);
+
+	/**
+	 * @brief Plays a hop on a position: moves the piece, removes a jumped piece and promotes.
+	 *
+	 * The hop is not checked for legality.
+	 *
+	 * @param pos: The position to change.
+	 * @param hop: The hop to play.
+	 */
+	void applyHop(Position* pos, const Hop& hop);
+	void applyHop_Test();
+
+	/**
+	 * @brief Gets the vector address of the lowest set bit of a mask.
+	 * @param mask: A non-zero mask.
+	 * @return The address of the lowest set bit.
+	 */
+	int lowestBit(std::uint32_t mask);
+
+	/**
+	 * @brief Counts the set bits of a mask.
+	 * @param mask: A mask of squares.
+	 * @return The number of squares in the mask.
+	 */
+	int countBits(std::uint32_t mask);
+
+	/**
+	 * @brief Computes the Zobrist hash of a position.
+	 *
+	 * The keys come from a fixed seed, so hashes are the same in every run
+	 * and can be stored in files.
+	 *
+	 * @param pos: The position.
+	 * @param turn: Side to move ('r' or 'b').
+	 * @return The 64-bit hash.
+	 */
+	std::uint64_t hash(const Position& pos, char turn);
+}
+
 /**
  * @namespace checkers
  * @brief defines global variables for Checkers game
@@ -255,6 +479,38 @@ namespace checkers {
 	 */
 	extern int inBetween;
 
+	/**
+	 * @var extern std::uint64_t gameSeed
+	 * @brief Seed the current game's random number generator was started with.
+	 *
+	 * It is stored in saved games so an AI game can be replayed exactly.
+	 */
+	extern std::uint64_t gameSeed;
+
+	/**
+	 * @var extern thread_local prng::Rng generator
+	 * @brief Random number generator of the game played on this thread.
+	 */
+	extern thread_local prng::Rng generator;
+
+	/**
+	 * @var extern std::vector<board::Hop> history
+	 * @brief Every hop played in the current game, in order.
+	 */
+	extern std::vector<board::Hop> history;
+
+	/**
+	 * @var extern board::Position startPosition
+	 * @brief Position the hops in 'history' were played from.
+	 */
+	extern board::Position startPosition;
+
+	/**
+	 * @var extern char startTurn
+	 * @brief Side to move in 'startPosition'.
+	 */
+	extern char startTurn;
+
 }
 using namespace checkers;
 
@@ -434,884 +690,5601 @@ namespace constants {
 };
 using namespace constants;
 
-void abcd();
-void Run_All_Tests();
-
 /**
- * @brief Displays the game board.
- * @param sqVect: The vector of Square objects representing the game board.
+ * @namespace match
+ * @brief Namespace for engine-vs-engine matches with Elo and SPRT bookkeeping.
  */
-void displayBoard(const std::vector<Square>& sqVect);
+namespace match {
 
-/**
- * @brief Prepares the game for play.
- *
- * This function initializes the game by setting up the checkers board
- * and other necessary variables.
- */
-void prepareGame();
+	/**
+	 * @struct EngineConfig
+	 * @brief Describes one AI configuration taking part in a match.
+	 */
+	struct EngineConfig {
+		std::string name; ///< Name printed in match reports.
+		bool preferCaptures; ///< If true, the AI plays a capture whenever one is available.
+	};
 
-/**
- * @brief Saves the game state to a file.
- *
- * @param squares: Pointer to the vector of Square objects representing the game board.
- * @param turn_: The current turn ('r' for Red, 'b' for Black).
- * @param selector_: The game mode selected by the user.
- * @return True if the game was successfully saved, false otherwise.
- */
-bool saveGame(std::vector<Square>* squares, char turn_, int selector_);
+	/**
+	 * @struct Score
+	 * @brief Results of a match from the point of view of the first engine.
+	 */
+	struct Score {
+		int wins = 0;   ///< Games won by the first engine.
+		int draws = 0;  ///< Drawn games (including games stopped by the ply limit).
+		int losses = 0; ///< Games lost by the first engine.
+	};
 
-/**
- * @brief Loads the game state from a file.
- *
- * This function loads the game state from a file and updates the provided
- * vector of squares, turn, and selector variables accordingly.
- *
- * @param squares: Pointer to the vector of squares representing the game board.
- * @param turn_: Pointer to the variable representing the current player's turn.
- * @param selector_: Pointer to the variable representing the game mode selected.
- * @return True if the game state was successfully loaded, false otherwise.
- */
-bool loadGame(std::vector<Square>* squares, char* turn_, int* selector_);
+	/**
+	 * @struct Settings
+	 * @brief Parameters of a match and of its sequential probability ratio test.
+	 */
+	struct Settings {
+		double elo0 = 0.0;     ///< Elo gain of the null hypothesis H0.
+		double elo1 = 50.0;    ///< Elo gain of the alternative hypothesis H1.
+		double alpha = 0.05;   ///< Probability of accepting H1 when H0 is true.
+		double beta = 0.05;    ///< Probability of accepting H0 when H1 is true.
+		int openings = 100;    ///< Number of opening positions (each is played twice).
+		int openingPlies = 4;  ///< Random plies played from the start position to make an opening.
+		int maxPlies = 200;    ///< Game is adjudicated a draw after this many plies.
+		std::uint64_t seed = 1; ///< Base seed; opening o and its games derive their seeds from it.
+	};
 
-/**
- * @brief Checks if a given string represents a valid square on the checkers board.
- * @param square: The string representing the square.
- * @return True if the string is a valid square, false otherwise.
- */
-bool isSquare(std::string square);
-void isSquare_Test();
+	/** @brief Engine that moves at random, as AI_Turn() always did. */
+	extern const EngineConfig randomEngine;
 
-/**
- * @brief Reverses the crown status of a given color.
- * @param color: The color character ('r' or 'b').
- * @return The crowned version of the color ('R' or 'B') if uncrowned, or the uncrowned version ('r' or 'b') if crowned.
- */
-char reverseCrown(char color);
-void reverseCrown_Test();
+	/** @brief Engine that plays a capture whenever one is available. */
+	extern const EngineConfig greedyEngine;
 
-/**
- * @brief Checks if the current player cannot make any valid moves.
- * @return True if the current player cannot make any moves, false otherwise.
- */
-bool cannotMakeMove();
+	/**
+	 * @brief Converts an expected score (0..1) to an Elo difference.
+	 * @param score: Expected score of the first engine.
+	 * @return Elo difference corresponding to the score.
+	 */
+	double eloFromScore(double score);
 
-/**
- * @brief Checks if a movement from the initial square to the target square is possible.
- * @param: initSq: Pointer to the initial square.
- * @return True if the movement is possible, false otherwise.
- */
-bool possibleMovement(Square* initSq);
-void possibleMovement_Test();
+	/**
+	 * @brief Converts an Elo difference to an expected score (0..1).
+	 * @param elo: Elo difference.
+	 * @return Expected score of the stronger side.
+	 */
+	double scoreFromElo(double elo);
 
-/**
- * @brief Gets the user's input for the square.
- *
- * This function gets the user's input for the square to select.
- * If the input is invalid, the function calls itself recursively.
- * Otherwise, the function returns.
- */
-void getSquare();
+	/**
+	 * @brief Estimates the Elo difference of a match with a 95% error bar.
+	 * @param s: Current match score.
+	 * @param elo: Receives the estimated Elo difference.
+	 * @param margin: Receives the half-width of the 95% confidence interval.
+	 */
+	void eloEstimate(const Score& s, double* elo, double* margin);
+	void eloEstimate_Test();
 
-/**
- * @brief Checks if a given string represents a valid square on the checkers board.
- * @param sq: The string representing the square.
- * @return True if the string is a valid square, false otherwise.
- */
-bool goodSquare(std::string sq);
-void goodSquare_Test();
+	/**
+	 * @brief Computes the log-likelihood ratio of H1 (elo1) against H0 (elo0).
+	 *
+	 * Uses the generalized SPRT approximation with a trinomial (win/draw/loss)
+	 * model, so draws narrow the variance instead of being ignored.
+	 *
+	 * @param s: Current match score.
+	 * @param elo0: Elo gain of H0.
+	 * @param elo1: Elo gain of H1.
+	 * @return The log-likelihood ratio; 0 while there is not enough data.
+	 */
+	double sprtLLR(const Score& s, double elo0, double elo1);
+	void sprtLLR_Test();
 
-/**
- * @brief Gets the user's input for the target square.
- *
- * This function gets the user's input for the target square.
- * If the input is invalid, the function calls itself recursively.
- * Otherwise, the function returns.
- */
-void getTarget();
+	/**
+	 * @brief Plays one quiet AI-vs-AI game from the given position.
+	 * @param red: Engine playing the red pieces.
+	 * @param black: Engine playing the black pieces.
+	 * @param opening: Position to start from.
+	 * @param openingTurn: Side to move in the opening position.
+	 * @param maxPlies: Ply limit after which the game is a draw.
+	 * @param seed: Seed of the game's random number generator.
+	 * @return The loser ('r', 'b' or 'x' for a draw).
+	 */
+	char playGame(const EngineConfig& red, const EngineConfig& black,
+		const std::vector<Square>& opening, char openingTurn, int maxPlies, std::uint64_t seed);
 
-/**
- * @brief Checks if a given string represents a valid target square on the checkers board.
- * @param sq: The string representing the target square.
- * @return True if the string is a valid target square, false otherwise.
- */
-bool goodTarget(std::string sq);
-void goodTarget_Test();
+	/**
+	 * @brief Plays paired games with swapped colors until the SPRT is decided.
+	 * @param first: Engine whose Elo gain is tested.
+	 * @param second: Baseline engine.
+	 * @param settings: Match and SPRT parameters.
+	 * @return The final score of the first engine.
+	 */
+	Score runMatch(const EngineConfig& first, const EngineConfig& second, const Settings& settings);
+}
 
 /**
- * @brief Checks if the initial square is one square away from the target square in the forward direction.
- * @return True if the initial square is one square away from the target square in the forward direction, false otherwise.
+ * @namespace save
+ * @brief Namespace for reading and writing saved games (INI and binary formats).
  */
-bool oneFrSqAway();
-void oneFrSqAway_Test();
+namespace save {
 
-/**
- * @brief Checks if the initial square is one square away from the target square in the backward direction.
- * @return True if the initial square is one square away from the target square in the backward direction, false otherwise.
- */
-bool oneBcSqAway();
-void oneBcSqAway_Test();
+	/**
+	 * @struct GameState
+	 * @brief Everything a saved game holds, independent of the file format.
+	 */
+	struct GameState {
+		board::Position position;       ///< Pieces on the board.
+		char turn = Red;                ///< Side to move ('r' or 'b').
+		int selector = 1;               ///< Game mode selected by the user.
+		std::uint64_t seed = 1;         ///< Seed of the game's random number generator.
+		std::uint64_t draws = 0;        ///< Numbers drawn from it so far, so a resumed game goes on with the same stream.
+		std::vector<board::Hop> history; ///< Hops played so far.
+	};
 
-/**
- * @brief Checks if the initial square is two squares away from the target square in the forward direction.
- * @return True if the initial square is two squares away from the target square in the forward direction, false otherwise.
- */
-bool twoFrSqAway();
-void twoFrSqAway_Test();
+	/** @brief Magic number at the start of a binary save ("CKSV" in file order). */
+	extern const std::uint32_t binaryMagic;
 
-/**
- * @brief Checks if the initial square is two squares away from the target square in the backward direction.
- * @return True if the initial square is two squares away from the target square in the backward direction, false otherwise.
- */
-bool twoBcSqAway();
-void twoBcSqAway_Test();
+	/** @brief Version of the binary save layout. */
+	extern const std::uint8_t binaryVersion;
 
-/**
- * @brief Gets the index of the square in the 'squares' vector based on its name.
- * @param sq: The name of the square.
- * @return The index of the square in the 'squares' vector.
- */
-int getAddress(std::string sq);
-void getAddress_Test();
+	/**
+	 * @brief Collects the current game into a GameState.
+	 * @param sqVect: The vector of Square objects representing the game board.
+	 * @param turn_: The current turn.
+	 * @param selector_: The game mode selected by the user.
+	 * @return The game state.
+	 */
+	GameState capture(const std::vector<Square>& sqVect, char turn_, int selector_);
 
-/**
- * @brief Gets the letter coordinate of a square.
- * @param sq1: The name of the square.
- * @return The letter coordinate of the square.
- */
-char getLetCoordinate(std::string sq1);
-void getLetCoordinate_Test();
+	/**
+	 * @brief Makes a GameState the current game, with its random number stream where it was.
+	 * @param state: The game state to restore.
+	 * @param sqVect: Pointer to the vector of squares representing the game board.
+	 * @param turn_: Pointer to the variable representing the current player's turn.
+	 * @param selector_: Pointer to the variable representing the game mode selected.
+	 */
+	void restore(const GameState& state, std::vector<Square>* sqVect, char* turn_, int* selector_);
 
-/**
- * @brief Gets the name of the square between the initial square and the target square.
- * @param initSq: Pointer to the initial square.
- * @param targetSq: Pointer to the target square.
- * @return The name of the square between the initial square and the target square.
- */
-std::string getSqInBetween(Square* initSq, Square* targetSq);
-void getSqInBetween_Test();
+	/**
+	 * @brief Writes a game in the INI format.
+	 * @param out: Stream to write to.
+	 * @param state: The game state to write.
+	 */
+	void writeIni(std::ostream& out, const GameState& state);
 
-/**
- * @brief Gets the direction of capture between the initial square and the target square.
- * @param initSq: Pointer to the initial square.
- * @param targetSq: Pointer to the target square.
- * @return The direction of capture ('R' for right, 'L' for left).
- */
-char getCapDirection(std::string* initSq, std::string* targetSq);
-void getCapDirection_Test();
+	/**
+	 * @brief Reads a game in the INI format.
+	 * @param in: Stream to read from (read to the end into one buffer).
+	 * @param state: Receives the game state.
+	 * @param error: If not null, receives a message with the line number of the first error.
+	 * @return True if the game was read, false if the file is malformed.
+	 */
+	bool readIni(std::istream& in, GameState* state, std::string* error = nullptr);
 
-/**
- * @brief Gets the parity (oddness or evenness) of a row.
- * @param row: The row number.
- * @return The parity of the row ('O' for odd, 'E' for even).
- */
-char getRowParity(char row);
-void getRowParity_Test();
+	/**
+	 * @brief Parses a game in the INI format from a buffer in a single pass.
+	 *
+	 * Keys and values are string_views into the buffer, so no line is copied.
+	 * Keys may come in any order inside a section, blank lines and comments
+	 * (';' or '#') are skipped, and unknown sections and keys are ignored.
+	 * Squares are placed by their Square= name, and Turn=, Selector=, Seed=
+	 * and Draws= are checked and returned in the game state.
+	 *
+	 * @param text: The whole file contents.
+	 * @param state: Receives the game state (left unchanged on error).
+	 * @param error: If not null, receives a message with the line number of the first error.
+	 * @return True if the game was parsed, false if the text is malformed.
+	 */
+	bool parseIni(std::string_view text, GameState* state, std::string* error = nullptr);
+	void parseIni_Test();
 
-/**
- * @brief Checks if the capture is going upward (from our view) for a crowned piece.
- * @param initSq: Pointer to the initial square.
- * @param targetSq: Pointer to the target square.
- * @return True if the capture is going upward, false otherwise.
- */
-bool upCapture(Square* initSq, Square* targetSq);
-void upCapture_Test();
+	/**
+	 * @brief Writes a game in the binary format.
+	 *
+	 * Layout (little-endian): magic (4), version (1), turn (1), selector (1),
+	 * reserved (1), red/black/kings masks (3 x 4), seed (8), draws (8),
+	 * hop count (2), hops (2 each: from in bits 0-4, to in bits 5-9), CRC-32 of
+	 * all previous bytes (4). Version 1 had no draws.
+	 *
+	 * @param state: The game state to write.
+	 * @return The encoded bytes (42 bytes plus 2 per hop).
+	 */
+	std::vector<std::uint8_t> encodeBinary(const GameState& state);
 
-/**
- * @brief Checks if the capture is going downward for a crowned piece.
- * @param initSq: Pointer to the initial square.
- * @param targetSq: Pointer to the target square.
- * @return True if the capture is going downward, false otherwise.
- */
-bool downCapture(Square* initSq, Square* targetSq);
-void downCapture_Test();
+	/**
+	 * @brief Reads a game in the binary format.
+	 * @param data: Pointer to the encoded bytes.
+	 * @param size: Number of encoded bytes.
+	 * @param state: Receives the game state (no draws from a version 1 save).
+	 * @return True if the data is a valid binary save, false otherwise.
+	 */
+	bool decodeBinary(const std::uint8_t* data, std::size_t size, GameState* state);
+	void binarySave_Test();
 
-/**
- * @brief Checks if the first capture condition for red pieces is met.
- * @return True if the first capture condition is met, false otherwise.
- */
-bool R_Capture1();
-void R_Capture1_Test();
+	/**
+	 * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+	 * @param data: Pointer to the bytes.
+	 * @param size: Number of bytes.
+	 * @return The CRC-32 value.
+	 */
+	std::uint32_t crc32(const std::uint8_t* data, std::size_t size);
+}
 
 /**
- * @brief Checks if the second capture condition for red pieces is met.
- * @return True if the second capture condition is met, false otherwise.
+ * @namespace pdn
+ * @brief Namespace for reading and writing games in Portable Draughts Notation.
+ *
+ * Squares are numbered 1 to 32 as in English checkers, with the side that
+ * moves first (red here, "Black" in PDN) on squares 1 to 12: g1 is 1,
+ * a1 is 4, h2 is 5 and h8 is 29. Results are written from the point of
+ * view of the side that moves first ("1-0" means red won).
  */
-bool R_Capture2();
-void R_Capture2_Test();
+namespace pdn {
 
-/**
- * @brief Checks if the third capture condition for red pieces is met.
- * @return True if the third capture condition is met, false otherwise.
- */
-bool R_Capture3();
-void R_Capture3_Test();
+	/**
+	 * @struct Game
+	 * @brief One game of a PDN archive.
+	 */
+	struct Game {
+		std::vector<std::pair<std::string, std::string>> tags; ///< Tag pairs in file order.
+		board::Position start;          ///< Position the game starts from (from [FEN] if present).
+		char startTurn = Red;           ///< Side to move in the start position.
+		std::vector<board::Hop> hops;   ///< Hops of the game; a capture chain is several hops.
+		std::string result = "*";       ///< "1-0", "0-1", "1/2-1/2" or "*".
+	};
 
-/**
- * @brief Checks if the fourth capture condition for red pieces is met.
- * @return True if the fourth capture condition is met, false otherwise.
- */
-bool R_Capture4();
-void R_Capture4_Test();
+	/**
+	 * @brief Gets the PDN number (1-32) of a square.
+	 * @param index: Vector address of the square.
+	 * @return The PDN square number.
+	 */
+	int squareNumber(int index);
 
-/**
- * @brief Checks if the first capture condition for black pieces is met.
- * @return True if the first capture condition is met, false otherwise.
- */
-bool B_Capture1();
-void B_Capture1_Test();
+	/**
+	 * @brief Gets the vector address of a PDN square number.
+	 * @param number: PDN square number (1-32).
+	 * @return The vector address of the square, or -1 if the number is out of range.
+	 */
+	int squareFromNumber(int number);
 
-/**
- * @brief Checks if the second capture condition for black pieces is met.
- * @return True if the second capture condition is met, false otherwise.
- */
-bool B_Capture2();
-void B_Capture2_Test();
+	/**
+	 * @brief Writes a game with its tags, movetext and result.
+	 *
+	 * Consecutive captures by the same piece are joined into one move ("10x17x26").
+	 * A [FEN] tag is added when the game does not start from the start position.
+	 *
+	 * @param out: Stream to write to.
+	 * @param game: The game to write.
+	 */
+	void writeGame(std::ostream& out, const Game& game);
 
-/**
- * @brief Checks if the third capture condition for black pieces is met.
- * @return True if the third capture condition is met, false otherwise.
- */
-bool B_Capture3();
-void B_Capture3_Test();
+	/**
+	 * @brief Makes a PDN game out of the current game.
+	 * @return The current game with tags for the mode and the result.
+	 */
+	Game currentGame();
 
-/**
- * @brief Checks if the fourth capture condition for black pieces is met.
- * @return True if the fourth capture condition is met, false otherwise.
- */
-bool B_Capture4();
-void B_Capture4_Test();
+	/**
+	 * @class Reader
+	 * @brief Streaming PDN parser that reads an archive one game at a time.
+	 *
+	 * The input is read through a fixed 64 KiB buffer and each game reuses
+	 * the caller's Game object, so memory stays constant however large the
+	 * archive is. Comments, variations and NAGs are skipped. Capture moves
+	 * may list every landing square or only the first and the last.
+	 */
+	class Reader {
+	public:
+		/** @brief Result of reading the next game. */
+		enum class Status { Game, Error, End };
 
-/**
- * @brief Gets the opposite color of a given color.
- * @param color: The color character ('r' or 'b').
- * @return The opposite color character ('b' or 'r').
- */
-char oppoColor(char color);
-void oppoColor_Test();
+		/**
+		 * @brief Constructor for Reader.
+		 * @param in_: Stream to read the archive from.
+		 */
+		explicit Reader(std::istream& in_);
 
-/**
- * @brief Checks if a capture is occurring.
- * @return True if a capture is occurring, false otherwise.
- */
-bool isCapture();
-void isCapture_Test();
+		/**
+		 * @brief Reads the next game.
+		 * @param game: Receives the game (cleared first).
+		 * @param error: Receives a message with the game and line number on Status::Error.
+		 * @return Status::Game, Status::Error (the bad game is skipped) or Status::End.
+		 */
+		Status next(Game* game, std::string* error);
 
-/**
- * @brief Updates the checkers board after a move.
- */
-void updateBoard();
+		/**
+		 * @brief Gets the number of hops read so far, over all games.
+		 * @return The number of hops.
+		 */
+		long long hopCount() const { return hops; }
 
-/**
- * @brief Checks if a promotion (to a crowned piece) is occurring.
- * @return True if a promotion is occurring, false otherwise.
- */
-bool isPromotion();
-void isPromotion_Test();
+	private:
+		int get();
+		int peek();
+		bool readMove(const std::string& token, Game* game);
+		bool readFen(const std::string& fen, Game* game);
+
+		std::istream& in;             ///< Archive being read.
+		std::vector<char> buffer;     ///< Fixed read buffer.
+		std::size_t pos = 0;          ///< Next unread byte in the buffer.
+		std::size_t filled = 0;       ///< Bytes of the buffer holding data.
+		long line = 1;                ///< Current line, for error messages.
+		long games = 0;               ///< Games started so far, for error messages.
+		long long hops = 0;           ///< Hops read so far.
+		board::Position position;     ///< Position of the game being read.
+		char side = Red;              ///< Side to move in 'position'.
+	};
+	void pdn_Test();
 
-/**
- * @brief Checks if a capture is possible from the initial square.
- * @param initSq: Pointer to the initial square.
- * @return True if a capture is possible, false otherwise.
- */
-bool possibleCapture(Square* initSq);
-void possibleCapture_Test();
+	/**
+	 * @brief Exports the current game, appending it to a PDN archive chosen by the user.
+	 * @return True if the game was written, false otherwise.
+	 */
+	bool exportGame();
+}
 
 /**
- * @brief Gets the user's input for the target square in consecutive captures.
+ * @namespace gamedb
+ * @brief Namespace for the position-indexed game database.
+ *
+ * A database file is written once by a Builder and read through a memory
+ * mapping by Database, so several tools can share it without loading it.
+ * All records have fixed sizes and natural alignment and are stored in
+ * little-endian order:
+ *  - Header
+ *  - GameRecord for every game
+ *  - packed hops of all games (2 bytes each, as in binary saves)
+ *  - PositionRecord for every distinct position, sorted by hash
+ *  - Occurrence for every time a position was reached, grouped by position
  */
-void getConsecutiveJmpTarget();
+namespace gamedb {
 
-/**
- * @brief Checks if a given string represents a valid target square in consecutive captures.
- * @param sq: The string representing the target square.
- * @return True if the string is a valid target square, false otherwise.
- */
-bool goodConsecutiveJmpTarget(std::string sq);
-void goodConsecutiveJmpTarget_Test();
+	/** @brief Game result codes stored in GameRecord::result. */
+	enum Result : std::uint8_t { Unknown = 0, RedWin = 1, Draw = 2, BlackWin = 3 };
+
+	/**
+	 * @struct Header
+	 * @brief First 72 bytes of a database file.
+	 */
+	struct Header {
+		char magic[4];                   ///< "CKDB".
+		std::uint32_t version;           ///< Layout version.
+		std::uint32_t games;             ///< Number of GameRecords.
+		std::uint32_t reserved;          ///< Always 0.
+		std::uint64_t hops;              ///< Number of packed hops.
+		std::uint64_t positions;         ///< Number of PositionRecords.
+		std::uint64_t occurrences;       ///< Number of Occurrences.
+		std::uint64_t gamesOffset;       ///< File offset of the games.
+		std::uint64_t hopsOffset;        ///< File offset of the hops.
+		std::uint64_t positionsOffset;   ///< File offset of the positions.
+		std::uint64_t occurrencesOffset; ///< File offset of the occurrences.
+	};
+
+	/**
+	 * @struct GameRecord
+	 * @brief One game of the database.
+	 */
+	struct GameRecord {
+		std::uint32_t red;      ///< Red pieces of the start position.
+		std::uint32_t black;    ///< Black pieces of the start position.
+		std::uint32_t kings;    ///< Crowned pieces of the start position.
+		std::uint32_t firstHop; ///< Index of the game's first hop in the hops section.
+		std::uint16_t hopCount; ///< Number of hops of the game.
+		char startTurn;         ///< Side to move in the start position.
+		std::uint8_t result;    ///< One of Result.
+	};
+
+	/**
+	 * @struct PositionRecord
+	 * @brief A distinct position with how often it occurred and how it scored.
+	 */
+	struct PositionRecord {
+		std::uint64_t hash;            ///< Zobrist hash of the position and side to move.
+		std::uint32_t firstOccurrence; ///< Index of the first Occurrence of the position.
+		std::uint32_t occurrences;     ///< Number of times the position was reached.
+		std::uint32_t redWins;         ///< Occurrences in games red won.
+		std::uint32_t draws;           ///< Occurrences in drawn games.
+		std::uint32_t blackWins;       ///< Occurrences in games black won.
+		std::uint32_t reserved;        ///< Always 0.
+	};
+
+	/**
+	 * @struct Occurrence
+	 * @brief A game and the hop before which a position was on the board.
+	 */
+	struct Occurrence {
+		std::uint32_t game;     ///< Index of the game.
+		std::uint16_t hop;      ///< Number of hops of the game played before the position.
+		std::uint16_t reserved; ///< Always 0.
+	};
+
+	/**
+	 * @class Builder
+	 * @brief Collects games and writes a database file.
+	 */
+	class Builder {
+	public:
+		/**
+		 * @brief Adds a game; every position between two moves is indexed.
+		 * @param start: Position the game starts from.
+		 * @param startTurn: Side to move in the start position.
+		 * @param hops: Hops of the game.
+		 * @param result: One of Result.
+		 */
+		void addGame(const board::Position& start, char startTurn, const std::vector<board::Hop>& hops, std::uint8_t result);
+
+		/**
+		 * @brief Adds every game of a PDN archive (.pdn) or a saved game (.ini or .ckb).
+		 * @param path: Name of the file.
+		 * @param error: Receives a message if the file cannot be read.
+		 * @return The number of games added, or -1 on error.
+		 */
+		long addFile(const std::string& path, std::string* error);
+
+		/**
+		 * @brief Writes the database.
+		 * @param out: Binary stream to write to.
+		 */
+		void write(std::ostream& out);
+
+		/** @brief Gets the number of games added so far. */
+		std::size_t gameCount() const { return games.size(); }
+
+	private:
+		struct Entry { std::uint64_t hash; Occurrence occurrence; };
+		std::vector<GameRecord> games;     ///< Games added so far.
+		std::vector<std::uint16_t> hops;   ///< Packed hops of all games.
+		std::vector<Entry> entries;        ///< Every indexed position of every game.
+	};
+
+	/**
+	 * @class Database
+	 * @brief Read-only, memory-mapped view of a database file.
+	 */
+	class Database {
+	public:
+		Database() = default;
+		Database(const Database&) = delete;
+		Database& operator=(const Database&) = delete;
+		~Database() { close(); }
+
+		/**
+		 * @brief Maps a database file into memory.
+		 * @param path: Name of the file.
+		 * @param error: Receives a message if the file is not a valid database.
+		 * @return True if the database is ready to be queried.
+		 */
+		bool open(const std::string& path, std::string* error);
+
+		/**
+		 * @brief Uses a database that is already in memory (not owned).
+		 * @param data_: Pointer to the database bytes (8-byte aligned).
+		 * @param size_: Number of bytes.
+		 * @param error: Receives a message if the data is not a valid database.
+		 * @return True if the database is ready to be queried.
+		 */
+		bool attach(const void* data_, std::size_t size_, std::string* error);
+
+		/** @brief Unmaps the file. */
+		void close();
+
+		/**
+		 * @brief Looks up a position by hash (binary search over the sorted positions).
+		 * @param hash: Zobrist hash of the position.
+		 * @return The position's record, or null if it never occurred.
+		 */
+		const PositionRecord* find(std::uint64_t hash) const;
+
+		/**
+		 * @brief Gets the occurrences of a position.
+		 * @param record: A record returned by find().
+		 * @return Pointer to record.occurrences consecutive Occurrences.
+		 */
+		const Occurrence* occurrences(const PositionRecord& record) const;
+
+		/** @brief Gets the header of the database. */
+		const Header& header() const { return *head; }
+
+		/** @brief Gets a game of the database. */
+		const GameRecord& game(std::uint32_t index) const { return games[index]; }
+
+	private:
+		const std::uint8_t* data = nullptr;         ///< Start of the database bytes.
+		std::size_t size = 0;                       ///< Number of bytes.
+		bool mapped = false;                        ///< Whether close() has to unmap 'data'.
+		const Header* head = nullptr;               ///< Header at the start of the data.
+		const GameRecord* games = nullptr;          ///< Games section.
+		const PositionRecord* positions = nullptr;  ///< Positions section.
+		const Occurrence* occurrenceList = nullptr; ///< Occurrences section.
+	};
+	void gamedb_Test();
+}
 
 /**
- * @brief Displays the help information.
+ * @namespace journal
+ * @brief Namespace for the append-only move journal that lets a game survive a crash.
+ *
+ * While a game is played every hop is appended to a journal file as soon as
+ * it is applied, so a killed or crashed program loses at most the turn that
+ * was in progress. Layout (little-endian):
+ *  - magic "CKJN" (4), length of the embedded save (4)
+ *  - the game at the time the journal was opened, as a binary save
+ *  - records of 2 bytes: a packed hop (from in bits 0-4, to in bits 5-9),
+ *    the numbers the turn drew from the game's generator (drawsRecord plus
+ *    up to maxDraws, before its end), or endOfTurn once the side to move changes
+ *
+ * Each record is handed to the operating system with one write, which
+ * already survives the process being killed; the file is flushed to disk
+ * (fsync) every syncInterval records and when the journal is closed.
  */
-void displayHelp();
+namespace journal {
+
+	/** @brief Record that ends a turn. */
+	extern const std::uint16_t endOfTurn;
+
+	/** @brief Flag of a record that counts random numbers drawn (in its low 15 bits). */
+	extern const std::uint16_t drawsRecord;
+
+	/** @brief Most draws one record counts; more take several records. */
+	extern const std::uint16_t maxDraws;
+
+	/** @brief Number of records written between two flushes to disk. */
+	extern const int syncInterval;
+
+	/**
+	 * @class Writer
+	 * @brief Appends the moves of one game to a journal file.
+	 */
+	class Writer {
+	public:
+		Writer() = default;
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+		~Writer() { close(); }
+
+		/**
+		 * @brief Creates (or replaces) a journal file starting from a game.
+		 * @param path: The file name.
+		 * @param start: The game so far.
+		 * @return True if the journal was created.
+		 */
+		bool open(const std::string& path, const save::GameState& start);
+
+		/** @brief Appends a hop that has just been applied. */
+		void append(const board::Hop& hop);
+
+		/**
+		 * @brief Marks the end of the turn (ignored if no hop was appended since the last one).
+		 * @param draws: Numbers drawn from the game's generator so far (prng::Rng::draws()).
+		 */
+		void endTurn(std::uint64_t draws);
+
+		/** @brief Flushes the appended records to disk. */
+		void sync();
+
+		/** @brief Flushes and closes the journal. */
+		void close();
+
+		/** @brief Closes the journal and deletes its file (the game is over). */
+		void discard();
+
+		/** @brief Checks if a journal is open. */
+		bool isOpen() const { return fd >= 0; }
+
+	private:
+		void put(std::uint16_t record);
+
+		int fd = -1;              ///< File descriptor of the journal.
+		std::string file;         ///< Name of the journal file.
+		int unsynced = 0;         ///< Records written since the last flush.
+		bool turnPending = false; ///< Whether a hop was appended since the last endOfTurn.
+		std::uint64_t drawn = 0;  ///< Draws the journal accounts for so far.
+	};
+
+	/** @brief Journal of the game being played. */
+	extern Writer active;
+
+	/**
+	 * @brief Gets the journal file name of a game.
+	 * @param seed: The seed of the game.
+	 * @return The file name.
+	 */
+	std::string pathFor(std::uint64_t seed);
+
+	/**
+	 * @brief Replays a journal up to its last complete turn.
+	 *
+	 * A torn record or a hop that does not fit the position (the tail of a
+	 * crashed write) ends the replay, as does the end of the data.
+	 *
+	 * @param data: Pointer to the journal bytes.
+	 * @param size: Number of bytes.
+	 * @param state: Receives the game as it was after the last complete turn,
+	 * with the draws of the complete turns.
+	 * @return True if the data is a journal, false otherwise.
+	 */
+	bool replay(const std::uint8_t* data, std::size_t size, save::GameState* state);
+	void journal_Test();
+}
 
 /**
- * @brief Displays the main menu.
+ * @namespace movecodec
+ * @brief Namespace for storing games as indices into the list of legal hops.
+ *
+ * A game is replayed with the move generator, and each hop is written as its
+ * index in the list of hops the side to move could have made, so a hop takes
+ * a few bits instead of a square name. After a jump the same piece may jump
+ * again or stop, so the list is then "end of turn" followed by its jumps;
+ * when it cannot jump again the turn ends without a symbol. Jumps are listed
+ * before steps, which keeps the indices of likely hops small.
+ *
+ * Encoded game: hop count (LEB128), then the indices, each written highest
+ * bit first and packed from the lowest bit of each byte.
  */
-void displayMenu();
+namespace movecodec {
+
+	/** @brief How indices are written. */
+	enum class Coding : std::uint8_t {
+		Fixed, ///< Truncated binary: about log2(number of choices) bits.
+		Ranked ///< Elias gamma: 1 bit for the first choice, 3 for the next two, ...
+	};
+
+	/** @brief Most pieces a side can have. */
+	const int maxPieces = 12;
+
+	/** @brief Largest number of hops one side can have (12 kings with 4 directions each). */
+	const int maxHops = 48;
+
+	/**
+	 * @brief Checks a position before its hops are listed: no square held by both sides,
+	 * kings only on pieces, at most maxPieces a side and 'r' or 'b' to move.
+	 * @param pos: The position.
+	 * @param turn: Side to move.
+	 * @return True if the position is valid, false otherwise.
+	 */
+	bool isValid(const board::Position& pos, char turn);
+
+	/**
+	 * @brief Lists the legal hops of a side, jumps first.
+	 * @param pos: The position, valid by isValid() for the list to be complete.
+	 * @param turn: Side to move.
+	 * @param from: -1 at the start of a turn, otherwise the square of the piece that
+	 *              has just jumped (only its jumps are listed).
+	 * @param out: Receives the hops.
+	 * @param capacity: Size of out; the list is cut there, never overrun.
+	 * @return Number of hops listed.
+	 */
+	int legalHops(const board::Position& pos, char turn, int from, board::Hop* out, int capacity);
+
+	/**
+	 * @brief Encodes the hops of a game.
+	 * @param start: Position the game starts from.
+	 * @param startTurn: Side to move in the start position.
+	 * @param hops: The hops of the game.
+	 * @param coding: How indices are written.
+	 * @param out: Receives the encoded game (appended).
+	 * @return False if the start position is not valid or a hop is not legal, true otherwise.
+	 */
+	bool encode(const board::Position& start, char startTurn, const std::vector<board::Hop>& hops,
+		Coding coding, std::vector<std::uint8_t>* out);
+
+	/**
+	 * @brief Decodes the hops of a game.
+	 * @param data: Pointer to the encoded game.
+	 * @param size: Number of bytes available.
+	 * @param start: Position the game starts from.
+	 * @param startTurn: Side to move in the start position.
+	 * @param coding: How indices were written.
+	 * @param hops: Receives the hops (cleared first).
+	 * @return Number of bytes used, or 0 if the data is not a valid game.
+	 */
+	std::size_t decode(const std::uint8_t* data, std::size_t size, const board::Position& start, char startTurn,
+		Coding coding, std::vector<board::Hop>* hops);
+	void movecodec_Test();
+}
+
+/**
+ * @namespace poscodec
+ * @brief Namespace for storing positions on their own, without the game they come from.
+ *
+ * Two encodings:
+ *  - fixed: red, black and kings masks (little-endian u32 each) and the side
+ *    to move, 13 bytes, so record i is at byte 13 * i;
+ *  - variable: a bit stream of the side to move, a "has kings" bit, the
+ *    32-bit occupancy mask, one colour bit per piece (1 = black) and, only if
+ *    there are kings, one king bit per piece, in square order and padded to a
+ *    whole byte (8 bytes for the start position, fewer in endgames).
+ *
+ * A position file is the magic "CKPS", the encoding (0 fixed, 1 variable),
+ * the number of positions (u32) and the records.
+ */
+namespace poscodec {
+
+	/**
+	 * @struct Record
+	 * @brief A position with the side to move.
+	 */
+	struct Record {
+		board::Position position; ///< Pieces on the board.
+		char turn = Red;          ///< Side to move ('r' or 'b').
+	};
+
+	/** @brief Size of a record in the fixed encoding. */
+	const std::size_t fixedSize = 13;
+
+	/** @brief Largest size of a record in the variable encoding (24 pieces, some crowned). */
+	const std::size_t maxVariableSize = 11;
+
+	/**
+	 * @brief Encodes positions in the fixed encoding.
+	 * @param records: The positions.
+	 * @param count: Number of positions.
+	 * @param out: Receives count * fixedSize bytes.
+	 */
+	void encodeFixed(const Record* records, std::size_t count, std::uint8_t* out);
+
+	/**
+	 * @brief Decodes positions in the fixed encoding.
+	 * @param data: Pointer to count * fixedSize bytes.
+	 * @param count: Number of positions.
+	 * @param records: Receives the positions.
+	 */
+	void decodeFixed(const std::uint8_t* data, std::size_t count, Record* records);
+
+	/**
+	 * @brief Encodes positions in the variable encoding.
+	 * @param records: The positions.
+	 * @param count: Number of positions.
+	 * @param out: Receives the encoded positions (appended).
+	 */
+	void encodeVariable(const Record* records, std::size_t count, std::vector<std::uint8_t>* out);
+
+	/**
+	 * @brief Decodes positions in the variable encoding.
+	 * @param data: Pointer to the encoded positions.
+	 * @param size: Number of bytes.
+	 * @param count: Number of positions to decode.
+	 * @param records: Receives the positions.
+	 * @return Number of bytes used, or 0 if the data ends too early.
+	 */
+	std::size_t decodeVariable(const std::uint8_t* data, std::size_t size, std::size_t count, Record* records);
+
+	/**
+	 * @brief Expands positions into one byte per square for analysis tools.
+	 *
+	 * Square codes: 0 empty, 1 red man, 2 red king, 3 black man, 4 black king.
+	 * Uses SSE2 where the compiler targets it.
+	 *
+	 * @param records: The positions.
+	 * @param count: Number of positions.
+	 * @param squares: Receives 32 bytes per position, in square order.
+	 */
+	void expand(const Record* records, std::size_t count, std::uint8_t* squares);
+	void poscodec_Test();
+}
+
+/**
+ * @namespace render
+ * @brief Namespace for drawing the board on the terminal.
+ *
+ * A frame is formatted into a buffer that is allocated once and written with
+ * a single call. On terminals that understand ANSI escape sequences the
+ * screen is cleared with them instead of running "cls", and a board that is
+ * already on screen can be updated by rewriting only the squares that changed.
+ * Other outputs (pipes, files, old consoles) get the plain board text.
+ */
+namespace render {
+
+	/**
+	 * @brief Checks if standard output is a terminal with ANSI escape sequences,
+	 *        turning them on for Windows consoles that support them.
+	 * @return True if escape sequences can be used.
+	 */
+	bool enableAnsi();
+
+	/** @brief Clears the screen (if the terminal allows it). */
+	void clearScreen();
+
+	/**
+	 * @class Renderer
+	 * @brief Draws boards into a reusable buffer.
+	 */
+	class Renderer {
+	public:
+		/** @brief Constructor for Renderer; allocates the frame buffer. */
+		Renderer();
+
+		/**
+		 * @brief Clears the screen and draws the whole board at the top.
+		 * @param sqVect: The vector of Square objects representing the game board.
+		 * @param out: Stream to write to.
+		 */
+		void draw(const std::vector<Square>& sqVect, std::ostream& out);
+
+		/**
+		 * @brief Updates the board drawn by the last draw(), rewriting only the squares
+		 *        that changed, then puts the cursor below the board. Falls back to draw()
+		 *        when nothing is on screen or the terminal has no cursor addressing.
+		 * @param sqVect: The vector of Square objects representing the game board.
+		 * @param out: Stream to write to.
+		 */
+		void update(const std::vector<Square>& sqVect, std::ostream& out);
+
+		/** @brief Forgets what is on screen, so the next update() draws everything. */
+		void invalidate() { onScreen = false; }
+
+		/**
+		 * @brief Gets the last frame written.
+		 * @return The bytes of the frame.
+		 */
+		const std::string& lastFrame() const { return frame; }
+
+	private:
+		std::string frame;     ///< Frame buffer, reused by every draw.
+		char shown[32] = {};   ///< Colors of the squares on screen.
+		bool onScreen = false; ///< Whether 'shown' matches the screen.
+		bool ansi = false;     ///< Whether escape sequences can be used.
+	};
+
+	/** @brief Renderer used by displayBoard(). */
+	extern Renderer screen;
+	void render_Test();
+
+	/**
+	 * @class Mailbox
+	 * @brief Lock-free single-slot mailbox: the reader always gets the latest value.
+	 *
+	 * Three slots are rotated with one atomic exchange on each side (triple
+	 * buffering), so neither the writer nor the reader ever waits, and values
+	 * the reader did not take in time are overwritten.
+	 */
+	template <typename T>
+	class Mailbox {
+	public:
+		/** @brief Publishes a value (writer thread only). */
+		void publish(const T& value) {
+			slots[back] = value;
+			back = middle.exchange(static_cast<std::uint8_t>(back | fresh), std::memory_order_acq_rel) & ~fresh;
+		}
+
+		/**
+		 * @brief Takes the latest value if one was published since the last call (reader thread only).
+		 * @param value: Receives the value.
+		 * @return True if there was a new value.
+		 */
+		bool take(T* value) {
+			if (!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+			*value = slots[front];
+			return true;
+		}
+
+	private:
+		static const std::uint8_t fresh = 4; ///< Flag in 'middle': its slot holds an unread value.
+		T slots[3] = {};
+		std::atomic<std::uint8_t> middle{ 1 }; ///< Slot between writer and reader.
+		std::uint8_t back = 0;                 ///< Slot the writer fills.
+		std::uint8_t front = 2;                ///< Slot the reader reads.
+	};
+
+	/**
+	 * @struct Snapshot
+	 * @brief What the spectator needs to draw one frame.
+	 */
+	struct Snapshot {
+		board::Position position; ///< Pieces on the board.
+		char turn = Red;          ///< Side to move.
+		std::uint32_t hops = 0;   ///< Hops played so far.
+	};
+
+	/**
+	 * @class Spectator
+	 * @brief Draws a game from its own thread at a fixed frame rate.
+	 *
+	 * The game loop only publishes snapshots, so drawing never slows it down;
+	 * positions played between two frames are skipped.
+	 */
+	class Spectator {
+	public:
+		Spectator() = default;
+		Spectator(const Spectator&) = delete;
+		Spectator& operator=(const Spectator&) = delete;
+		~Spectator() { stop(); }
+
+		/**
+		 * @brief Starts the render thread.
+		 * @param board_: The board (copied; the thread only recolors its copy).
+		 * @param out_: Stream the thread writes to; nothing else may write to it until stop().
+		 * @param fps: Frames per second.
+		 */
+		void start(const std::vector<Square>& board_, std::ostream& out_, int fps);
+
+		/** @brief Publishes the position after a turn (game thread). */
+		void publish(const Snapshot& snapshot) { mailbox.publish(snapshot); }
+
+		/** @brief Draws the last published position and stops the render thread. */
+		void stop();
+
+		/** @brief Gets the number of frames drawn since start(). */
+		long framesDrawn() const { return frames; }
+
+	private:
+		void run(int fps);
+		bool drawLatest();
+
+		Mailbox<Snapshot> mailbox;
+		std::thread thread;
+		std::atomic<bool> running{ false };
+		std::vector<Square> board;
+		std::ostream* out = nullptr;
+		Renderer renderer;
+		std::string status;
+		long frames = 0;
+	};
+	void spectator_Test();
+}
+
+/**
+ * @namespace script
+ * @brief Namespace for replaying games written as whole moves, without prompts or redraws.
+ *
+ * A move is a piece square followed by its landing squares, joined by '-'
+ * for a step ("c3-d4") or by 'x' for jumps ("c3xe5xg7"). A capture chain may
+ * stop early, as in the game. Moves alternate between the sides, red first.
+ */
+namespace script {
+
+	/**
+	 * @struct Game
+	 * @brief A replayed game.
+	 */
+	struct Game {
+		board::Position position = board::startPosition(); ///< Position after the last move.
+		char turn = Red;                                    ///< Side to move.
+		int moves = 0;                                      ///< Moves played.
+	};
+
+	/**
+	 * @brief Plays whitespace-separated moves.
+	 * @param moves: The moves.
+	 * @param game: The game to continue; on error it holds the position before the bad move.
+	 * @param error: Receives the bad move and the reason.
+	 * @return True if every move was legal.
+	 */
+	bool play(std::string_view moves, Game* game, std::string* error);
+
+	/**
+	 * @brief Describes how a game stands: who is to move, or its result.
+	 * @param game: The game.
+	 * @return The description.
+	 */
+	std::string outcome(const Game& game);
+	void script_Test();
+}
+
+/**
+ * @namespace wire
+ * @brief Namespace for building and reading the frames sent to the board.
+ *
+ * The framing itself (protocol.h) is shared with the firmware; this adds the
+ * payloads that carry the game's own types.
+ */
+namespace wire {
+
+	/**
+	 * @brief Gets the hash both ends keep of a position.
+	 * @param pos: The position.
+	 * @param turn: Side to move ('r' or 'b').
+	 * @return The CRC of the position's snapshot.
+	 */
+	std::uint16_t boardHash(const board::Position& pos, char turn);
+
+	/**
+	 * @brief Builds a MOVE frame.
+	 * @param seq: Sequence number of the frame.
+	 * @param hash: Hash of the position the move is played on.
+	 * @param hops: The hops of the move.
+	 * @param count: Number of hops.
+	 * @param out: Receives the frame (PROTOCOL_MAX_FRAME bytes).
+	 * @return Size of the frame, or 0 if the move does not fit in one frame.
+	 */
+	std::size_t moveFrame(std::uint8_t seq, std::uint16_t hash, const board::Hop* hops, int count, std::uint8_t* out);
+
+	/**
+	 * @brief Reads a MOVE frame.
+	 * @param frame: A received frame.
+	 * @param hash: Receives the hash of the position the move was played on.
+	 * @param hops: Receives the hops (PROTOCOL_MAX_PAYLOAD / 2 of them at most).
+	 * @return Number of hops, or 0 if the frame is not a well-formed MOVE.
+	 */
+	int readMove(const Protocol_Frame& frame, std::uint16_t* hash, board::Hop* hops);
+
+	/**
+	 * @brief Builds a BOARD_SYNC frame.
+	 * @param seq: Sequence number of the frame.
+	 * @param pos: The position.
+	 * @param turn: Side to move ('r' or 'b').
+	 * @param out: Receives the frame (PROTOCOL_MAX_FRAME bytes).
+	 * @return Size of the frame.
+	 */
+	std::size_t syncFrame(std::uint8_t seq, const board::Position& pos, char turn, std::uint8_t* out);
+
+	/**
+	 * @brief Reads the position of a BOARD_SYNC frame.
+	 * @param frame: A received frame.
+	 * @param pos: Receives the position.
+	 * @param turn: Receives the side to move.
+	 * @return True if the frame is a well-formed BOARD_SYNC.
+	 */
+	bool readSync(const Protocol_Frame& frame, board::Position* pos, char* turn);
+
+	/**
+	 * @brief Reads a GAME frame, the board's answer to LOAD.
+	 * @param frame: A received frame.
+	 * @param slot: Receives the slot the game was saved in.
+	 * @param state: Receives the position, the side to move, the game mode and the last hops
+	 * (the seed is left as it is).
+	 * @return True if the frame is a well-formed GAME.
+	 */
+	bool readGame(const Protocol_Frame& frame, int* slot, save::GameState* state);
+
+	/**
+	 * @struct SavedGame
+	 * @brief A game saved on the board, as LIST tells of it.
+	 */
+	struct SavedGame {
+		int slot;  ///< Slot the game is saved in.
+		int mode;  ///< Game mode it was saved with.
+		char turn; ///< Side to move.
+		int red;   ///< Red pieces on the board.
+		int black; ///< Black pieces on the board.
+	};
+
+	/**
+	 * @brief Reads a LIST frame, the board's answer to LIST.
+	 * @param frame: A received frame.
+	 * @param games: Receives the saved games, in slot order.
+	 * @return True if the frame is a well-formed LIST.
+	 */
+	bool readList(const Protocol_Frame& frame, std::vector<SavedGame>* games);
+	void wire_Test();
+}
+
+/**
+ * @namespace transport
+ * @brief Namespace for the link to the PSoC board.
+ *
+ * A Link runs an I/O thread that owns the port: it writes the frames the
+ * game queues and parses the bytes it reads into events. The game thread and
+ * the I/O thread only meet in two lock-free single-producer single-consumer
+ * queues, so sending and polling never wait on the line.
+ */
+namespace transport {
+
+	/**
+	 * @class SpscQueue
+	 * @brief Lock-free bounded queue for one producer thread and one consumer thread.
+	 * @tparam T Type of the items.
+	 * @tparam N Capacity, a power of two.
+	 */
+	template <typename T, std::size_t N>
+	class SpscQueue {
+		static_assert((N & (N - 1)) == 0, "the capacity must be a power of two");
+	public:
+		/**
+		 * @brief Adds an item (producer thread only).
+		 * @return False if the queue is full.
+		 */
+		bool push(const T& item) {
+			const std::size_t tail = tailIndex.load(std::memory_order_relaxed);
+			if (tail - headIndex.load(std::memory_order_acquire) == N) return false;
+			items[tail & (N - 1)] = item;
+			tailIndex.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * @brief Takes the oldest item (consumer thread only).
+		 * @return False if the queue is empty.
+		 */
+		bool pop(T* item) {
+			const std::size_t head = headIndex.load(std::memory_order_relaxed);
+			if (head == tailIndex.load(std::memory_order_acquire)) return false;
+			*item = items[head & (N - 1)];
+			headIndex.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		T items[N];
+		std::atomic<std::size_t> headIndex{ 0 }; ///< Items taken so far.
+		std::atomic<std::size_t> tailIndex{ 0 }; ///< Items added so far.
+	};
+
+	/**
+	 * @class Port
+	 * @brief A byte stream to the board.
+	 */
+	class Port {
+	public:
+		virtual ~Port() = default;
+
+		/**
+		 * @brief Reads the bytes that have arrived, waiting a little if there are none.
+		 * @param buf: Receives the bytes.
+		 * @param size: Size of buf.
+		 * @param waitMs: Longest wait for the first byte, in milliseconds.
+		 * @return Number of bytes read (0 if none came), or -1 if the port was closed.
+		 */
+		virtual long read(std::uint8_t* buf, std::size_t size, int waitMs) = 0;
+
+		/**
+		 * @brief Writes what the port accepts without waiting.
+		 * @param data: The bytes.
+		 * @param size: Number of bytes.
+		 * @return Number of bytes written, or -1 if the port was closed.
+		 */
+		virtual long write(const std::uint8_t* data, std::size_t size) = 0;
+	};
+
+	/**
+	 * @class SerialPort
+	 * @brief Serial port (COMn on Windows, a tty or pty device elsewhere) set to 8N1 raw mode.
+	 */
+	class SerialPort : public Port {
+	public:
+		SerialPort() = default;
+		SerialPort(const SerialPort&) = delete;
+		SerialPort& operator=(const SerialPort&) = delete;
+		~SerialPort() override;
+
+		/**
+		 * @brief Opens a port.
+		 * @param name: Device name (e.g., "COM3", "/dev/ttyACM0").
+		 * @param baud: Baud rate (9600 to 115200).
+		 * @return True if the port was opened and set up.
+		 */
+		bool open(const std::string& name, int baud);
+
+		long read(std::uint8_t* buf, std::size_t size, int waitMs) override;
+		long write(const std::uint8_t* data, std::size_t size) override;
+
+	private:
+#ifdef _WIN32
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		int timeoutMs = -1; ///< Read timeout the port is set to.
+#else
+		int fd = -1;
+#endif
+	};
+
+	/**
+	 * @struct Event
+	 * @brief A frame received from the board.
+	 */
+	struct Event {
+		Protocol_Frame frame;                           ///< The frame.
+		std::chrono::steady_clock::time_point received; ///< When its last byte was read.
+	};
+
+	/**
+	 * @class LinkStats
+	 * @brief Timings and byte counts of a link over the last minute, kept by its I/O thread.
+	 *
+	 * Times are counted in histograms with one bucket per power of two of
+	 * microseconds. Each period of periodSeconds has its own counters, and
+	 * the oldest is cleared for the next, so the numbers roll. The counters
+	 * are atomic, so the game thread may read them at any time.
+	 */
+	class LinkStats {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		/** @brief What a histogram times. */
+		enum Series {
+			RoundTrip,  ///< From writing a frame to reading its ack (frames written once only).
+			BoardTime,  ///< Time the board spent on a frame, as its ack tells.
+			SeriesCount
+		};
+
+		/** @brief Number of buckets: bucket b counts [2^b, 2^(b+1)) us, the last one also anything longer. */
+		static const int buckets = 24;
+		/** @brief Number of periods kept. */
+		static const int periods = 6;
+		/** @brief Length of a period in seconds. */
+		static const int periodSeconds = 10;
+
+		/**
+		 * @brief Counts a time (I/O thread).
+		 * @param series: What was timed.
+		 * @param microseconds: The time.
+		 * @param at: When it was taken.
+		 */
+		void record(Series series, std::uint32_t microseconds, Clock::time_point at);
+
+		/**
+		 * @brief Counts bytes written to and read from the port (I/O thread).
+		 * @param sent: Bytes written.
+		 * @param received: Bytes read.
+		 * @param at: When.
+		 */
+		void addBytes(std::uint32_t sent, std::uint32_t received, Clock::time_point at);
+
+		/** @brief Counts a frame written again (I/O thread). */
+		void addRetransmit(Clock::time_point at);
+
+		/**
+		 * @brief Keeps the result of the last PING (I/O thread).
+		 * @param roundTrip: Microseconds from sending the PING to reading its echo.
+		 * @param offset: The board's clock minus the link's, in microseconds.
+		 */
+		void recordPing(std::uint32_t roundTrip, std::int64_t offset) { lastPing = roundTrip; boardOffset = offset; }
+
+		/** @brief Gets the round trip of the last PING in microseconds (0 if none came back). */
+		std::uint32_t pingTime() const { return lastPing; }
+
+		/** @brief Gets the board's clock minus the link's at the last PING, in microseconds. */
+		std::int64_t clockOffset() const { return boardOffset; }
+
+		/**
+		 * @brief Gets how many times of a series were counted over the last periods.
+		 * @param series: The series.
+		 * @param at: The present.
+		 */
+		std::uint64_t count(Series series, Clock::time_point at = Clock::now()) const;
+
+		/**
+		 * @brief Gets a percentile of a series over the last periods.
+		 * @param series: The series.
+		 * @param fraction: 0.5 for the median, 0.99 for the 99th percentile...
+		 * @param at: The present.
+		 * @return The upper end of the bucket it falls in, in microseconds (0 if nothing was counted).
+		 */
+		std::uint32_t percentile(Series series, double fraction, Clock::time_point at = Clock::now()) const;
+
+		/**
+		 * @brief Prints the histograms, percentiles and rates of the last periods.
+		 * @param out: The stream.
+		 * @param at: The present.
+		 */
+		void dump(std::ostream& out, Clock::time_point at = Clock::now()) const;
+
+		/** @brief Gets the bucket a time is counted in. */
+		static int bucketOf(std::uint32_t microseconds);
+
+	private:
+		/** @brief Counters of one period. */
+		struct Period {
+			std::atomic<long long> number{ -1 }; ///< Periods since the clock's epoch; -1 while unused or cleared.
+			std::atomic<std::uint32_t> counts[SeriesCount][buckets] = {};
+			std::atomic<std::uint64_t> sent{ 0 };
+			std::atomic<std::uint64_t> received{ 0 };
+			std::atomic<std::uint32_t> retransmits{ 0 };
+		};
+
+		Period& periodAt(Clock::time_point at);
+		bool isRecent(const Period& period, Clock::time_point at) const;
+		void histogram(Series series, Clock::time_point at, std::uint64_t* counts) const;
+
+		Period rolling[periods];
+		std::atomic<long long> firstNs{ -1 };         ///< When the first thing was counted.
+		std::atomic<std::uint32_t> lastPing{ 0 };
+		std::atomic<std::int64_t> boardOffset{ 0 };
+	};
+
+	/**
+	 * @class Link
+	 * @brief Framed connection to the board, served by its own I/O thread.
+	 *
+	 * Up to window frames are in flight at once. An ack releases its frame
+	 * and every frame before it; a frame is written again when the board
+	 * asks for it (BAD_CRC) or when its ack is late, and only that frame.
+	 * A SAVE goes alone: the board stops for a flash write and frames sent
+	 * meanwhile would overflow its FIFO. The I/O thread times the acks and counts the bytes in stats().
+	 */
+	class Link {
+	public:
+		/** @brief Longest time the I/O thread waits for input before looking at the send queue. */
+		static const int idleWaitMs = 1;
+
+		Link() = default;
+		Link(const Link&) = delete;
+		Link& operator=(const Link&) = delete;
+		~Link() { stop(); }
+
+		/**
+		 * @brief Starts the I/O thread on a port.
+		 * @param port_: The open port; the link owns it from now on.
+		 */
+		void start(std::unique_ptr<Port> port_);
+
+		/** @brief Stops the I/O thread and closes the port. Queued frames not yet written are lost. */
+		void stop();
+
+		/**
+		 * @brief Queues a frame for sending (game thread).
+		 * @param type: Message type (PROTOCOL_MSG_...).
+		 * @param payload: The payload.
+		 * @param length: Size of the payload.
+		 * @return The sequence number of the frame, or -1 if the queue is full or the payload too long.
+		 */
+		int send(std::uint8_t type, const std::uint8_t* payload, std::uint8_t length);
+
+		/**
+		 * @brief Takes the oldest received frame (game thread); never waits.
+		 * @param event: Receives the frame.
+		 * @return True if there was one.
+		 */
+		bool poll(Event* event) { return events.pop(event); }
+
+		/** @brief Checks if the I/O thread is running and the port is not closed. */
+		bool isOpen() const { return running && !closed; }
+
+		/** @brief Gets the number of frames dropped for a bad CRC or length. */
+		unsigned long badFrames() const { return bad; }
+
+		/**
+		 * @brief Sets how many frames may be in flight (1 for stop-and-wait).
+		 * @param frames: 1 to PROTOCOL_WINDOW.
+		 */
+		void setWindow(int frames) { window = std::max(1, std::min(frames, int(PROTOCOL_WINDOW))); }
+
+		/**
+		 * @brief Sets how long the I/O thread waits for an ack before writing a frame again.
+		 * @param ms: Timeout in milliseconds.
+		 */
+		void setRetransmitTimeout(int ms) { retransmitMs = ms; }
+
+		/** @brief Gets the number of frames written again. */
+		unsigned long retransmits() const { return resent; }
+
+		/** @brief Checks if every frame sent has been acked. */
+		bool idle() const { return unacked == 0; }
+
+		/**
+		 * @brief Queues a PING carrying the link's clock; the echo updates stats() (game thread).
+		 * @return The sequence number of the frame, or -1 if the queue is full.
+		 */
+		int ping();
+
+		/** @brief Gets the timings of the link. */
+		const LinkStats& stats() const { return counters; }
+
+	private:
+		/** @brief A frame ready to be written. */
+		struct Outgoing {
+			std::uint8_t bytes[PROTOCOL_MAX_FRAME];
+			std::uint8_t size;
+		};
+
+		/** @brief A frame written and not acked yet. */
+		struct InFlight {
+			Outgoing frame;
+			std::chrono::steady_clock::time_point written; ///< When it was last written.
+			bool again = false;                           ///< Waiting to be written again.
+			bool resent = false;                          ///< Written more than once, so its ack is not timed.
+		};
+
+		void run();
+		bool nextToWrite(InFlight* inFlight, std::size_t* count, Outgoing* pending, std::size_t* index);
+		static std::size_t acked(InFlight* inFlight, std::size_t count, const Protocol_Frame& ack);
+		std::uint32_t microseconds(std::chrono::steady_clock::time_point at) const;
+
+		std::unique_ptr<Port> port;
+		std::thread thread;
+		std::atomic<bool> running{ false };
+		std::atomic<bool> closed{ false };
+		std::atomic<unsigned long> bad{ 0 };
+		std::atomic<unsigned long> resent{ 0 };
+		std::atomic<unsigned> unacked{ 0 };
+		std::atomic<int> window{ int(PROTOCOL_WINDOW) };
+		std::atomic<int> retransmitMs{ 1000 };
+		std::uint8_t nextSeq = 0;
+		Outgoing held;        ///< Taken from the queue, waiting for the window to drain (I/O thread).
+		bool holding = false;
+		std::chrono::steady_clock::time_point started; ///< Zero of the clock sent in PINGs.
+		LinkStats counters;
+		SpscQueue<Outgoing, 64> outgoing;
+		SpscQueue<Event, 64> events;
+	};
+	void transport_Test();
+}
+
+/**
+ * @namespace hardware
+ * @brief Namespace for the game's side of the link to the board.
+ *
+ * With 'play <port>' the game keeps the board in step with itself: every
+ * move played on the PC goes out as a MOVE on the hash of the position it
+ * was played on, and a snapshot goes at the start of each game (new, loaded
+ * or resumed) and whenever the board answers that its position differs.
+ * A move made on the board comes in as the player's entries, as if typed.
+ * Without a link the game reads the console only.
+ */
+namespace hardware {
+
+	/** @brief The link to the board, or nullptr when the game is played without one. */
+	extern transport::Link* link;
+
+	/** @brief Sends the game's position and side to move as a BOARD_SYNC (no-op without a link). */
+	void sendSnapshot();
+
+	/**
+	 * @brief Sends the move just played, unless the board made it (no-op without a link).
+	 * @param before: Position the move was played on.
+	 * @param mover: Side that played it.
+	 * @param first: Index in checkers::history of the move's first hop.
+	 */
+	void sendMove(const board::Position& before, char mover, std::size_t first);
+
+	/**
+	 * @brief Handles the frames the board has sent (game thread): answers that
+	 * report another position get a snapshot, moves made on the board become entries.
+	 */
+	void service();
+
+	/**
+	 * @brief Takes the next entry of a move made on the board.
+	 * @param entry: Receives a square, or "sk" where the board's capture chain stopped.
+	 * @param chain: True if the game waits for another jump of the same piece.
+	 * @return True if there was one.
+	 */
+	bool boardEntry(std::string* entry, bool chain);
+
+	/**
+	 * @brief Reads the player's next entry from the board or the console, whichever comes first.
+	 * @param entry: Receives the entry.
+	 * @param chain: True if the game waits for another jump of the same piece.
+	 * @return False at the end of the console input.
+	 */
+	bool readEntry(std::string* entry, bool chain);
+	void hardware_Test();
+}
+
+/**
+ * @brief Runs one of the command line tools (used when arguments are given).
+ * @param argc: Number of arguments.
+ * @param argv: The arguments; argv[1] names the tool.
+ * @return The exit code of the program.
+ */
+int runTool(int argc, char* argv[]);
+void runTool_Test();
+
+/**
+ * @brief Runs the interactive menu of the game.
+ * @return The exit code of the program.
+ */
+int menu();
+
+void abcd();
+void Run_All_Tests();
+
+/**
+ * @brief Displays the game board, rewriting only the squares that changed
+ *        when the board is already on screen (see render::Renderer::update()).
+ * @param sqVect: The vector of Square objects representing the game board.
+ */
+void displayBoard(const std::vector<Square>& sqVect);
+
+/**
+ * @brief Prepares the game for play.
+ *
+ * This function initializes the game by setting up the checkers board
+ * and other necessary variables.
+ */
+void prepareGame();
+
+/**
+ * @brief Saves the game state to a file.
+ *
+ * @param squares: Pointer to the vector of Square objects representing the game board.
+ * @param turn_: The current turn ('r' for Red, 'b' for Black).
+ * @param selector_: The game mode selected by the user.
+ * @return True if the game was successfully saved, false otherwise.
+ */
+bool saveGame(std::vector<Square>* squares, char turn_, int selector_);
+
+/**
+ * @brief Loads the game state from a file.
+ *
+ * This function loads the game state from a file and updates the provided
+ * vector of squares, turn, and selector variables accordingly.
+ *
+ * @param squares: Pointer to the vector of squares representing the game board.
+ * @param turn_: Pointer to the variable representing the current player's turn.
+ * @param selector_: Pointer to the variable representing the game mode selected.
+ * @return True if the game state was successfully loaded, false otherwise.
+ */
+bool loadGame(std::vector<Square>* squares, char* turn_, int* selector_);
+
+/**
+ * @brief Starts the journal of the current game (see namespace journal).
+ *
+ * The journal is named after the game seed and can be resumed with
+ * "Resume game" if the program does not end normally.
+ */
+void startJournal();
+
+/**
+ * @brief Checks if a given string represents a valid square on the checkers board.
+ * @param square: The string representing the square.
+ * @return True if the string is a valid square, false otherwise.
+ */
+bool isSquare(std::string square);
+void isSquare_Test();
+
+/**
+ * @brief Reverses the crown status of a given color.
+ * @param color: The color character ('r' or 'b').
+ * @return The crowned version of the color ('R' or 'B') if uncrowned, or the uncrowned version ('r' or 'b') if crowned.
+ */
+char reverseCrown(char color);
+void reverseCrown_Test();
+
+/**
+ * @brief Checks if the current player cannot make any valid moves.
+ * @return True if the current player cannot make any moves, false otherwise.
+ */
+bool cannotMakeMove();
+
+/**
+ * @brief Checks if a movement from the initial square to the target square is possible.
+ * @param: initSq: Pointer to the initial square.
+ * @return True if the movement is possible, false otherwise.
+ */
+bool possibleMovement(Square* initSq);
+void possibleMovement_Test();
+
+/**
+ * @enum InputState
+ * @brief What the input loop of a player's turn is waiting for.
+ */
+enum class InputState {
+	Piece,           ///< Square of the piece to move.
+	Target,          ///< Target square of the selected piece.
+	ConsecutiveJump, ///< Target of another jump by the piece that has just jumped.
+	Done             ///< The turn is over (moved, skipped or quit).
+};
+
+/**
+ * @brief Reads one entry from the user and handles it.
+ *
+ * Commands ('h', 'd', 'sv', 'pdn', 'r', 'q', 'sk') are handled in place and
+ * return the state to continue in, so playerTurn() drives a whole turn with
+ * one loop and the stack does not grow however many entries are made.
+ * The end of the input counts as 'q'.
+ *
+ * @param state: What the entry is for.
+ * @return The next state.
+ */
+InputState readInput(InputState state);
+
+/**
+ * @brief Checks if a given string represents a valid square on the checkers board.
+ * @param sq: The string representing the square.
+ * @return True if the string is a valid square, false otherwise.
+ */
+bool goodSquare(std::string sq);
+void goodSquare_Test();
+
+/**
+ * @brief Checks if a given string represents a valid target square on the checkers board.
+ * @param sq: The string representing the target square.
+ * @return True if the string is a valid target square, false otherwise.
+ */
+bool goodTarget(std::string sq);
+void goodTarget_Test();
+
+/**
+ * @brief Checks if the initial square is one square away from the target square in the forward direction.
+ * @return True if the initial square is one square away from the target square in the forward direction, false otherwise.
+ */
+bool oneFrSqAway();
+void oneFrSqAway_Test();
+
+/**
+ * @brief Checks if the initial square is one square away from the target square in the backward direction.
+ * @return True if the initial square is one square away from the target square in the backward direction, false otherwise.
+ */
+bool oneBcSqAway();
+void oneBcSqAway_Test();
+
+/**
+ * @brief Checks if the initial square is two squares away from the target square in the forward direction.
+ * @return True if the initial square is two squares away from the target square in the forward direction, false otherwise.
+ */
+bool twoFrSqAway();
+void twoFrSqAway_Test();
+
+/**
+ * @brief Checks if the initial square is two squares away from the target square in the backward direction.
+ * @return True if the initial square is two squares away from the target square in the backward direction, false otherwise.
+ */
+bool twoBcSqAway();
+void twoBcSqAway_Test();
+
+/**
+ * @brief Gets the index of the square in the 'squares' vector based on its name.
+ * @param sq: The name of the square.
+ * @return The index of the square in the 'squares' vector.
+ */
+int getAddress(std::string sq);
+void getAddress_Test();
+
+/**
+ * @brief Gets the letter coordinate of a square.
+ * @param sq1: The name of the square.
+ * @return The letter coordinate of the square.
+ */
+char getLetCoordinate(std::string sq1);
+void getLetCoordinate_Test();
+
+/**
+ * @brief Gets the name of the square between the initial square and the target square.
+ * @param initSq: Pointer to the initial square.
+ * @param targetSq: Pointer to the target square.
+ * @return The name of the square between the initial square and the target square.
+ */
+std::string getSqInBetween(Square* initSq, Square* targetSq);
+void getSqInBetween_Test();
+
+/**
+ * @brief Gets the direction of capture between the initial square and the target square.
+ * @param initSq: Pointer to the initial square.
+ * @param targetSq: Pointer to the target square.
+ * @return The direction of capture ('R' for right, 'L' for left).
+ */
+char getCapDirection(std::string* initSq, std::string* targetSq);
+void getCapDirection_Test();
+
+/**
+ * @brief Gets the parity (oddness or evenness) of a row.
+ * @param row: The row number.
+ * @return The parity of the row ('O' for odd, 'E' for even).
+ */
+char getRowParity(char row);
+void getRowParity_Test();
+
+/**
+ * @brief Checks if the capture is going upward (from our view) for a crowned piece.
+ * @param initSq: Pointer to the initial square.
+ * @param targetSq: Pointer to the target square.
+ * @return True if the capture is going upward, false otherwise.
+ */
+bool upCapture(Square* initSq, Square* targetSq);
+void upCapture_Test();
+
+/**
+ * @brief Checks if the capture is going downward for a crowned piece.
+ * @param initSq: Pointer to the initial square.
+ * @param targetSq: Pointer to the target square.
+ * @return True if the capture is going downward, false otherwise.
+ */
+bool downCapture(Square* initSq, Square* targetSq);
+void downCapture_Test();
+
+/**
+ * @brief Checks if the first capture condition for red pieces is met.
+ * @return True if the first capture condition is met, false otherwise.
+ */
+bool R_Capture1();
+void R_Capture1_Test();
+
+/**
+ * @brief Checks if the second capture condition for red pieces is met.
+ * @return True if the second capture condition is met, false otherwise.
+ */
+bool R_Capture2();
+void R_Capture2_Test();
+
+/**
+ * @brief Checks if the third capture condition for red pieces is met.
+ * @return True if the third capture condition is met, false otherwise.
+ */
+bool R_Capture3();
+void R_Capture3_Test();
+
+/**
+ * @brief Checks if the fourth capture condition for red pieces is met.
+ * @return True if the fourth capture condition is met, false otherwise.
+ */
+bool R_Capture4();
+void R_Capture4_Test();
+
+/**
+ * @brief Checks if the first capture condition for black pieces is met.
+ * @return True if the first capture condition is met, false otherwise.
+ */
+bool B_Capture1();
+void B_Capture1_Test();
+
+/**
+ * @brief Checks if the second capture condition for black pieces is met.
+ * @return True if the second capture condition is met, false otherwise.
+ */
+bool B_Capture2();
+void B_Capture2_Test();
+
+/**
+ * @brief Checks if the third capture condition for black pieces is met.
+ * @return True if the third capture condition is met, false otherwise.
+ */
+bool B_Capture3();
+void B_Capture3_Test();
+
+/**
+ * @brief Checks if the fourth capture condition for black pieces is met.
+ * @return True if the fourth capture condition is met, false otherwise.
+ */
+bool B_Capture4();
+void B_Capture4_Test();
+
+/**
+ * @brief Gets the opposite color of a given color.
+ * @param color: The color character ('r' or 'b').
+ * @return The opposite color character ('b' or 'r').
+ */
+char oppoColor(char color);
+void oppoColor_Test();
+
+/**
+ * @brief Checks if a capture is occurring.
+ * @return True if a capture is occurring, false otherwise.
+ */
+bool isCapture();
+void isCapture_Test();
+
+/**
+ * @brief Updates the checkers board after a move.
+ */
+void updateBoard();
+
+/**
+ * @brief Checks if a promotion (to a crowned piece) is occurring.
+ * @return True if a promotion is occurring, false otherwise.
+ */
+bool isPromotion();
+void isPromotion_Test();
+
+/**
+ * @brief Checks if a capture is possible from the initial square.
+ * @param initSq: Pointer to the initial square.
+ * @return True if a capture is possible, false otherwise.
+ */
+bool possibleCapture(Square* initSq);
+void possibleCapture_Test();
+
+/**
+ * @brief Checks if a given string represents a valid target square in consecutive captures.
+ * @param sq: The string representing the target square.
+ * @return True if the string is a valid target square, false otherwise.
+ */
+bool goodConsecutiveJmpTarget(std::string sq);
+void goodConsecutiveJmpTarget_Test();
+
+/**
+ * @brief Displays the help information.
+ */
+void displayHelp();
+
+/**
+ * @brief Displays the main menu.
+ */
+void displayMenu();
+
+/**
+ * @brief Displays the game mode options.
+ */
+void displayMods();
+
+/**
+ * @brief Handles the player's turn.
+ */
+void playerTurn();
+
+/**
+ * @brief Handles the AI's turn, drawing from the game's generator.
+ */
+void AI_Turn();
+
+/**
+ * @brief Handles the AI's turn using the given engine configuration.
+ * @param engine: Configuration that decides how the move is picked.
+ * @param rng: The random number generator to draw from.
+ */
+void AI_Turn(const match::EngineConfig& engine, prng::Rng& rng);
+
+/**
+ * @brief Displays the match options and runs an engine match.
+ */
+void matchMenu();
+
+/**
+ * @brief Checks if the game is over.
+ * @return True if the game is over, false otherwise.
+ */
+bool gameOver();
+void gameOver_Test();
+
+/**
+ * @brief Handles the end of the game.
+ *
+ *
+ */
+void checkersGame(int selector_);
+
+/**
+ * @brief Handles the loss of a player.
+ */
+void handleLoss();
+
+/**
+ * @brief Asks the player if they want to play again.
+ * @return True if the player wants to play again, false otherwise.
+ */
+bool playAgain();
+
+/**
+ * @brief Exits the game.
+ */
+void exit();
+
+/**
+ * @brief Shuffles an array.
+ * @param array: The array to shuffle.
+ * @param size: The size of the array.
+ * @param gen: The random number generator to draw from.
+ */
+void shuffleArray(int* array, int size, prng::Rng& gen);
+void shuffleArray_Test();
+
+/**
+ * @brief Displays an error message.
+ * @param message: The error message to display.
+ */
+void error(std::string message);
+
+
+std::vector<Square> checkers::squares(32, Square(' ', "a1", '1')); //initialized to "a1" and '1' to get through 
+//constructor's error handling
+std::string checkers::selection = " "; //all input by the user is held by this variable
+char checkers::turn = ' '; //either 'r' (Red) or 'b' (Black)
+char checkers::captureDirection = ' '; //either 'R' (right) or 'L' (left)
+char checkers::initialRowParity = ' '; //either 'O' (odd) or 'E' (even)
+bool checkers::wasCapture = false; //was there a capture this turn?
+//used to determine whether to check for consecutive capture
+char checkers::loser = ' '; //either 'r' (Red) or 'b' (Black)
+//who is the loser?
+
+int checkers::selector = 0;
+//for vector location:
+int checkers::selected = 0; //holds vector address of square of selected piece
+int checkers::targeted = 0; //holds vector address of square to move a piece to
+int checkers::inBetween = 0; //holds vector address of square in between the
+//selected and targeted squares (in case of capture)
+std::uint64_t checkers::gameSeed = 1; //seed of the current game
+thread_local prng::Rng checkers::generator(1); //random numbers of the game on this thread
+std::vector<board::Hop> checkers::history; //hops played in the current game
+board::Position checkers::startPosition; //position 'history' starts from
+char checkers::startTurn = 'r'; //side to move in 'startPosition'
+
+#ifdef CHECKERS_TESTS
+//the Tests project builds this file with CHECKERS_TESTS to run the self-tests
+int main()
+{
+	Run_All_Tests();
+	return 0;
+}
+#else
+int main(int argc, char* argv[])
+{
+	if (argc > 1) return runTool(argc, argv);
+	return menu();
+}
+#endif
+
+int menu()
+try {
+	//the menu is shown again until a game is played or the user exits
+	while (true)
+	{
+		displayMenu();
+		std::cout << ">> ";
+		if (!(std::cin >> selection)) return 0;
+		//new game
+		if (selection == "1")
+		{
+			displayMods();
+			std::cout << ">> ";
+			std::cin >> selection;
+			if (selection == "1" || selection == "2" || selection == "3")
+			{
+				//int selector = std::stoi(selection);
+				selector = std::stoi(selection);
+				prepareGame();
+				gameSeed = prng::newSeed();
+				generator.seed(gameSeed);
+				startJournal();
+				checkersGame(selector);
+				return 0;
+			}
+			else if (selection == "4")
+			{
+				matchMenu();
+			}
+			else
+			{
+				std::cout << "Invalid input.\n";
+			}
+		}
+		//load previous game
+		else if (selection == "2")
+		{
+			if (!loadGame(&squares, &turn, &selector)) continue;
+			startJournal();
+			checkersGame(selector);
+			return 0;
+		}
+		//display help
+		else if (selection == "3" || selection == "h" || selection == "help")
+		{
+			displayHelp();
+		}
+		//exit
+		else if (selection == "4")
+		{
+			return 0;
+		}
+		else
+		{
+			std::cout << "Invalid input.\n";
+		}
+	}
+}
+catch (std::string message) {
+	std::cerr << message << '\n';
+	exit();
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	exit();
+	return 2;
+}
+
+void abcd()
+{
+	std::cout << "abcd";
+}
+
+void Run_All_Tests()
+{
+	isSquare_Test();
+	reverseCrown_Test();
+	possibleMovement_Test();
+	goodSquare_Test();
+	goodTarget_Test();
+	oneFrSqAway_Test();
+	oneBcSqAway_Test();
+	twoFrSqAway_Test();
+	twoBcSqAway_Test();
+	getAddress_Test();
+	getLetCoordinate_Test();
+	getSqInBetween_Test();
+	getCapDirection_Test();
+	getRowParity_Test();
+	upCapture_Test();
+	downCapture_Test();
+	R_Capture1_Test();
+	R_Capture2_Test();
+	R_Capture3_Test();
+	R_Capture4_Test();
+	B_Capture1_Test();
+	B_Capture2_Test();
+	B_Capture3_Test();
+	B_Capture4_Test();
+	oppoColor_Test();
+	isCapture_Test();
+	isPromotion_Test();
+	possibleCapture_Test();
+	goodConsecutiveJmpTarget_Test();
+	gameOver_Test();
+	shuffleArray_Test();
+	prng::Rng_Test();
+	board::Position_Test();
+	save::binarySave_Test();
+	save::parseIni_Test();
+	board::applyHop_Test();
+	pdn::pdn_Test();
+	gamedb::gamedb_Test();
+	journal::journal_Test();
+	movecodec::movecodec_Test();
+	poscodec::poscodec_Test();
+	render::render_Test();
+	render::spectator_Test();
+	script::script_Test();
+	wire::wire_Test();
+	transport::transport_Test();
+	hardware::hardware_Test();
+	runTool_Test();
+	match::eloEstimate_Test();
+	match::sprtLLR_Test();
+
+	std::cout << "All tests passed!\n";
+}
+
+void Square::changeColor(char newColor) {
+	if (c != newColor) c = newColor;
+}
+
+Square::Square() {
+	c = ' ';
+	s = "a1";
+	r = '1';
+	frtAdjSqs = setFrtAdjSqs(s);
+	bacAdjSqs = setBacAdjSqs(s);
+	frtJmpSqs = setFrtJmpSqs(s);
+	bacJmpSqs = setBacJmpSqs(s);
+	crowned = false;
+	captured = false;
+	return;
+}
+
+Square::Square(char c_, std::string s_, char r_)
+	:c(c_), s(s_), r(r_)
+{
+	//the 5 vector members (frtAdjSqs, bacAdjSqs, etc.) are
+	//not in the arguments because they are dependent on std::string s_
+
+	//check for constructor errors:
+	if (c_ != Red && c_ != cRed && c_ != Black && c_ != cBlack && c_ != ' ')
+		error("Exception: constructor use without correct color ('r','R','b','B',' ')");
+	if (!isSquare(s_))
+		error("Exception: constructor use without correct square");
+	switch (r_) {
+	case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8':
+		break;
+	default:
+		error("Exception: constructor use without correct row");
+	}
+
+	//initialize 7 other members
+	frtAdjSqs = setFrtAdjSqs(s);
+	bacAdjSqs = setBacAdjSqs(s);
+	frtJmpSqs = setFrtJmpSqs(s);
+	bacJmpSqs = setBacJmpSqs(s);
+	if (c_ == cRed || c_ == cBlack)
+		crowned = true; //'R' and 'B' indicate the piece is crowned
+	else
+		crowned = false;  //'r' and 'b' (and ' ') indicate the piece is uncrowned
+	captured = false;
+	return;
+}
+
+std::vector<std::string> Square::setFrtAdjSqs(std::string sq) {
+	//sets std::vector<std::string> frtAdjSqs
+
+	std::vector<std::string> sqs(2, " "); //holds the squares to give to frtAdjSqs
+
+	if (sq == "a1") { sqs[0] = "b2"; return sqs; }
+	if (sq == "a3") { sqs[0] = "b4"; return sqs; }
+	if (sq == "a5") { sqs[0] = "b6"; return sqs; }
+	if (sq == "a7") { sqs[0] = "b8"; return sqs; }
+
+	if (sq == "b2") { sqs[0] = "a3"; sqs[1] = "c3"; return sqs; }
+	if (sq == "b4") { sqs[0] = "a5"; sqs[1] = "c5"; return sqs; }
+	if (sq == "b6") { sqs[0] = "a7"; sqs[1] = "c7"; return sqs; }
+	if (sq == "b8") return sqs;	//a piece on b8 cannot move forward
+
+	if (sq == "c1") { sqs[0] = "b2"; sqs[1] = "d2"; return sqs; }
+	if (sq == "c3") { sqs[0] = "b4"; sqs[1] = "d4"; return sqs; }
+	if (sq == "c5") { sqs[0] = "b6"; sqs[1] = "d6"; return sqs; }
+	if (sq == "c7") { sqs[0] = "b8"; sqs[1] = "d8"; return sqs; }
+
+	if (sq == "d2") { sqs[0] = "c3"; sqs[1] = "e3"; return sqs; }
+	if (sq == "d4") { sqs[0] = "c5"; sqs[1] = "e5"; return sqs; }
+	if (sq == "d6") { sqs[0] = "c7"; sqs[1] = "e7"; return sqs; }
+	if (sq == "d8") return sqs;	//a piece on d8 cannot move forward
+
+	if (sq == "e1") { sqs[0] = "d2"; sqs[1] = "f2"; return sqs; }
+	if (sq == "e3") { sqs[0] = "d4"; sqs[1] = "f4"; return sqs; }
+	if (sq == "e5") { sqs[0] = "d6"; sqs[1] = "f6"; return sqs; }
+	if (sq == "e7") { sqs[0] = "d8"; sqs[1] = "f8"; return sqs; }
+
+	if (sq == "f2") { sqs[0] = "e3"; sqs[1] = "g3"; return sqs; }
+	if (sq == "f4") { sqs[0] = "e5"; sqs[1] = "g5"; return sqs; }
+	if (sq == "f6") { sqs[0] = "e7"; sqs[1] = "g7"; return sqs; }
+	if (sq == "f8") return sqs;	//a piece on f8 cannot move forward
+
+	if (sq == "g1") { sqs[0] = "f2"; sqs[1] = "h2"; return sqs; }
+	if (sq == "g3") { sqs[0] = "f4"; sqs[1] = "h4"; return sqs; }
+	if (sq == "g5") { sqs[0] = "f6"; sqs[1] = "h6"; return sqs; }
+	if (sq == "g7") { sqs[0] = "f8"; sqs[1] = "h8"; return sqs; }
+
+	if (sq == "h2") { sqs[0] = "g3"; return sqs; }
+	if (sq == "h4") { sqs[0] = "g5"; return sqs; }
+	if (sq == "h6") { sqs[0] = "g7"; return sqs; }
+	if (sq == "h8") return sqs;	//a piece on h8 cannot move forward
+
+	error("Exception: constructor use without an accessible square");
+}
+
+std::vector<std::string> Square::setBacAdjSqs(std::string sq) {
+	//sets std::vector<std::string> bacAdjSqs
+
+	std::vector<std::string> sqs(2, " "); //holds the squares to give to bacAdjSqs
+
+	if (sq == "a1") return sqs;	//a piece on a1 cannot move backward
+	if (sq == "a3") { sqs[0] = "b2"; return sqs; }
+	if (sq == "a5") { sqs[0] = "b4"; return sqs; }
+	if (sq == "a7") { sqs[0] = "b6"; return sqs; }
+
+	if (sq == "b2") { sqs[0] = "a1"; sqs[1] = "c1"; return sqs; }
+	if (sq == "b4") { sqs[0] = "a3"; sqs[1] = "c3"; return sqs; }
+	if (sq == "b6") { sqs[0] = "a5"; sqs[1] = "c5"; return sqs; }
+	if (sq == "b8") { sqs[0] = "a7"; sqs[1] = "c7"; return sqs; }
+
+	if (sq == "c1") return sqs;	//a piece on c1 cannot move backward
+	if (sq == "c3") { sqs[0] = "b2"; sqs[1] = "d2"; return sqs; }
+	if (sq == "c5") { sqs[0] = "b4"; sqs[1] = "d4"; return sqs; }
+	if (sq == "c7") { sqs[0] = "b6"; sqs[1] = "d6"; return sqs; }
+
+	if (sq == "d2") { sqs[0] = "c1"; sqs[1] = "e1"; return sqs; }
+	if (sq == "d4") { sqs[0] = "c3"; sqs[1] = "e3"; return sqs; }
+	if (sq == "d6") { sqs[0] = "c5"; sqs[1] = "e5"; return sqs; }
+	if (sq == "d8") { sqs[0] = "c7"; sqs[1] = "e7"; return sqs; }
+
+	if (sq == "e1") return sqs;	//a piece on e1 cannot move backward
+	if (sq == "e3") { sqs[0] = "d2"; sqs[1] = "f2"; return sqs; }
+	if (sq == "e5") { sqs[0] = "d4"; sqs[1] = "f4"; return sqs; }
+	if (sq == "e7") { sqs[0] = "d6"; sqs[1] = "f6"; return sqs; }
+
+	if (sq == "f2") { sqs[0] = "e1"; sqs[1] = "g1"; return sqs; }
+	if (sq == "f4") { sqs[0] = "e3"; sqs[1] = "g3"; return sqs; }
+	if (sq == "f6") { sqs[0] = "e5"; sqs[1] = "g5"; return sqs; }
+	if (sq == "f8") { sqs[0] = "e7"; sqs[1] = "g7"; return sqs; }
+
+	if (sq == "g1") return sqs;	//a piece on g1 cannot move backward
+	if (sq == "g3") { sqs[0] = "f2"; sqs[1] = "h2"; return sqs; }
+	if (sq == "g5") { sqs[0] = "f4"; sqs[1] = "h4"; return sqs; }
+	if (sq == "g7") { sqs[0] = "f6"; sqs[1] = "h6"; return sqs; }
+
+	if (sq == "h2") { sqs[0] = "g1"; return sqs; }
+	if (sq == "h4") { sqs[0] = "g3"; return sqs; }
+	if (sq == "h6") { sqs[0] = "g5"; return sqs; }
+	if (sq == "h8") { sqs[0] = "g7"; return sqs; }
+
+	error("Exception: constructor use without an accessible square");
+}
+
+std::vector<std::string> Square::setFrtJmpSqs(std::string sq) {
+	//sets std::vector<std::string> frtJmpSqs
+
+	std::vector<std::string> sqs(2, " "); //holds the squares to give to frtJmpSqs
+
+	if (sq == "a1") { sqs[0] = "c3"; return sqs; }
+	if (sq == "a3") { sqs[0] = "c5"; return sqs; }
+	if (sq == "a5") { sqs[0] = "c7"; return sqs; }
+	if (sq == "a7") return sqs;	//a piece on a7 cannot jump forward
+
+	if (sq == "b2") { sqs[0] = "d4"; return sqs; }
+	if (sq == "b4") { sqs[0] = "d6"; return sqs; }
+	if (sq == "b6") { sqs[0] = "d8"; return sqs; }
+	if (sq == "b8") return sqs;	//a piece on b8 cannot jump forward
+
+	if (sq == "c1") { sqs[0] = "a3"; sqs[1] = "e3"; return sqs; }
+	if (sq == "c3") { sqs[0] = "a5"; sqs[1] = "e5"; return sqs; }
+	if (sq == "c5") { sqs[0] = "a7"; sqs[1] = "e7"; return sqs; }
+	if (sq == "c7") return sqs;	//a piece on c7 cannot jump forward
+
+	if (sq == "d2") { sqs[0] = "b4"; sqs[1] = "f4"; return sqs; }
+	if (sq == "d4") { sqs[0] = "b6"; sqs[1] = "f6"; return sqs; }
+	if (sq == "d6") { sqs[0] = "b8"; sqs[1] = "f8"; return sqs; }
+	if (sq == "d8") return sqs;	//a piece on d8 cannot jump forward
+
+	if (sq == "e1") { sqs[0] = "c3"; sqs[1] = "g3"; return sqs; }
+	if (sq == "e3") { sqs[0] = "c5"; sqs[1] = "g5"; return sqs; }
+	if (sq == "e5") { sqs[0] = "c7"; sqs[1] = "g7"; return sqs; }
+	if (sq == "e7") return sqs;	//a piece on e7 cannot jump forward
+
+	if (sq == "f2") { sqs[0] = "d4"; sqs[1] = "h4"; return sqs; }
+	if (sq == "f4") { sqs[0] = "d6"; sqs[1] = "h6"; return sqs; }
+	if (sq == "f6") { sqs[0] = "d8"; sqs[1] = "h8"; return sqs; }
+	if (sq == "f8") return sqs;	//a piece on f8 cannot jump forward
+
+	if (sq == "g1") { sqs[0] = "e3"; return sqs; }
+	if (sq == "g3") { sqs[0] = "e5"; return sqs; }
+	if (sq == "g5") { sqs[0] = "e7"; return sqs; }
+	if (sq == "g7") return sqs;	//a piece on g7 cannot jump forward
+
+	if (sq == "h2") { sqs[0] = "f4"; return sqs; }
+	if (sq == "h4") { sqs[0] = "f6"; return sqs; }
+	if (sq == "h6") { sqs[0] = "f8"; return sqs; }
+	if (sq == "h8") return sqs;	//a piece on h8 cannot jump forward
+
+	error("Exception: constructor use without an accessible square");
+}
+
+std::vector<std::string> Square::setBacJmpSqs(std::string sq) {
+	//sets std::vector<std::string> bacJmpSqs
+
+	std::vector<std::string> sqs(2, " "); //holds the squares to give to bacJumpSqs
+
+	if (sq == "a1") return sqs;	//a crowned piece on a1 cannot jump backward
+	if (sq == "a3") { sqs[0] = "c1"; return sqs; }
+	if (sq == "a5") { sqs[0] = "c3"; return sqs; }
+	if (sq == "a7") { sqs[0] = "c5"; return sqs; }
+
+	if (sq == "b2") return sqs;	//a crowned piece on b2 cannot jump backward
+	if (sq == "b4") { sqs[0] = "d2"; return sqs; }
+	if (sq == "b6") { sqs[0] = "d4"; return sqs; }
+	if (sq == "b8") { sqs[0] = "d6"; return sqs; }
+
+	if (sq == "c1") return sqs;	//a crowned piece on c1 cannot jump backward
+	if (sq == "c3") { sqs[0] = "a1"; sqs[1] = "e1"; return sqs; }
+	if (sq == "c5") { sqs[0] = "a3"; sqs[1] = "e3"; return sqs; }
+	if (sq == "c7") { sqs[0] = "a5"; sqs[1] = "e5"; return sqs; }
+
+	if (sq == "d2") return sqs;	//a crowned piece on d2 cannot jump backward
+	if (sq == "d4") { sqs[0] = "b2"; sqs[1] = "f2"; return sqs; }
+	if (sq == "d6") { sqs[0] = "b4"; sqs[1] = "f4"; return sqs; }
+	if (sq == "d8") { sqs[0] = "b6"; sqs[1] = "f6"; return sqs; }
+
+	if (sq == "e1") return sqs;	//a crowned piece on e1 cannot jump backward
+	if (sq == "e3") { sqs[0] = "c1"; sqs[1] = "g1"; return sqs; }
+	if (sq == "e5") { sqs[0] = "c3"; sqs[1] = "g3"; return sqs; }
+	if (sq == "e7") { sqs[0] = "c5"; sqs[1] = "g5"; return sqs; }
+
+	if (sq == "f2") return sqs;	//a crowned piece on f2 cannot jump backward
+	if (sq == "f4") { sqs[0] = "d2"; sqs[1] = "h2"; return sqs; }
+	if (sq == "f6") { sqs[0] = "d4"; sqs[1] = "h4"; return sqs; }
+	if (sq == "f8") { sqs[0] = "d6"; sqs[1] = "h6"; return sqs; }
+
+	if (sq == "g1") return sqs;	//a crowned piece on g1 cannot jump backward
+	if (sq == "g3") { sqs[0] = "e1"; return sqs; }
+	if (sq == "g5") { sqs[0] = "e3"; return sqs; }
+	if (sq == "g7") { sqs[0] = "e5"; return sqs; }
+
+	if (sq == "h2") return sqs;	//a crowned piece on h2 cannot jump backward
+	if (sq == "h4") { sqs[0] = "f2"; return sqs; }
+	if (sq == "h6") { sqs[0] = "f4"; return sqs; }
+	if (sq == "h8") { sqs[0] = "f6"; return sqs; }
+
+	error("Exception: constructor use without an accessible square");
+}
+
+void displayBoard(const std::vector<Square>& sqVect) {
+	render::screen.update(sqVect, std::cout);
+}
+
+void prepareGame() {
+	//prepare variables:
+	selection = " ";
+	turn = Red;
+	captureDirection = ' ';
+	initialRowParity = ' ';
+	wasCapture = false;
+	loser = ' ';
+	selected = 0;
+	targeted = 0;
+	inBetween = 0;
+	history.clear();
+
+	//prepare squares and pieces:
+	squares[0] = Square(Red, "a1", '1'); squares[1] = Square(Red, "c1", '1');
+	squares[2] = Square(Red, "e1", '1'); squares[3] = Square(Red, "g1", '1');
+	squares[4] = Square(Red, "b2", '2'); squares[5] = Square(Red, "d2", '2');
+	squares[6] = Square(Red, "f2", '2'); squares[7] = Square(Red, "h2", '2');
+	squares[8] = Square(Red, "a3", '3'); squares[9] = Square(Red, "c3", '3');
+	squares[10] = Square(Red, "e3", '3'); squares[11] = Square(Red, "g3", '3');
+	squares[12] = Square(' ', "b4", '4'); squares[13] = Square(' ', "d4", '4');
+	squares[14] = Square(' ', "f4", '4'); squares[15] = Square(' ', "h4", '4');
+	squares[16] = Square(' ', "a5", '5'); squares[17] = Square(' ', "c5", '5');
+	squares[18] = Square(' ', "e5", '5'); squares[19] = Square(' ', "g5", '5');
+	squares[20] = Square(Black, "b6", '6'); squares[21] = Square(Black, "d6", '6');
+	squares[22] = Square(Black, "f6", '6'); squares[23] = Square(Black, "h6", '6');
+	squares[24] = Square(Black, "a7", '7'); squares[25] = Square(Black, "c7", '7');
+	squares[26] = Square(Black, "e7", '7'); squares[27] = Square(Black, "g7", '7');
+	squares[28] = Square(Black, "b8", '8'); squares[29] = Square(Black, "d8", '8');
+	squares[30] = Square(Black, "f8", '8'); squares[31] = Square(Black, "h8", '8');
+	startPosition = board::toPosition(squares);
+	startTurn = Red;
+	return;
+}
+
+bool saveGame(std::vector<Square>* squares, char turn_, int selector_) {
+	std::ofstream saveFile;
+	std::cout << "Enter name of file where you want to save game\n";
+	std::cout << ">> ";
+	std::cin >> selection;
+	//check if file ends in .ini (text) or .ckb (binary)
+	std::string extension = selection.substr(selection.find_last_of(".") + 1);
+	if (extension != "ini" && extension != "ckb")
+	{
+		std::cout << "File must be in .ini or .ckb format\n";
+		return false;
+	}
+	saveFile.open(selection, extension == "ckb" ? std::ios::binary : std::ios::out);
+	if (saveFile.is_open())
+	{
+		save::GameState state = save::capture(*squares, turn_, selector_);
+		if (extension == "ckb")
+		{
+			std::vector<std::uint8_t> bytes = save::encodeBinary(state);
+			saveFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		}
+		else
+		{
+			save::writeIni(saveFile, state);
+		}
+		saveFile.close();
+	}
+	else
+	{
+		std::cout << "Unable to open file\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool loadGame(std::vector<Square>* squares, char* turn_, int* selector_) {
+	std::ifstream loadFile;
+	std::cout << "Enter name of file (.ini, .ckb or a .journal left by an unfinished game):\n";
+	std::cout << ">> ";
+	std::cin >> selection;
+	const std::string extension = selection.substr(selection.find_last_of(".") + 1);
+	bool binary = extension == "ckb";
+	loadFile.open(selection, std::ios::binary | std::ios::ate);
+	save::GameState state;
+
+	if (loadFile.is_open()) {
+		//read the whole file with one read and parse it from memory
+		std::string contents(static_cast<size_t>(loadFile.tellg()), '\0');
+		loadFile.seekg(0);
+		loadFile.read(&contents[0], contents.size());
+		loadFile.close();
+
+		bool ok = false;
+		std::string message = "not a valid binary save";
+		if (binary)
+			ok = save::decodeBinary(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size(), &state);
+		else if (extension == "journal")
+		{
+			ok = journal::replay(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size(), &state);
+			message = "not a journal";
+		}
+		else
+			ok = save::parseIni(contents, &state, &message);
+		if (!ok)
+		{
+			std::cout << "File is not a valid saved game (" << message << ")\n";
+			return false;
+		}
+	}
+	else
+	{
+		std::cout << "Unable to open file\n";
+		return false;
+	}
+
+	save::restore(state, squares, turn_, selector_);
+	captureDirection = ' ';
+	initialRowParity = ' ';
+	wasCapture = false;
+	loser = ' ';
+	selected = 0;
+	targeted = 0;
+	inBetween = 0;
+
+	return true;
+}
+
+void startJournal() {
+	if (!journal::active.open(journal::pathFor(gameSeed), save::capture(squares, turn, selector)))
+		std::cout << "Unable to create the journal, this game will not be recoverable.\n";
+}
+
+std::string board::squareName(int index) {
+	const int row = index / 4;
+	std::string name = " ";
+	name[0] = static_cast<char>('a' + 2 * (index % 4) + row % 2); //odd rows start on column b
+	name += static_cast<char>('1' + row);
+	return name;
+}
+
+int board::squareIndex(const std::string& name) {
+	if (name.size() != 2) return -1;
+	const int col = name[0] - 'a';
+	const int row = name[1] - '1';
+	if (col < 0 || col > 7 || row < 0 || row > 7 || (col + row) % 2 != 0) return -1;
+	return row * 4 + col / 2;
+}
+
+board::Position board::toPosition(const std::vector<Square>& sqVect) {
+	Position pos;
+	for (size_t i = 0; i < sqVect.size() && i < 32; ++i)
+	{
+		const std::uint32_t bit = 1u << i;
+		switch (sqVect[i].color()) {
+		case cRed: pos.kings |= bit; //fall through
+		case Red: pos.red |= bit; break;
+		case cBlack: pos.kings |= bit; //fall through
+		case Black: pos.black |= bit; break;
+		}
+	}
+	return pos;
+}
+
+void board::fromPosition(const Position& pos, std::vector<Square>* sqVect) {
+	for (int i = 0; i < 32; ++i)
+	{
+		Square& sq = sqVect->at(i);
+		const std::string name = squareName(i);
+		if (sq.square() != name) sq = Square(' ', name, name[1]);
+
+		const std::uint32_t bit = 1u << i;
+		const bool king = (pos.kings & bit) != 0;
+		char color = ' ';
+		if (pos.red & bit) color = king ? cRed : Red;
+		else if (pos.black & bit) color = king ? cBlack : Black;
+		sq.changeColor(color);
+		sq.switchCrown(color != ' ' && king);
+		sq.switchCap(false);
+	}
+}
+
+void board::Position_Test()
+{
+	prepareGame();
+
+	// Test case 1: names and addresses match the board layout
+	assert(squareName(0) == "a1" && squareName(4) == "b2" && squareName(31) == "h8");
+	assert(squareIndex("c3") == 9 && squareIndex("b6") == 20);
+	assert(squareIndex("a2") == -1 && squareIndex("z9") == -1);
+
+	// Test case 2: start position has 12 pieces on each side
+	Position pos = toPosition(squares);
+	assert(pos.red == 0x00000FFFu && pos.black == 0xFFF00000u && pos.kings == 0);
+
+	// Test case 3: a crowned piece round-trips through the masks
+	squares[13] = Square(cBlack, "d4", '4');
+	pos = toPosition(squares);
+	prepareGame();
+	fromPosition(pos, &squares);
+	assert(squares[13].color() == cBlack && squares[13].isCrowned());
+	assert(squares[0].color() == Red && !squares[0].isCrowned());
+
+	std::cout << "Position(): All test cases passed!\n";
+}
+
+board::Position board::startPosition() {
+	Position pos;
+	pos.red = 0x00000FFFu;   //a1 to g3
+	pos.black = 0xFFF00000u; //b6 to h8
+	return pos;
+}
+
+int board::neighbor(int index, int dRow, int dCol) {
+	const int row = index / 4 + dRow;
+	const int col = 2 * (index % 4) + (index / 4) % 2 + dCol;
+	if (row < 0 || row > 7 || col < 0 || col > 7) return -1;
+	return row * 4 + col / 2;
+}
+
+bool board::isJump(const Hop& hop) {
+	return std::abs(hop.to / 4 - hop.from / 4) == 2;
+}
+
+void board::applyHop(Position* pos, const Hop& hop) {
+	const std::uint32_t fromBit = 1u << hop.from;
+	const std::uint32_t toBit = 1u << hop.to;
+	const bool red = (pos->red & fromBit) != 0;
+	const bool king = (pos->kings & fromBit) != 0;
+
+	pos->red &= ~fromBit; pos->black &= ~fromBit; pos->kings &= ~fromBit;
+	if (red) pos->red |= toBit; else pos->black |= toBit;
+	if (king) pos->kings |= toBit;
+
+	if (isJump(hop))
+	{
+		//the jumped square is halfway between both squares
+		const int fromRow = hop.from / 4, toRow = hop.to / 4;
+		const int fromCol = 2 * (hop.from % 4) + fromRow % 2, toCol = 2 * (hop.to % 4) + toRow % 2;
+		const std::uint32_t midBit = 1u << (((fromRow + toRow) / 2) * 4 + ((fromCol + toCol) / 2) / 2);
+		pos->red &= ~midBit; pos->black &= ~midBit; pos->kings &= ~midBit;
+	}
+
+	//promotion on the far row
+	if ((red && hop.to >= h8 - 3) || (!red && hop.to <= g1)) pos->kings |= toBit;
+}
+
+void board::applyHop_Test()
+{
+	// Test case 1: neighbors follow the diagonals and stop at the edges
+	assert(neighbor(9, 1, 1) == 13 && neighbor(9, 1, -1) == 12); // c3 -> d4, b4
+	assert(neighbor(0, -1, 1) == -1 && neighbor(0, 1, -1) == -1); // a1 has no square below or left
+
+	// Test case 2: a step moves the piece
+	Position pos = startPosition();
+	applyHop(&pos, { 9, 13 }); // c3-d4
+	assert((pos.red & (1u << 13)) && !(pos.red & (1u << 9)));
+
+	// Test case 3: a jump removes the jumped piece
+	pos = startPosition();
+	pos.black |= 1u << 13; // black piece on d4
+	applyHop(&pos, { 9, 18 }); // c3xe5 jumps d4
+	assert(!(pos.black & (1u << 13)) && (pos.red & (1u << 18)));
+
+	// Test case 4: reaching the far row promotes
+	pos = Position();
+	pos.red = 1u << 25; // c7
+	applyHop(&pos, { 25, 29 }); // c7-d8
+	assert(pos.kings == (1u << 29));
+
+	std::cout << "applyHop(): All test cases passed!\n";
+}
+
+int board::lowestBit(std::uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+int board::countBits(std::uint32_t mask) {
+	int count = 0;
+	for (; mask; mask &= mask - 1) ++count;
+	return count;
+}
+
+std::uint64_t board::hash(const Position& pos, char turn) {
+	//keys 0-31 red men, 32-63 red kings, 64-95 black men, 96-127 black kings, 128 black to move
+	static const std::vector<std::uint64_t> keys = [] {
+		prng::Rng gen(0x5EEDC0DEull);
+		std::vector<std::uint64_t> k(129);
+		for (size_t i = 0; i < k.size(); ++i)
+			k[i] = (static_cast<std::uint64_t>(gen.next()) << 32) | gen.next();
+		return k;
+	}();
+
+	std::uint64_t h = turn == Black ? keys[128] : 0;
+	const std::uint32_t masks[4] = { pos.red & ~pos.kings, pos.red & pos.kings, pos.black & ~pos.kings, pos.black & pos.kings };
+	for (int m = 0; m < 4; ++m)
+		for (std::uint32_t bits = masks[m]; bits; bits &= bits - 1)
+			h ^= keys[m * 32 + lowestBit(bits)];
+	return h;
+}
+
+const std::uint32_t save::binaryMagic = 0x56534B43u; //"CKSV"
+const std::uint8_t save::binaryVersion = 2;
+
+save::GameState save::capture(const std::vector<Square>& sqVect, char turn_, int selector_) {
+	GameState state;
+	state.position = board::toPosition(sqVect);
+	state.turn = turn_;
+	state.selector = selector_;
+	state.seed = gameSeed;
+	state.draws = generator.draws();
+	state.history = history;
+	return state;
+}
+
+void save::restore(const GameState& state, std::vector<Square>* sqVect, char* turn_, int* selector_) {
+	board::fromPosition(state.position, sqVect);
+	*turn_ = state.turn;
+	*selector_ = state.selector;
+	gameSeed = state.seed;
+	generator.seed(gameSeed);
+	generator.skip(state.draws);
+	history = state.history;
+	//saved histories are played from the start position
+	startPosition = state.history.empty() ? state.position : board::startPosition();
+	startTurn = state.history.empty() ? state.turn : Red;
+}
+
+void save::writeIni(std::ostream& out, const GameState& state) {
+	std::vector<Square> sqVect(32, Square(' ', "a1", '1'));
+	board::fromPosition(state.position, &sqVect);
+
+	out << "[Game]\nTurn=" << state.turn << "\nSeed=" << state.seed << "\nDraws=" << state.draws << "\n\n";
+	out << "[Selector]\nSelector=" << state.selector << "\n\n";
+
+	for (size_t i = 0; i < sqVect.size(); ++i) {
+		out << "[Square" << i << "]\n";
+		out << "Color=" << sqVect[i].color() << "\n";
+		out << "Square=" << sqVect[i].square() << "\n";
+		out << "Row=" << sqVect[i].row() << "\n\n";
+	}
+
+	out << "[History]\nMoves=";
+	for (size_t i = 0; i < state.history.size(); ++i) {
+		const board::Hop& hop = state.history[i];
+		//a hop that skips a row is a capture
+		const bool jump = std::abs(hop.to / 4 - hop.from / 4) == 2;
+		out << (i ? " " : "") << board::squareName(hop.from) << (jump ? 'x' : '-') << board::squareName(hop.to);
+	}
+	out << "\n";
+}
+
+bool save::readIni(std::istream& in, GameState* state, std::string* error) {
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	return parseIni(text, state, error);
+}
+
+namespace {
+	std::string_view trimmed(std::string_view text) {
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+		return text;
+	}
+
+	bool parseNumber(std::string_view text, std::uint64_t* value) {
+		if (text.empty()) return false;
+		const char* last = text.data() + text.size();
+		std::from_chars_result result = std::from_chars(text.data(), last, *value);
+		return result.ec == std::errc() && result.ptr == last;
+	}
+}
+
+bool save::parseIni(std::string_view text, GameState* state, std::string* error) {
+	enum class Section { None, Game, Selector, Square, History, Other };
+
+	//the [SquareN] section being read; it is checked when the next section starts
+	struct PendingSquare {
+		int line = 0;       //line of the section header
+		char color = 0;     //0 until Color= is seen
+		int index = -1;     //vector address from Square=
+		char row = 0;       //0 until Row= is seen
+	};
+
+	GameState parsed;
+	Section section = Section::None;
+	PendingSquare pending;
+	bool hasTurn = false;
+	std::uint32_t placed = 0; //squares already given by a [SquareN] section
+
+	auto fail = [error](int line, const char* message, std::string_view detail) {
+		if (error)
+		{
+			*error = "line " + std::to_string(line) + ": " + message;
+			if (!detail.empty()) { *error += " '"; *error += detail; *error += "'"; }
+		}
+		return false;
+	};
+
+	auto finishSquare = [&]() {
+		if (section != Section::Square) return true;
+		if (pending.index < 0) return fail(pending.line, "square section has no Square= key", "");
+		if (pending.color == 0) return fail(pending.line, "square section has no Color= key", "");
+		const std::uint32_t bit = 1u << pending.index;
+		if (placed & bit) return fail(pending.line, "square is given twice:", board::squareName(pending.index));
+		if (pending.row != 0 && pending.row != '1' + pending.index / 4)
+			return fail(pending.line, "Row= does not match square", board::squareName(pending.index));
+		placed |= bit;
+		switch (pending.color) {
+		case cRed: parsed.position.kings |= bit; //fall through
+		case Red: parsed.position.red |= bit; break;
+		case cBlack: parsed.position.kings |= bit; //fall through
+		case Black: parsed.position.black |= bit; break;
+		}
+		return true;
+	};
+
+	int lineNumber = 0;
+	std::size_t pos = 0;
+	while (pos < text.size())
+	{
+		std::size_t end = text.find('\n', pos);
+		if (end == std::string_view::npos) end = text.size();
+		std::string_view line = trimmed(text.substr(pos, end - pos));
+		pos = end + 1;
+		++lineNumber;
+
+		if (line.empty() || line[0] == ';' || line[0] == '#') continue;
+
+		if (line[0] == '[')
+		{
+			if (line.back() != ']') return fail(lineNumber, "unterminated section header", line);
+			if (!finishSquare()) return false;
+			std::string_view name = line.substr(1, line.size() - 2);
+			if (name == "Game") section = Section::Game;
+			else if (name == "Selector") section = Section::Selector;
+			else if (name == "History") section = Section::History;
+			else if (name.substr(0, 6) == "Square") { section = Section::Square; pending = PendingSquare(); pending.line = lineNumber; }
+			else section = Section::Other;
+			continue;
+		}
+
+		const std::size_t eq = line.find('=');
+		if (eq == std::string_view::npos) return fail(lineNumber, "expected key=value, got", line);
+		const std::string_view key = trimmed(line.substr(0, eq));
+		const std::string_view value = trimmed(line.substr(eq + 1));
+		std::uint64_t number = 0;
+
+		switch (section) {
+		case Section::Game:
+			if (key == "Turn")
+			{
+				if (value.size() != 1 || (value[0] != Red && value[0] != Black)) return fail(lineNumber, "Turn must be r or b, got", value);
+				parsed.turn = value[0];
+				hasTurn = true;
+			}
+			else if (key == "Seed")
+			{
+				if (!parseNumber(value, &number)) return fail(lineNumber, "Seed is not a number:", value);
+				parsed.seed = number;
+			}
+			else if (key == "Draws")
+			{
+				if (!parseNumber(value, &number)) return fail(lineNumber, "Draws is not a number:", value);
+				parsed.draws = number;
+			}
+			break;
+		case Section::Selector:
+			if (key == "Selector")
+			{
+				if (!parseNumber(value, &number) || number < 1 || number > 3) return fail(lineNumber, "Selector must be 1, 2 or 3, got", value);
+				parsed.selector = static_cast<int>(number);
+			}
+			break;
+		case Section::Square:
+			if (key == "Color")
+			{
+				//an empty square is saved as "Color= "
+				if (value.empty()) pending.color = ' ';
+				else if (value.size() == 1 && (value[0] == Red || value[0] == cRed || value[0] == Black || value[0] == cBlack)) pending.color = value[0];
+				else return fail(lineNumber, "Color must be r, R, b, B or blank, got", value);
+			}
+			else if (key == "Square")
+			{
+				if (value.size() != 2 || !isSquare(std::string(value))) return fail(lineNumber, "not an accessible square:", value);
+				pending.index = board::squareIndex(std::string(value));
+			}
+			else if (key == "Row")
+			{
+				if (value.size() != 1 || value[0] < '1' || value[0] > '8') return fail(lineNumber, "Row must be 1-8, got", value);
+				pending.row = value[0];
+			}
+			break;
+		case Section::History:
+			if (key == "Moves")
+			{
+				//moves are "c3-d4" or "c3xe5", and a capture chain may continue ("c3xe5xg7")
+				std::size_t i = 0;
+				while (i < value.size())
+				{
+					if (value[i] == ' ') { ++i; continue; }
+					std::size_t tokenEnd = value.find(' ', i);
+					if (tokenEnd == std::string_view::npos) tokenEnd = value.size();
+					std::string_view token = value.substr(i, tokenEnd - i);
+					if (token.size() < 5 || token.size() % 3 != 2) return fail(lineNumber, "malformed move", token);
+					for (std::size_t k = 0; k + 5 <= token.size(); k += 3)
+					{
+						const int from = board::squareIndex(std::string(token.substr(k, 2)));
+						const int to = board::squareIndex(std::string(token.substr(k + 3, 2)));
+						if (from < 0 || to < 0 || (token[k + 2] != '-' && token[k + 2] != 'x')) return fail(lineNumber, "malformed move", token);
+						parsed.history.push_back({ static_cast<std::uint8_t>(from), static_cast<std::uint8_t>(to) });
+					}
+					i = tokenEnd;
+				}
+			}
+			break;
+		case Section::None:
+			return fail(lineNumber, "key outside of any section:", key);
+		case Section::Other:
+			break;
+		}
+	}
+	if (!finishSquare()) return false;
+	if (!hasTurn) return fail(lineNumber, "missing Turn= in [Game]", "");
+
+	*state = parsed;
+	return true;
+}
+
+void save::parseIni_Test()
+{
+	GameState state;
+	std::string error;
+
+	// Test case 1: keys in any order, CRLF line ends and comments are accepted
+	std::string text =
+		"; saved by hand\r\n[Selector]\r\nSelector=3\r\n\r\n[Game]\r\nSeed=99\r\nTurn=b\r\n"
+		"[Square13]\r\nRow=4\r\nSquare=d4\r\nColor=R\r\n"
+		"[Square0]\r\nSquare = a1\r\nColor = b\r\n";
+	assert(parseIni(text, &state, &error));
+	assert(state.turn == Black && state.selector == 3 && state.seed == 99);
+	assert(state.position.red == (1u << 13) && state.position.kings == (1u << 13) && state.position.black == 1u);
+
+	// Test case 2: a bad Turn is reported with its line number
+	assert(!parseIni("[Game]\nTurn=r\n\n[Selector]\nSelector=7\n", &state, &error));
+	assert(error.find("line 5:") == 0);
+
+	// Test case 3: a square section without Square= is reported at its header
+	assert(!parseIni("[Game]\nTurn=r\n[Square0]\nColor=r\nRow=1\n", &state, &error));
+	assert(error.find("line 3:") == 0);
+
+	// Test case 4: a line that is not key=value is rejected
+	assert(!parseIni("[Game]\nTurn=r\ngarbage\n", &state, &error));
+	assert(error.find("line 3:") == 0);
+
+	// Test case 5: capture chains in the history are split into hops
+	assert(parseIni("[Game]\nTurn=r\n[History]\nMoves=c3-d4 f6-e5 d4xf6xd8\n", &state, &error));
+	assert(state.history.size() == 4 && state.history[3].from == 22 && state.history[3].to == 29);
+
+	std::cout << "parseIni(): All test cases passed!\n";
+}
+
+std::uint32_t save::crc32(const std::uint8_t* data, std::size_t size) {
+	std::uint32_t crc = 0xFFFFFFFFu;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int k = 0; k < 8; ++k)
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+	}
+	return ~crc;
+}
+
+namespace {
+	void putLE(std::vector<std::uint8_t>& out, std::uint64_t value, int bytes) {
+		for (int i = 0; i < bytes; ++i)
+			out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+	}
+
+	std::uint64_t getLE(const std::uint8_t* data, int bytes) {
+		std::uint64_t value = 0;
+		for (int i = bytes - 1; i >= 0; --i)
+			value = (value << 8) | data[i];
+		return value;
+	}
+}
+
+std::vector<std::uint8_t> save::encodeBinary(const GameState& state) {
+	std::vector<std::uint8_t> out;
+	out.reserve(42 + 2 * state.history.size());
+	putLE(out, binaryMagic, 4);
+	out.push_back(binaryVersion);
+	out.push_back(static_cast<std::uint8_t>(state.turn));
+	out.push_back(static_cast<std::uint8_t>(state.selector));
+	out.push_back(0);
+	putLE(out, state.position.red, 4);
+	putLE(out, state.position.black, 4);
+	putLE(out, state.position.kings, 4);
+	putLE(out, state.seed, 8);
+	putLE(out, state.draws, 8);
+	putLE(out, state.history.size(), 2);
+	for (size_t i = 0; i < state.history.size(); ++i)
+		putLE(out, state.history[i].from | (state.history[i].to << 5), 2);
+	putLE(out, crc32(out.data(), out.size()), 4);
+	return out;
+}
+
+bool save::decodeBinary(const std::uint8_t* data, std::size_t size, GameState* state) {
+	//version 1 saves have no draws, so their hops start 8 bytes earlier
+	if (size < 34 || getLE(data, 4) != binaryMagic || (data[4] != 1 && data[4] != binaryVersion)) return false;
+	const std::size_t header = data[4] == 1 ? 30 : 38;
+	if (size < header + 4) return false;
+	const std::size_t hops = static_cast<std::size_t>(getLE(data + header - 2, 2));
+	if (size != header + 4 + 2 * hops) return false;
+	if (getLE(data + size - 4, 4) != crc32(data, size - 4)) return false;
+
+	GameState decoded;
+	decoded.turn = static_cast<char>(data[5]);
+	decoded.selector = data[6];
+	decoded.position.red = static_cast<std::uint32_t>(getLE(data + 8, 4));
+	decoded.position.black = static_cast<std::uint32_t>(getLE(data + 12, 4));
+	decoded.position.kings = static_cast<std::uint32_t>(getLE(data + 16, 4));
+	decoded.seed = getLE(data + 20, 8);
+	decoded.draws = header == 38 ? getLE(data + 28, 8) : 0;
+	if (decoded.turn != Red && decoded.turn != Black) return false;
+	if (decoded.selector < 1 || decoded.selector > 3) return false;
+	if (decoded.position.red & decoded.position.black) return false;
+	if (decoded.position.kings & ~(decoded.position.red | decoded.position.black)) return false;
+
+	decoded.history.resize(hops);
+	for (std::size_t i = 0; i < hops; ++i)
+	{
+		const std::uint32_t packed = static_cast<std::uint32_t>(getLE(data + header + 2 * i, 2));
+		decoded.history[i].from = packed & 31u;
+		decoded.history[i].to = (packed >> 5) & 31u;
+	}
+	*state = decoded;
+	return true;
+}
+
+void save::binarySave_Test()
+{
+	prepareGame();
+	history.push_back({ 9, 13 });   // c3-d4
+	history.push_back({ 22, 18 });  // f6-e5
+	history.push_back({ 13, 22 });  // d4xf6
+	squares[13] = Square(cRed, "d4", '4');
+	gameSeed = 7;
+	generator.seed(gameSeed);
+	generator.skip(1234);
+	GameState state = capture(squares, Black, 2);
+	assert(state.draws == 1234);
+
+	// Test case 1: binary save is a few dozen bytes and round-trips
+	std::vector<std::uint8_t> bytes = encodeBinary(state);
+	assert(bytes.size() == 42 + 2 * 3);
+	GameState decoded;
+	assert(decodeBinary(bytes.data(), bytes.size(), &decoded));
+	assert(decoded.position.red == state.position.red && decoded.position.black == state.position.black
+		&& decoded.position.kings == state.position.kings);
+	assert(decoded.turn == Black && decoded.selector == 2 && decoded.seed == state.seed && decoded.draws == 1234);
+	assert(decoded.history.size() == 3 && decoded.history[2].from == 13 && decoded.history[2].to == 22);
+
+	// Test case 2: a corrupted byte is caught by the checksum
+	bytes[10] ^= 0x40;
+	assert(!decodeBinary(bytes.data(), bytes.size(), &decoded));
+
+	// Test case 3: INI save round-trips to the same state
+	std::stringstream ini;
+	writeIni(ini, state);
+	GameState fromIni;
+	assert(readIni(ini, &fromIni));
+	assert(encodeBinary(fromIni) == encodeBinary(state));
+
+	// Test case 4: truncated data is rejected
+	bytes = encodeBinary(state);
+	assert(!decodeBinary(bytes.data(), bytes.size() - 1, &decoded));
+
+	// Test case 5: a version 1 save (no draws) still loads
+	std::vector<std::uint8_t> old(bytes.begin(), bytes.begin() + 28);
+	old[4] = 1;
+	old.insert(old.end(), bytes.begin() + 36, bytes.end() - 4);
+	const std::uint32_t crc = crc32(old.data(), old.size());
+	for (int i = 0; i < 4; ++i) old.push_back(static_cast<std::uint8_t>(crc >> (8 * i)));
+	assert(decodeBinary(old.data(), old.size(), &decoded));
+	assert(decoded.seed == state.seed && decoded.draws == 0 && decoded.history.size() == 3);
+
+	// Test case 6: a restored game draws on from where it was saved, not from its seed
+	std::uint32_t expected[5];
+	for (std::uint32_t& number : expected) number = generator.next();
+	generator.seed(99);
+	std::vector<Square> restored(32, Square(' ', "a1", '1'));
+	char restoredTurn = ' ';
+	int restoredSelector = 0;
+	restore(state, &restored, &restoredTurn, &restoredSelector);
+	for (std::uint32_t number : expected) assert(generator.next() == number);
+
+	// Test case 7: a save with a checksum that holds is still rejected for an unknown game mode or a king on an empty square
+	GameState bad = state;
+	bad.selector = 4;
+	bytes = encodeBinary(bad);
+	assert(!decodeBinary(bytes.data(), bytes.size(), &decoded));
+	bad.selector = 0;
+	bytes = encodeBinary(bad);
+	assert(!decodeBinary(bytes.data(), bytes.size(), &decoded));
+	bad = state;
+	bad.position.kings |= 1u << 15;
+	assert(!(bad.position.red >> 15 & 1u) && !(bad.position.black >> 15 & 1u));
+	bytes = encodeBinary(bad);
+	assert(!decodeBinary(bytes.data(), bytes.size(), &decoded));
+
+	prepareGame();
+	std::cout << "binarySave(): All test cases passed!\n";
+}
+
+int pdn::squareNumber(int index) {
+	return 4 * (index / 4) + 4 - index % 4;
+}
+
+int pdn::squareFromNumber(int number) {
+	if (number < 1 || number > 32) return -1;
+	return 4 * ((number - 1) / 4) + 3 - (number - 1) % 4;
+}
+
+namespace {
+	void writeFenPieces(std::ostream& out, std::uint32_t pieces, std::uint32_t kings) {
+		bool first = true;
+		for (int n = 1; n <= 32; ++n)
+		{
+			const int i = pdn::squareFromNumber(n);
+			if (!(pieces >> i & 1u)) continue;
+			out << (first ? "" : ",") << ((kings >> i & 1u) ? "K" : "") << n;
+			first = false;
+		}
+	}
+
+	//finds the jumps that take a piece from 'from' to 'target' (for moves written as "11x27")
+	bool findJumpPath(const board::Position& pos, int from, int target, std::vector<board::Hop>* path, int depth) {
+		if (depth > 12) return false;
+		const std::uint32_t bit = 1u << from;
+		const bool red = (pos.red & bit) != 0;
+		const bool king = (pos.kings & bit) != 0;
+		const std::uint32_t opponents = red ? pos.black : pos.red;
+		const std::uint32_t occupied = pos.red | pos.black;
+		for (int dRow = -1; dRow <= 1; dRow += 2)
+		{
+			if (!king && dRow != (red ? 1 : -1)) continue; //men only capture forward
+			for (int dCol = -1; dCol <= 1; dCol += 2)
+			{
+				const int mid = board::neighbor(from, dRow, dCol);
+				const int land = board::neighbor(from, 2 * dRow, 2 * dCol);
+				if (mid < 0 || land < 0 || !(opponents >> mid & 1u) || (occupied >> land & 1u)) continue;
+				board::Position next = pos;
+				const board::Hop hop = { static_cast<std::uint8_t>(from), static_cast<std::uint8_t>(land) };
+				board::applyHop(&next, hop);
+				path->push_back(hop);
+				if (land == target || findJumpPath(next, land, target, path, depth + 1)) return true;
+				path->pop_back();
+			}
+		}
+		return false;
+	}
+
+	bool isResult(const std::string& token) {
+		return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*"
+			|| token == "2-0" || token == "0-2" || token == "1-1" || token == "0-0";
+	}
+}
+
+void pdn::writeGame(std::ostream& out, const Game& game) {
+	const board::Position standard = board::startPosition();
+	for (size_t i = 0; i < game.tags.size(); ++i)
+	{
+		if (game.tags[i].first == "FEN" || game.tags[i].first == "Result") continue; //written below
+		out << '[' << game.tags[i].first << " \"" << game.tags[i].second << "\"]\n";
+	}
+	out << "[Result \"" << game.result << "\"]\n";
+	if (game.start.red != standard.red || game.start.black != standard.black
+		|| game.start.kings != standard.kings || game.startTurn != Red)
+	{
+		out << "[FEN \"" << (game.startTurn == Red ? 'B' : 'W') << ":W";
+		writeFenPieces(out, game.start.black, game.start.kings);
+		out << ":B";
+		writeFenPieces(out, game.start.red, game.start.kings);
+		out << "\"]\n";
+	}
+	out << '\n';
+
+	board::Position pos = game.start;
+	std::string text;
+	std::size_t lineStart = 0;
+	int moveNumber = 1;
+	bool redMoved = false; //did red move under the current move number?
+	std::size_t i = 0;
+	while (i < game.hops.size())
+	{
+		//a move is a hop plus the jumps that continue from its landing square
+		const board::Hop first = game.hops[i];
+		const bool red = (pos.red >> first.from & 1u) != 0;
+		const bool jump = board::isJump(first);
+		std::string move = std::to_string(squareNumber(first.from)) + (jump ? 'x' : '-') + std::to_string(squareNumber(first.to));
+		board::applyHop(&pos, first);
+		++i;
+		while (jump && i < game.hops.size() && board::isJump(game.hops[i]) && game.hops[i].from == game.hops[i - 1].to)
+		{
+			move += 'x' + std::to_string(squareNumber(game.hops[i].to));
+			board::applyHop(&pos, game.hops[i]);
+			++i;
+		}
+
+		std::string token;
+		if (red)
+		{
+			if (redMoved) ++moveNumber;
+			token = std::to_string(moveNumber) + ". " + move;
+			redMoved = true;
+		}
+		else
+		{
+			token = redMoved ? move : std::to_string(moveNumber) + "... " + move;
+			++moveNumber;
+			redMoved = false;
+		}
+
+		if (text.size() - lineStart + token.size() + 1 > 79) { text += '\n'; lineStart = text.size(); }
+		else if (!text.empty()) text += ' ';
+		text += token;
+	}
+	if (text.size() - lineStart + game.result.size() + 1 > 79) text += '\n';
+	else if (!text.empty()) text += ' ';
+	text += game.result;
+	out << text << "\n\n";
+}
+
+pdn::Game pdn::currentGame() {
+	Game game;
+	const char* redPlayer = selector == 3 ? "AI" : "Man";
+	const char* blackPlayer = selector == 1 ? "Man" : "AI";
+	game.tags.push_back({ "Event", "Checkers game" });
+	game.tags.push_back({ "Date", "????.??.??" });
+	game.tags.push_back({ "Black", redPlayer });   //PDN calls the side that moves first Black
+	game.tags.push_back({ "White", blackPlayer });
+	game.tags.push_back({ "GameType", "21" });
+	game.start = startPosition;
+	game.startTurn = startTurn;
+	game.hops = history;
+	if (loser == Red) game.result = "0-1";
+	else if (loser == Black) game.result = "1-0";
+	else if (loser == Both) game.result = "1/2-1/2";
+	return game;
+}
+
+bool pdn::exportGame() {
+	std::cout << "Enter name of PDN file to append the game to\n";
+	std::cout << ">> ";
+	std::cin >> selection;
+	if (selection.substr(selection.find_last_of(".") + 1) != "pdn")
+	{
+		std::cout << "File must be in .pdn format\n";
+		return false;
+	}
+	std::ofstream pdnFile(selection, std::ios::app);
+	if (!pdnFile.is_open())
+	{
+		std::cout << "Unable to open file\n";
+		return false;
+	}
+	writeGame(pdnFile, currentGame());
+	return true;
+}
+
+pdn::Reader::Reader(std::istream& in_)
+	: in(in_), buffer(1 << 16)
+{
+}
+
+int pdn::Reader::peek() {
+	if (pos == filled)
+	{
+		in.read(buffer.data(), buffer.size());
+		filled = static_cast<std::size_t>(in.gcount());
+		pos = 0;
+		if (filled == 0) return EOF;
+	}
+	return static_cast<unsigned char>(buffer[pos]);
+}
+
+int pdn::Reader::get() {
+	const int c = peek();
+	if (c != EOF)
+	{
+		++pos;
+		if (c == '\n') ++line;
+	}
+	return c;
+}
+
+bool pdn::Reader::readFen(const std::string& fen, Game* game) {
+	board::Position start;
+	char turn_ = ' ';
+	std::size_t i = 0;
+	while (i < fen.size() && fen[i] == ' ') ++i;
+	if (i < fen.size() && (fen[i] == 'B' || fen[i] == 'W')) turn_ = fen[i] == 'B' ? Red : Black;
+	else return false;
+
+	std::uint32_t* pieces = nullptr;
+	for (++i; i < fen.size(); ++i)
+	{
+		const char c = fen[i];
+		if (c == ':' && i + 1 < fen.size())
+		{
+			if (fen[i + 1] == 'W') pieces = &start.black;
+			else if (fen[i + 1] == 'B') pieces = &start.red;
+			else return false;
+			++i;
+		}
+		else if (c == 'K' || (c >= '0' && c <= '9'))
+		{
+			if (!pieces) return false;
+			const bool king = c == 'K';
+			if (king) ++i;
+			int first = 0;
+			while (i < fen.size() && fen[i] >= '0' && fen[i] <= '9') first = first * 10 + (fen[i++] - '0');
+			int last = first;
+			if (i < fen.size() && fen[i] == '-') //range such as 1-12
+			{
+				last = 0;
+				for (++i; i < fen.size() && fen[i] >= '0' && fen[i] <= '9'; ++i) last = last * 10 + (fen[i] - '0');
+			}
+			--i;
+			for (int n = first; n <= last; ++n)
+			{
+				const int index = squareFromNumber(n);
+				if (index < 0) return false;
+				*pieces |= 1u << index;
+				if (king) start.kings |= 1u << index;
+			}
+		}
+		else if (c != ',' && c != ' ' && c != '.')
+			return false;
+	}
+	if (start.red & start.black) return false;
+	//the move generator lists at most 12 pieces a side, as the board does
+	if (board::countBits(start.red) > movecodec::maxPieces || board::countBits(start.black) > movecodec::maxPieces) return false;
+	game->start = start;
+	game->startTurn = turn_;
+	position = start;
+	side = turn_;
+	return true;
+}
+
+bool pdn::Reader::readMove(const std::string& token, Game* game) {
+	int numbers[16];
+	int count = 0;
+	char separator = 0;
+	std::size_t i = 0;
+	while (i < token.size())
+	{
+		if (token[i] < '0' || token[i] > '9') return false;
+		int n = 0;
+		while (i < token.size() && token[i] >= '0' && token[i] <= '9') n = n * 10 + (token[i++] - '0');
+		if (count == 16) return false;
+		numbers[count++] = squareFromNumber(n);
+		if (numbers[count - 1] < 0) return false;
+		if (i < token.size())
+		{
+			if (token[i] != '-' && token[i] != 'x') return false;
+			if (separator && separator != token[i]) return false;
+			separator = token[i++];
+		}
+	}
+	if (count < 2) return false;
+
+	const std::uint32_t own = side == Red ? position.red : position.black;
+	if (!(own >> numbers[0] & 1u)) return false;
+
+	if (separator == '-')
+	{
+		//a step must be one of the side's legal hops: diagonal, onto an empty square, forward for a man
+		if (count != 2) return false;
+		board::Hop list[movecodec::maxHops];
+		if (!movecodec::isValid(position, side)) return false;
+		const int legal = movecodec::legalHops(position, side, -1, list, movecodec::maxHops);
+		if (std::none_of(list, list + legal, [&](const board::Hop& h) { return h.from == numbers[0] && h.to == numbers[1]; }))
+			return false;
+		const board::Hop hop = { static_cast<std::uint8_t>(numbers[0]), static_cast<std::uint8_t>(numbers[1]) };
+		board::applyHop(&position, hop);
+		game->hops.push_back(hop);
+		++hops;
+	}
+	else
+	{
+		std::vector<board::Hop> path;
+		for (int k = 1; k < count; ++k)
+		{
+			path.clear();
+			if (!findJumpPath(position, numbers[k - 1], numbers[k], &path, 0)) return false;
+			for (size_t h = 0; h < path.size(); ++h)
+			{
+				board::applyHop(&position, path[h]);
+				game->hops.push_back(path[h]);
+				++hops;
+			}
+		}
+	}
+	side = side == Red ? Black : Red;
+	return true;
+}
+
+pdn::Reader::Status pdn::Reader::next(Game* game, std::string* error) {
+	game->tags.clear();
+	game->hops.clear();
+	game->result = "*";
+	game->start = board::startPosition();
+	game->startTurn = Red;
+	position = game->start;
+	side = Red;
+
+	bool started = false;
+	bool failed = false;
+	std::string token, name, value;
+	for (;;)
+	{
+		int c = peek();
+		if (c == EOF)
+		{
+			if (!started) return Status::End;
+			break; //last game has no result
+		}
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n') { get(); continue; }
+		if (c == '[')
+		{
+			if (started && (!game->hops.empty() || failed)) break; //next game starts without a result here
+			get();
+			name.clear(); value.clear();
+			while ((c = peek()) != EOF && c != ' ' && c != '"' && c != ']' && c != '\n') name += static_cast<char>(get());
+			while ((c = peek()) == ' ') get();
+			if (c == '"')
+			{
+				get();
+				while ((c = get()) != EOF && c != '"' && c != '\n')
+				{
+					if (c == '\\') c = get();
+					value += static_cast<char>(c);
+				}
+			}
+			while ((c = peek()) != EOF && c != ']' && c != '\n') get();
+			if (c == ']') get();
+			started = true;
+			if (failed) continue;
+			if (name == "FEN" && !readFen(value, game))
+			{
+				failed = true;
+				*error = "game " + std::to_string(games + 1) + ", line " + std::to_string(line) + ": invalid FEN '" + value + "'";
+			}
+			game->tags.push_back({ name, value });
+			continue;
+		}
+		if (c == '{') { while ((c = get()) != EOF && c != '}'); continue; }
+		if (c == ';') { while ((c = get()) != EOF && c != '\n'); continue; }
+		if (c == '(')
+		{
+			int depth = 0;
+			while ((c = get()) != EOF)
+			{
+				if (c == '(') ++depth;
+				else if (c == ')' && --depth == 0) break;
+			}
+			continue;
+		}
+
+		token.clear();
+		while ((c = peek()) != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n'
+			&& c != '[' && c != '{' && c != '(' && c != ';') token += static_cast<char>(get());
+		if (token.empty()) { get(); continue; } //stray ')' or '}'
+		started = true;
+		if (isResult(token)) { game->result = token; break; }
+		if (failed || token[0] == '$') continue; //NAG
+
+		const std::size_t dot = token.find_last_of('.'); //move number, "12." or "12...11-15"
+		if (dot != std::string::npos) token.erase(0, dot + 1);
+		while (!token.empty() && (token.back() == '!' || token.back() == '?')) token.pop_back();
+		if (token.empty()) continue;
+		if (!readMove(token, game))
+		{
+			failed = true;
+			*error = "game " + std::to_string(games + 1) + ", line " + std::to_string(line) + ": invalid move '" + token + "'";
+		}
+	}
+	++games;
+	return failed ? Status::Error : Status::Game;
+}
+
+void pdn::pdn_Test()
+{
+	// Test case 1: square numbers follow English checkers numbering
+	assert(squareNumber(3) == 1 && squareNumber(0) == 4 && squareNumber(7) == 5 && squareNumber(31) == 29);
+	for (int i = 0; i < 32; ++i) assert(squareFromNumber(squareNumber(i)) == i);
+
+	// Test case 2: a game round-trips through export and import
+	Game game;
+	game.tags.push_back({ "Event", "Test" });
+	game.start = board::startPosition();
+	game.hops = { { 9, 13 }, { 22, 18 }, { 13, 22 }, { 27, 18 } }; // c3-d4 f6-e5 d4xf6 g7xe5
+	game.result = "0-1";
+	std::stringstream archive;
+	writeGame(archive, game);
+	assert(archive.str().find("1. 11-15 22-18 2. 15x22 25x18 0-1") != std::string::npos);
+
+	// Test case 3: a capture chain from a FEN position is joined into one move
+	Game chain;
+	chain.start.red = 1u << 9;                       // c3
+	chain.start.black = (1u << 13) | (1u << 21) | (1u << 31); // d4, d6, h8
+	chain.hops = { { 9, 18 }, { 18, 25 } };           // c3xe5xc7
+	writeGame(archive, chain);
+	assert(archive.str().find("1. 11x18x27 *") != std::string::npos);
+
+	// Test case 4: comments, variations and a shorthand capture are read back
+	archive << "[Event \"Short\"]\n[FEN \"B:W15,23,29:B11\"]\n{a comment} 1. 11x27 (1. 11-15) 1-0\n";
+	archive << "[Event \"Bad\"]\n1. 11-20 *\n";
+	archive << "[Event \"After\"]\n1. 9-14 *\n";
+	Reader reader(archive);
+	Game read;
+	std::string error;
+	assert(reader.next(&read, &error) == Reader::Status::Game);
+	assert(read.hops.size() == 4 && read.result == "0-1" && read.hops[2].from == 13 && read.hops[2].to == 22);
+	assert(reader.next(&read, &error) == Reader::Status::Game);
+	assert(read.hops.size() == 2 && read.hops[1].to == 25);
+	assert(reader.next(&read, &error) == Reader::Status::Game);
+	assert(read.hops.size() == 2 && read.result == "1-0" && read.hops[1].from == 18 && read.hops[1].to == 25);
+
+	// Test case 5: a bad game is reported and skipped, the next game is read
+	assert(reader.next(&read, &error) == Reader::Status::Error);
+	assert(error.find("invalid move '11-20'") != std::string::npos);
+	assert(reader.next(&read, &error) == Reader::Status::Game && read.hops.size() == 1);
+	assert(reader.next(&read, &error) == Reader::Status::End);
+
+	// Test case 6: a step must be one of the legal hops: diagonal, and forward for a man
+	const auto step = [](int from, int to) { return std::to_string(squareNumber(from)) + "-" + std::to_string(squareNumber(to)); };
+	std::stringstream steps;
+	steps << "[Event \"Sideways\"]\n1. " << step(9, 15) << " *\n";                                       // c3-h4
+	steps << "[Event \"Back\"]\n1. " << step(9, 13) << ' ' << step(22, 18) << " 2. " << step(13, 9) << " *\n"; // d4-c3
+	steps << "[Event \"Forward\"]\n1. " << step(9, 13) << ' ' << step(22, 18) << " *\n";
+	Reader stepReader(steps);
+	assert(stepReader.next(&read, &error) == Reader::Status::Error);
+	assert(stepReader.next(&read, &error) == Reader::Status::Error);
+	assert(stepReader.next(&read, &error) == Reader::Status::Game && read.hops.size() == 2);
+
+	// Test case 7: a FEN with more than 12 pieces on a side is refused; 12 are fine
+	std::stringstream crowded;
+	crowded << "[FEN \"B:W:BK5-8,K13-16,K21-24,K29\"]\n1. 5-9 *\n";
+	crowded << "[FEN \"B:W:BK5-8,K13-16,K21-24\"]\n1. 5-9 *\n";
+	Reader crowdedReader(crowded);
+	assert(crowdedReader.next(&read, &error) == Reader::Status::Error && error.find("invalid FEN") != std::string::npos);
+	assert(crowdedReader.next(&read, &error) == Reader::Status::Game && read.hops.size() == 1);
+
+	std::cout << "pdn(): All test cases passed!\n";
+}
+
+static_assert(sizeof(gamedb::Header) == 72, "database header layout");
+static_assert(sizeof(gamedb::GameRecord) == 20, "database game layout");
+static_assert(sizeof(gamedb::PositionRecord) == 32, "database position layout");
+static_assert(sizeof(gamedb::Occurrence) == 8, "database occurrence layout");
+
+void gamedb::Builder::addGame(const board::Position& start, char startTurn, const std::vector<board::Hop>& gameHops, std::uint8_t result) {
+	GameRecord record;
+	record.red = start.red;
+	record.black = start.black;
+	record.kings = start.kings;
+	record.firstHop = static_cast<std::uint32_t>(hops.size());
+	record.hopCount = static_cast<std::uint16_t>(std::min<size_t>(gameHops.size(), 0xFFFF));
+	record.startTurn = startTurn;
+	record.result = result;
+	const std::uint32_t gameIndex = static_cast<std::uint32_t>(games.size());
+	games.push_back(record);
+
+	//index the position before every move (a capture chain is one move) and the final position
+	board::Position pos = start;
+	char side = startTurn;
+	for (std::uint16_t i = 0; i <= record.hopCount; ++i)
+	{
+		const bool continuation = i > 0 && i < record.hopCount && board::isJump(gameHops[i - 1])
+			&& board::isJump(gameHops[i]) && gameHops[i].from == gameHops[i - 1].to;
+		if (i < record.hopCount)
+			side = (pos.red >> gameHops[i].from & 1u) ? Red : Black;
+		else if (i > 0)
+			side = (pos.red >> gameHops[i - 1].to & 1u) ? Black : Red;
+		if (!continuation)
+			entries.push_back({ board::hash(pos, side), { gameIndex, i, 0 } });
+		if (i == record.hopCount) break;
+		board::applyHop(&pos, gameHops[i]);
+		hops.push_back(static_cast<std::uint16_t>(gameHops[i].from | (gameHops[i].to << 5)));
+	}
+}
+
+long gamedb::Builder::addFile(const std::string& path, std::string* error) {
+	const std::string extension = path.substr(path.find_last_of(".") + 1);
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		*error = "unable to open " + path;
+		return -1;
+	}
+
+	if (extension == "pdn")
+	{
+		pdn::Reader reader(file);
+		pdn::Game game;
+		std::string message;
+		long added = 0;
+		for (pdn::Reader::Status status; (status = reader.next(&game, &message)) != pdn::Reader::Status::End; )
+		{
+			if (status == pdn::Reader::Status::Error) continue; //bad games are skipped
+			std::uint8_t result = Unknown;
+			if (game.result == "1-0" || game.result == "2-0") result = RedWin;
+			else if (game.result == "0-1" || game.result == "0-2") result = BlackWin;
+			else if (game.result == "1/2-1/2" || game.result == "1-1") result = Draw;
+			addGame(game.start, game.startTurn, game.hops, result);
+			++added;
+		}
+		return added;
+	}
+
+	std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	save::GameState state;
+	bool ok = false;
+	if (extension == "ckb")
+		ok = save::decodeBinary(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size(), &state);
+	else if (extension == "ini")
+		ok = save::parseIni(contents, &state, error);
+	if (!ok)
+	{
+		if (extension != "ini") *error = path + " is not a saved game";
+		else *error = path + ": " + *error;
+		return -1;
+	}
+
+	//saved games only know their result once one side has no pieces left
+	std::uint8_t result = Unknown;
+	if (state.position.red == 0) result = BlackWin;
+	else if (state.position.black == 0) result = RedWin;
+	if (state.history.empty())
+		addGame(state.position, state.turn, state.history, result);
+	else
+		addGame(board::startPosition(), Red, state.history, result);
+	return 1;
+}
+
+void gamedb::Builder::write(std::ostream& out) {
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.hash < b.hash || (a.hash == b.hash && (a.occurrence.game < b.occurrence.game
+			|| (a.occurrence.game == b.occurrence.game && a.occurrence.hop < b.occurrence.hop)));
+	});
+
+	std::vector<PositionRecord> positions;
+	std::vector<Occurrence> occurrences;
+	occurrences.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (positions.empty() || positions.back().hash != entries[i].hash)
+			positions.push_back({ entries[i].hash, static_cast<std::uint32_t>(i), 0, 0, 0, 0, 0 });
+		PositionRecord& record = positions.back();
+		++record.occurrences;
+		switch (games[entries[i].occurrence.game].result) {
+		case RedWin: ++record.redWins; break;
+		case Draw: ++record.draws; break;
+		case BlackWin: ++record.blackWins; break;
+		}
+		occurrences.push_back(entries[i].occurrence);
+	}
+
+	auto aligned = [](std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); };
+	Header head = {};
+	std::memcpy(head.magic, "CKDB", 4);
+	head.version = 1;
+	head.games = static_cast<std::uint32_t>(games.size());
+	head.hops = hops.size();
+	head.positions = positions.size();
+	head.occurrences = occurrences.size();
+	head.gamesOffset = sizeof(Header);
+	head.hopsOffset = aligned(head.gamesOffset + games.size() * sizeof(GameRecord));
+	head.positionsOffset = aligned(head.hopsOffset + hops.size() * sizeof(std::uint16_t));
+	head.occurrencesOffset = head.positionsOffset + positions.size() * sizeof(PositionRecord);
+
+	const char padding[8] = { 0 };
+	auto writeAt = [&](std::uint64_t offset, const void* bytes, std::size_t count) {
+		const std::uint64_t at = static_cast<std::uint64_t>(out.tellp());
+		out.write(padding, static_cast<std::streamsize>(offset - at));
+		out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+	};
+	out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	writeAt(head.gamesOffset, games.data(), games.size() * sizeof(GameRecord));
+	writeAt(head.hopsOffset, hops.data(), hops.size() * sizeof(std::uint16_t));
+	writeAt(head.positionsOffset, positions.data(), positions.size() * sizeof(PositionRecord));
+	writeAt(head.occurrencesOffset, occurrences.data(), occurrences.size() * sizeof(Occurrence));
+}
+
+bool gamedb::Database::open(const std::string& path, std::string* error) {
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { *error = "unable to open " + path; return false; }
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	const void* view = nullptr;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+	{
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping); //the view keeps the mapping alive
+	}
+	CloseHandle(file);
+	if (!view) { *error = "unable to map " + path; return false; }
+	const std::size_t length = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) { *error = "unable to open " + path; return false; }
+	struct stat info;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+		view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); //the mapping stays valid
+	if (view == MAP_FAILED) { *error = "unable to map " + path; return false; }
+	const std::size_t length = static_cast<std::size_t>(info.st_size);
+#endif
+	if (!attach(view, length, error))
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+#else
+		munmap(view, length);
+#endif
+		return false;
+	}
+	mapped = true;
+	return true;
+}
+
+bool gamedb::Database::attach(const void* data_, std::size_t size_, std::string* error) {
+	const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data_);
+	const Header* h = reinterpret_cast<const Header*>(bytes);
+	if (size_ < sizeof(Header) || std::memcmp(h->magic, "CKDB", 4) != 0 || h->version != 1)
+	{
+		*error = "not a game database";
+		return false;
+	}
+	//the counts come from the file, so the bounds are checked without a product or sum that could wrap
+	const auto fits = [size_](std::uint64_t offset, std::uint64_t count, std::size_t item) {
+		return offset <= size_ && count <= (size_ - offset) / item;
+	};
+	if (!fits(h->gamesOffset, h->games, sizeof(GameRecord))
+		|| !fits(h->hopsOffset, h->hops, sizeof(std::uint16_t))
+		|| !fits(h->positionsOffset, h->positions, sizeof(PositionRecord))
+		|| !fits(h->occurrencesOffset, h->occurrences, sizeof(Occurrence)))
+	{
+		*error = "game database is truncated";
+		return false;
+	}
+	//occurrences() hands out a position's range as is, so every range must lie in the table
+	const PositionRecord* records = reinterpret_cast<const PositionRecord*>(bytes + h->positionsOffset);
+	for (std::uint64_t i = 0; i < h->positions; ++i)
+		if (records[i].firstOccurrence > h->occurrences || records[i].occurrences > h->occurrences - records[i].firstOccurrence)
+		{
+			*error = "game database is corrupt";
+			return false;
+		}
+	data = bytes;
+	size = size_;
+	head = h;
+	games = reinterpret_cast<const GameRecord*>(bytes + h->gamesOffset);
+	positions = reinterpret_cast<const PositionRecord*>(bytes + h->positionsOffset);
+	occurrenceList = reinterpret_cast<const Occurrence*>(bytes + h->occurrencesOffset);
+	return true;
+}
+
+void gamedb::Database::close() {
+	if (mapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<std::uint8_t*>(data), size);
+#endif
+	}
+	data = nullptr; size = 0; mapped = false;
+	head = nullptr; games = nullptr; positions = nullptr; occurrenceList = nullptr;
+}
+
+const gamedb::PositionRecord* gamedb::Database::find(std::uint64_t hash) const {
+	if (!head) return nullptr;
+	const PositionRecord* end = positions + head->positions;
+	const PositionRecord* it = std::lower_bound(positions, end, hash,
+		[](const PositionRecord& record, std::uint64_t value) { return record.hash < value; });
+	return it != end && it->hash == hash ? it : nullptr;
+}
+
+const gamedb::Occurrence* gamedb::Database::occurrences(const PositionRecord& record) const {
+	return occurrenceList + record.firstOccurrence;
+}
 
-/**
- * @brief Displays the game mode options.
- */
-void displayMods();
+void gamedb::gamedb_Test()
+{
+	// Test case 1: two games share their first position
+	Builder builder;
+	const board::Position start = board::startPosition();
+	builder.addGame(start, Red, { { 9, 13 }, { 22, 18 }, { 13, 22 }, { 27, 18 } }, BlackWin); // c3-d4 f6-e5 d4xf6 g7xe5
+	builder.addGame(start, Red, { { 9, 13 }, { 21, 17 } }, RedWin);                         // c3-d4 d6-c5
+	std::stringstream file;
+	builder.write(file);
+	const std::string bytes = file.str();
+	std::vector<std::uint64_t> aligned((bytes.size() + 7) / 8);
+	std::memcpy(aligned.data(), bytes.data(), bytes.size());
+
+	Database db;
+	std::string error;
+	assert(db.attach(aligned.data(), bytes.size(), &error));
+	assert(db.header().games == 2 && db.header().hops == 6);
+
+	const PositionRecord* record = db.find(board::hash(start, Red));
+	assert(record && record->occurrences == 2 && record->redWins == 1 && record->blackWins == 1);
+
+	// Test case 2: a position reached in one game points at that game and hop
+	board::Position pos = start;
+	board::applyHop(&pos, { 9, 13 });
+	board::applyHop(&pos, { 21, 17 });
+	record = db.find(board::hash(pos, Red));
+	assert(record && record->occurrences == 1 && db.occurrences(*record)[0].game == 1 && db.occurrences(*record)[0].hop == 2);
+
+	// Test case 3: the side to move is part of the position
+	assert(db.find(board::hash(start, Black)) == nullptr);
+
+	// Test case 4: data that is not a database is rejected
+	std::uint64_t junk[16] = { 0 };
+	Database bad;
+	assert(!bad.attach(junk, sizeof(junk), &error));
+
+	// Test case 5: counts too large for the file, or an occurrence range past its table, are rejected
+	Header* head = reinterpret_cast<Header*>(aligned.data());
+	const Header kept = *head;
+	head->occurrences = ~std::uint64_t(0) / sizeof(Occurrence) + 2; //the product wraps to a small size
+	assert(!bad.attach(aligned.data(), bytes.size(), &error) && error == "game database is truncated");
+	*head = kept;
+	head->positionsOffset = ~std::uint64_t(0) - 7;
+	assert(!bad.attach(aligned.data(), bytes.size(), &error) && error == "game database is truncated");
+	*head = kept;
+	PositionRecord* first = reinterpret_cast<PositionRecord*>(reinterpret_cast<std::uint8_t*>(aligned.data()) + head->positionsOffset);
+	first->occurrences = static_cast<std::uint32_t>(head->occurrences - first->firstOccurrence + 1);
+	assert(!bad.attach(aligned.data(), bytes.size(), &error) && error == "game database is corrupt");
+
+	std::cout << "gamedb(): All test cases passed!\n";
+}
 
-/**
- * @brief Handles the player's turn.
- */
-void playerTurn();
+const std::uint16_t journal::endOfTurn = 0xFFFF;
+const std::uint16_t journal::drawsRecord = 0x8000;
+const std::uint16_t journal::maxDraws = 0x7FFE; //so no draws record is endOfTurn
+const int journal::syncInterval = 32;
+journal::Writer journal::active;
+
+bool journal::Writer::open(const std::string& path, const save::GameState& start) {
+	close();
+#ifdef _WIN32
+	fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (fd < 0) return false;
+	file = path;
+	unsynced = 0;
+	turnPending = false;
+	drawn = start.draws;
+
+	const std::vector<std::uint8_t> game = save::encodeBinary(start);
+	std::vector<std::uint8_t> bytes = { 'C', 'K', 'J', 'N' };
+	for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<std::uint8_t>(game.size() >> (8 * i)));
+	bytes.insert(bytes.end(), game.begin(), game.end());
+#ifdef _WIN32
+	const bool written = _write(fd, bytes.data(), static_cast<unsigned>(bytes.size())) == static_cast<int>(bytes.size());
+#else
+	const bool written = ::write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+#endif
+	if (!written)
+	{
+		discard();
+		return false;
+	}
+	sync();
+	return true;
+}
 
-/**
- * @brief Handles the AI's turn.
- */
-void AI_Turn();
+void journal::Writer::put(std::uint16_t record) {
+	if (fd < 0) return;
+	const std::uint8_t bytes[2] = { static_cast<std::uint8_t>(record), static_cast<std::uint8_t>(record >> 8) };
+#ifdef _WIN32
+	_write(fd, bytes, 2);
+#else
+	if (::write(fd, bytes, 2) != 2) return; //a short write is cut off on replay
+#endif
+	if (++unsynced >= syncInterval) sync();
+}
 
-/**
- * @brief Checks if the game is over.
- * @return True if the game is over, false otherwise.
- */
-bool gameOver();
-void gameOver_Test();
+void journal::Writer::append(const board::Hop& hop) {
+	put(static_cast<std::uint16_t>(hop.from | (hop.to << 5)));
+	turnPending = true;
+}
 
-/**
- * @brief Handles the end of the game.
- *
- *
- */
-void checkersGame(int selector_);
+void journal::Writer::endTurn(std::uint64_t draws) {
+	if (!turnPending) return;
+	//the AI's draws go before the end of its turn, so a resumed game draws on from there
+	while (draws > drawn)
+	{
+		const std::uint16_t count = static_cast<std::uint16_t>(std::min<std::uint64_t>(draws - drawn, maxDraws));
+		put(static_cast<std::uint16_t>(drawsRecord | count));
+		drawn += count;
+	}
+	put(endOfTurn);
+	turnPending = false;
+}
 
-/**
- * @brief Handles the loss of a player.
- */
-void handleLoss();
+void journal::Writer::sync() {
+	if (fd < 0) return;
+#ifdef _WIN32
+	_commit(fd);
+#else
+	fsync(fd);
+#endif
+	unsynced = 0;
+}
 
-/**
- * @brief Asks the player if they want to play again.
- * @return True if the player wants to play again, false otherwise.
- */
-bool playAgain();
+void journal::Writer::close() {
+	if (fd < 0) return;
+	sync();
+#ifdef _WIN32
+	_close(fd);
+#else
+	::close(fd);
+#endif
+	fd = -1;
+}
 
-/**
- * @brief Exits the game.
- */
-void exit();
+void journal::Writer::discard() {
+	if (fd < 0) return;
+	close();
+	std::remove(file.c_str());
+}
 
-/**
- * @brief Shuffles an array.
- * @param array: The array to shuffle.
- * @param size: The size of the array.
- */
-void shuffleArray(int* array, int size);
-void shuffleArray_Test();
+std::string journal::pathFor(std::uint64_t seed) {
+	return "game-" + std::to_string(seed) + ".journal";
+}
 
-/**
- * @brief Displays an error message.
- * @param message: The error message to display.
- */
-void error(std::string message);
+bool journal::replay(const std::uint8_t* data, std::size_t size, save::GameState* state) {
+	if (size < 8 || std::memcmp(data, "CKJN", 4) != 0) return false;
+	const std::size_t length = data[4] | data[5] << 8 | data[6] << 16 | static_cast<std::size_t>(data[7]) << 24;
+	save::GameState result;
+	if (length > size - 8 || !save::decodeBinary(data + 8, length, &result)) return false;
+
+	//the embedded history is only kept if it leads to the embedded position
+	const bool fromStart = !result.history.empty() || (result.position.red == board::startPosition().red
+		&& result.position.black == board::startPosition().black && result.position.kings == 0);
+	board::Position pos = result.position;
+	char turn = result.turn;
+	size_t committed = result.history.size();
+	std::uint64_t draws = result.draws;
+	for (std::size_t i = 8 + length; i + 2 <= size; i += 2)
+	{
+		const std::uint16_t record = static_cast<std::uint16_t>(data[i] | data[i + 1] << 8);
+		if (record == endOfTurn)
+		{
+			//everything up to here is a complete turn
+			result.position = pos;
+			committed = result.history.size();
+			result.draws = draws;
+			turn = turn == Red ? Black : Red;
+			result.turn = turn;
+			continue;
+		}
+		if (record & drawsRecord)
+		{
+			draws += record & ~drawsRecord;
+			continue;
+		}
+		const board::Hop hop = { static_cast<std::uint8_t>(record & 31), static_cast<std::uint8_t>(record >> 5 & 31) };
+		const std::uint32_t own = turn == Red ? pos.red : pos.black;
+		if ((record >> 10) != 0 || !(own >> hop.from & 1u) || ((pos.red | pos.black) >> hop.to & 1u)) break;
+		board::applyHop(&pos, hop);
+		result.history.push_back(hop);
+	}
+	result.history.resize(committed);
+	if (!fromStart) result.history.clear();
+	*state = result;
+	return true;
+}
 
+void journal::journal_Test()
+{
+	save::GameState start;
+	start.position = board::startPosition();
+	start.seed = 42;
+	const std::string path = pathFor(0xC0FFEE);
+
+	// Test case 1: complete turns are replayed, the turn in progress is dropped
+	Writer writer;
+	assert(writer.open(path, start));
+	writer.append({ 9, 13 });  writer.endTurn(0);      // c3-d4
+	writer.append({ 22, 18 }); writer.endTurn(70000);  // f6-e5, by an AI that drew 70000 numbers
+	writer.endTurn(70000);                             // no hop, no record
+	writer.append({ 13, 22 });                         // d4xf6, turn not finished
+	writer.close();
+
+	std::ifstream file(path, std::ios::binary);
+	std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	save::GameState state;
+	assert(replay(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size(), &state));
+	assert(state.history.size() == 2 && state.turn == Red && state.seed == 42 && state.draws == 70000);
+	assert(state.position.red == ((board::startPosition().red & ~(1u << 9)) | (1u << 13)));
+	assert(state.position.black >> 18 & 1u);
+
+	// Test case 2: a torn record at the end is ignored
+	bytes += '\x01';
+	assert(replay(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size(), &state));
+	assert(state.history.size() == 2);
+
+	// Test case 3: data that is not a journal is rejected
+	assert(!replay(reinterpret_cast<const std::uint8_t*>("CKSV1234"), 8, &state));
+
+	// Test case 4: a discarded journal is deleted
+	assert(writer.open(path, start));
+	writer.discard();
+	assert(!std::ifstream(path).is_open());
+
+	std::cout << "journal(): All test cases passed!\n";
+}
 
-std::vector<Square> checkers::squares(32, Square(' ', "a1", '1')); //initialized to "a1" and '1' to get through 
-//constructor's error handling
-std::string checkers::selection = " "; //all input by the user is held by this variable
-char checkers::turn = ' '; //either 'r' (Red) or 'b' (Black)
-char checkers::captureDirection = ' '; //either 'R' (right) or 'L' (left)
-char checkers::initialRowParity = ' '; //either 'O' (odd) or 'E' (even)
-bool checkers::wasCapture = false; //was there a capture this turn?
-//used to determine whether to check for consecutive capture
-char checkers::loser = ' '; //either 'r' (Red) or 'b' (Black)
-//who is the loser?
+namespace {
+	//diagonal neighbours of every square: up-left, up-right, down-left, down-right (-1 if off the board)
+	struct Diagonals {
+		int step[32][4];
+		int jump[32][4];
+		Diagonals() {
+			const int dRow[4] = { 1, 1, -1, -1 }, dCol[4] = { -1, 1, -1, 1 };
+			for (int i = 0; i < 32; ++i)
+				for (int d = 0; d < 4; ++d)
+				{
+					step[i][d] = board::neighbor(i, dRow[d], dCol[d]);
+					jump[i][d] = board::neighbor(i, 2 * dRow[d], 2 * dCol[d]);
+				}
+		}
+	};
+	const Diagonals diagonals;
+
+	class BitWriter {
+	public:
+		explicit BitWriter(std::vector<std::uint8_t>* out_) : out(out_) {}
+		//writes the lowest 'bits' bits of value, highest first
+		void put(std::uint32_t value, int bits) {
+			for (int i = bits - 1; i >= 0; --i)
+			{
+				if (used == 0) out->push_back(0);
+				out->back() |= static_cast<std::uint8_t>((value >> i & 1u) << used);
+				used = (used + 1) & 7;
+			}
+		}
+	private:
+		std::vector<std::uint8_t>* out;
+		int used = 0;
+	};
 
-int checkers::selector = 0;
-//for vector location:
-int checkers::selected = 0; //holds vector address of square of selected piece
-int checkers::targeted = 0; //holds vector address of square to move a piece to
-int checkers::inBetween = 0; //holds vector address of square in between the
-//selected and targeted squares (in case of capture)
+	class BitReader {
+	public:
+		BitReader(const std::uint8_t* data_, std::size_t size_) : data(data_), size(size_) {}
+		bool get(int bits, std::uint32_t* value) {
+			*value = 0;
+			for (int i = 0; i < bits; ++i, ++pos)
+			{
+				if (pos >> 3 >= size) return false;
+				*value = *value << 1 | (data[pos >> 3] >> (pos & 7) & 1u);
+			}
+			return true;
+		}
+		std::size_t bytesUsed() const { return (pos + 7) >> 3; }
+	private:
+		const std::uint8_t* data;
+		std::size_t size;
+		std::size_t pos = 0;
+	};
 
-int main()
-try {
-	static bool test_run = false;
-	if (!test_run)
-	{
-		Run_All_Tests();
-		test_run = true;
-		system("cls");
+	int floorLog2(std::uint32_t n) {
+		int k = 0;
+		while (n >>= 1) ++k;
+		return k;
 	}
-	displayMenu();
-	std::cout << ">> ";
-	std::cin >> selection;
-	//new game
-	if (selection == "1")
-	{
-		displayMods();
-		std::cout << ">> ";
-		std::cin >> selection;
-		if (selection == "1" || selection == "2" || selection == "3")
+
+	void putIndex(BitWriter& bits, int index, int count, movecodec::Coding coding) {
+		if (coding == movecodec::Coding::Ranked)
 		{
-			//int selector = std::stoi(selection);
-			selector = std::stoi(selection);
-			prepareGame();
-			checkersGame(selector);
+			//Elias gamma of index + 1: k zeros, then its k + 1 significant bits
+			const std::uint32_t value = static_cast<std::uint32_t>(index) + 1;
+			bits.put(value, 2 * floorLog2(value) + 1);
+			return;
 		}
+		//truncated binary: the first 'shortCodes' indices take one bit less
+		const int k = floorLog2(static_cast<std::uint32_t>(count));
+		const int shortCodes = (2 << k) - count;
+		if (index < shortCodes) bits.put(static_cast<std::uint32_t>(index), k);
+		else bits.put(static_cast<std::uint32_t>(index + shortCodes), k + 1);
+	}
 
+	bool getIndex(BitReader& bits, int count, movecodec::Coding coding, int* index) {
+		std::uint32_t bit = 0, value = 0;
+		if (coding == movecodec::Coding::Ranked)
+		{
+			int k = 0;
+			while (bits.get(1, &bit) && bit == 0)
+				if (++k > 6) return false;
+			if (bit == 0) return false;
+			if (!bits.get(k, &value)) return false;
+			*index = static_cast<int>(value | 1u << k) - 1;
+			return *index < count;
+		}
+		const int k = floorLog2(static_cast<std::uint32_t>(count));
+		const int shortCodes = (2 << k) - count;
+		if (!bits.get(k, &value)) return false;
+		if (static_cast<int>(value) >= shortCodes)
+		{
+			//not a short code: it continues with one more bit
+			if (!bits.get(1, &bit)) return false;
+			value = (value << 1 | bit) - shortCodes;
+		}
+		*index = static_cast<int>(value);
+		return *index < count;
 	}
-	//load previous game
-	else if (selection == "2")
+}
+
+bool movecodec::isValid(const board::Position& pos, char turn) {
+	return (pos.red & pos.black) == 0 && (pos.kings & ~(pos.red | pos.black)) == 0
+		&& board::countBits(pos.red) <= maxPieces && board::countBits(pos.black) <= maxPieces
+		&& (turn == Red || turn == Black);
+}
+
+int movecodec::legalHops(const board::Position& pos, char turn, int from, board::Hop* out, int capacity) {
+	const std::uint32_t own = turn == Red ? pos.red : pos.black;
+	const std::uint32_t other = turn == Red ? pos.black : pos.red;
+	const std::uint32_t empty = ~(pos.red | pos.black);
+	const int firstDir = turn == Red ? 0 : 2; //men only move forward
+	int count = 0;
+
+	//jumps first, then steps
+	for (int kind = 0; kind < 2; ++kind)
 	{
-		if (!loadGame(&squares, &turn, &selector)) { main(); }
-		checkersGame(selector);
+		if (kind == 1 && from >= 0) break; //a piece that has jumped may only jump again
+		for (std::uint32_t pieces = from >= 0 ? 1u << from : own; pieces; pieces &= pieces - 1)
+		{
+			const int sq = board::lowestBit(pieces);
+			const bool king = (pos.kings >> sq & 1u) != 0;
+			for (int d = king ? 0 : firstDir; d < (king ? 4 : firstDir + 2); ++d)
+			{
+				const int over = diagonals.step[sq][d];
+				const int to = kind == 0 ? diagonals.jump[sq][d] : over;
+				if (to < 0 || !(empty >> to & 1u)) continue;
+				if (kind == 0 && !(other >> over & 1u)) continue;
+				if (count == capacity) return count;
+				out[count++] = { static_cast<std::uint8_t>(sq), static_cast<std::uint8_t>(to) };
+			}
+		}
 	}
-	//display help
-	else if (selection == "3")
+	return count;
+}
+
+bool movecodec::encode(const board::Position& start, char startTurn, const std::vector<board::Hop>& hops,
+	Coding coding, std::vector<std::uint8_t>* out) {
+	if (!isValid(start, startTurn)) return false;
+	for (std::uint32_t n = static_cast<std::uint32_t>(hops.size()); ; n >>= 7)
 	{
-		displayHelp(); main();
+		out->push_back(static_cast<std::uint8_t>((n & 0x7F) | (n > 0x7F ? 0x80 : 0)));
+		if (n <= 0x7F) break;
 	}
-	//exit
-	else if (selection == "4")
+
+	BitWriter bits(out);
+	board::Position pos = start;
+	char turn = startTurn;
+	int from = -1; //piece that has to continue the turn, or -1
+	board::Hop list[maxHops];
+	for (size_t i = 0; i < hops.size(); )
 	{
-		return 0;
+		const int count = legalHops(pos, turn, from, list, maxHops);
+		//in the middle of a turn choice 0 ends it
+		const int offset = from >= 0 ? 1 : 0;
+		int index = from >= 0 ? 0 : -1; //no matching jump: the piece stopped
+		for (int j = 0; j < count; ++j)
+			if (list[j].from == hops[i].from && list[j].to == hops[i].to) index = j + offset;
+		if (index < 0) return false;
+		if (from < 0 || count > 0) putIndex(bits, index, count + offset, coding);
+
+		if (index < offset)
+		{
+			turn = turn == Red ? Black : Red;
+			from = -1;
+			continue;
+		}
+		board::applyHop(&pos, hops[i]);
+		from = board::isJump(hops[i]) ? hops[i].to : -1;
+		if (from < 0) turn = turn == Red ? Black : Red;
+		++i;
 	}
-	else if (selection == "h" || selection == "help")
+	return true;
+}
+
+std::size_t movecodec::decode(const std::uint8_t* data, std::size_t size, const board::Position& start, char startTurn,
+	Coding coding, std::vector<board::Hop>* hops) {
+	hops->clear();
+	if (!isValid(start, startTurn)) return 0;
+	std::uint32_t n = 0;
+	std::size_t header = 0;
+	for (int shift = 0; ; shift += 7)
 	{
-		displayHelp(); main();
+		if (header >= size || shift > 28) return 0;
+		n |= static_cast<std::uint32_t>(data[header] & 0x7F) << shift;
+		if (!(data[header++] & 0x80)) break;
 	}
-	else
+
+	BitReader bits(data + header, size - header);
+	board::Position pos = start;
+	char turn = startTurn;
+	int from = -1;
+	board::Hop list[maxHops];
+	hops->reserve(n);
+	while (hops->size() < n)
 	{
-		std::cout << "Invalid input.\n";
-		main();
+		const int count = legalHops(pos, turn, from, list, maxHops);
+		const int offset = from >= 0 ? 1 : 0;
+		int index = 0;
+		if (from < 0 || count > 0)
+		{
+			if (!getIndex(bits, count + offset, coding, &index)) return 0;
+		}
+		if (index < offset)
+		{
+			turn = turn == Red ? Black : Red;
+			from = -1;
+			continue;
+		}
+		const board::Hop hop = list[index - offset];
+		board::applyHop(&pos, hop);
+		hops->push_back(hop);
+		from = board::isJump(hop) ? hop.to : -1;
+		if (from < 0) turn = turn == Red ? Black : Red;
 	}
-	return 0;
+	return header + bits.bytesUsed();
 }
-catch (std::string message) {
-	std::cerr << message << '\n';
-	exit();
-	return 1;
+
+void movecodec::movecodec_Test()
+{
+	const board::Position start = board::startPosition();
+	board::Hop list[maxHops];
+
+	// Test case 1: seven steps and no jumps at the start
+	assert(legalHops(start, Red, -1, list, maxHops) == 7);
+	assert(legalHops(start, Black, -1, list, maxHops) == 7);
+
+	// Test case 2: jumps are listed first
+	board::Position pos = start;
+	board::applyHop(&pos, { 9, 13 });  // c3-d4
+	board::applyHop(&pos, { 22, 18 }); // f6-e5
+	assert(legalHops(pos, Red, -1, list, maxHops) > 1 && list[0].from == 13 && list[0].to == 22);
+
+	// Test case 3: random games round-trip with both codings, including stopped capture chains
+	prng::Rng gen(7);
+	for (int g = 0; g < 20; ++g)
+	{
+		std::vector<board::Hop> game;
+		pos = start;
+		char turn = Red;
+		int from = -1;
+		while (game.size() < 150)
+		{
+			const int count = legalHops(pos, turn, from, list, maxHops);
+			if (count == 0 && from < 0) break;
+			if (count == 0 || (from >= 0 && gen.below(3) == 0))
+			{
+				turn = turn == Red ? Black : Red;
+				from = -1;
+				continue;
+			}
+			const board::Hop hop = list[gen.below(count)];
+			board::applyHop(&pos, hop);
+			game.push_back(hop);
+			from = board::isJump(hop) ? hop.to : -1;
+			if (from < 0) turn = turn == Red ? Black : Red;
+		}
+		for (Coding coding : { Coding::Fixed, Coding::Ranked })
+		{
+			std::vector<std::uint8_t> bytes;
+			assert(encode(start, Red, game, coding, &bytes));
+			std::vector<board::Hop> decoded;
+			assert(decode(bytes.data(), bytes.size(), start, Red, coding, &decoded) == bytes.size());
+			assert(decoded.size() == game.size());
+			for (size_t i = 0; i < game.size(); ++i)
+				assert(decoded[i].from == game[i].from && decoded[i].to == game[i].to);
+			if (coding == Coding::Fixed) assert(bytes.size() <= 2 + game.size() * 6 / 8); //at most 6 bits a hop
+		}
+	}
+
+	// Test case 4: an illegal hop cannot be encoded, truncated data cannot be decoded
+	std::vector<std::uint8_t> bytes;
+	assert(!encode(start, Red, { { 9, 17 } }, Coding::Fixed, &bytes));
+	bytes.clear();
+	assert(encode(start, Red, { { 9, 13 }, { 22, 18 } }, Coding::Fixed, &bytes));
+	std::vector<board::Hop> decoded;
+	assert(decode(bytes.data(), 1, start, Red, Coding::Fixed, &decoded) == 0);
+
+	// Test case 5: a side with more than 12 pieces is refused, and its list is cut at the capacity
+	board::Position crowded;
+	crowded.red = crowded.kings = 0xF0F0F0F0u; //16 kings with 49 hops
+	assert(isValid(start, Red) && !isValid(crowded, Red) && !isValid(start, 'x'));
+	assert(legalHops(crowded, Red, -1, list, maxHops) == maxHops);
+	assert(!encode(crowded, Red, { { 4, 9 } }, Coding::Fixed, &bytes));
+	assert(decode(bytes.data(), bytes.size(), crowded, Red, Coding::Fixed, &decoded) == 0);
+
+	std::cout << "movecodec(): All test cases passed!\n";
 }
-catch (...) {
-	std::cerr << "Unknown exception\n";
-	exit();
-	return 2;
+
+void poscodec::encodeFixed(const Record* records, std::size_t count, std::uint8_t* out) {
+	for (std::size_t i = 0; i < count; ++i, out += fixedSize)
+	{
+		const std::uint32_t masks[3] = { records[i].position.red, records[i].position.black, records[i].position.kings };
+		for (int m = 0; m < 3; ++m)
+		{
+			out[4 * m] = static_cast<std::uint8_t>(masks[m]);
+			out[4 * m + 1] = static_cast<std::uint8_t>(masks[m] >> 8);
+			out[4 * m + 2] = static_cast<std::uint8_t>(masks[m] >> 16);
+			out[4 * m + 3] = static_cast<std::uint8_t>(masks[m] >> 24);
+		}
+		out[12] = static_cast<std::uint8_t>(records[i].turn);
+	}
 }
 
-void abcd()
-{
-	std::cout << "abcd";
+void poscodec::decodeFixed(const std::uint8_t* data, std::size_t count, Record* records) {
+	for (std::size_t i = 0; i < count; ++i, data += fixedSize)
+	{
+		std::uint32_t masks[3];
+		for (int m = 0; m < 3; ++m)
+			masks[m] = data[4 * m] | data[4 * m + 1] << 8 | data[4 * m + 2] << 16 | static_cast<std::uint32_t>(data[4 * m + 3]) << 24;
+		records[i].position = { masks[0], masks[1], masks[2] };
+		records[i].turn = static_cast<char>(data[12]);
+	}
 }
 
-void Run_All_Tests()
-{
-	isSquare_Test();
-	reverseCrown_Test();
-	possibleMovement_Test();
-	goodSquare_Test();
-	goodTarget_Test();
-	oneFrSqAway_Test();
-	oneBcSqAway_Test();
-	twoFrSqAway_Test();
-	twoBcSqAway_Test();
-	getAddress_Test();
-	getLetCoordinate_Test();
-	getSqInBetween_Test();
-	getCapDirection_Test();
-	getRowParity_Test();
-	upCapture_Test();
-	downCapture_Test();
-	R_Capture1_Test();
-	R_Capture2_Test();
-	R_Capture3_Test();
-	R_Capture4_Test();
-	B_Capture1_Test();
-	B_Capture2_Test();
-	B_Capture3_Test();
-	B_Capture4_Test();
-	oppoColor_Test();
-	isCapture_Test();
-	isPromotion_Test();
-	possibleCapture_Test();
-	goodConsecutiveJmpTarget_Test();
-	gameOver_Test();
-	shuffleArray_Test();
+void poscodec::encodeVariable(const Record* records, std::size_t count, std::vector<std::uint8_t>* out) {
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const board::Position& pos = records[i].position;
+		const std::uint32_t occupied = pos.red | pos.black;
+		//gather the bits in a 128-bit accumulator (at most 2 + 32 + 24 + 24 bits)
+		std::uint64_t bits[2] = { 0, 0 };
+		int used = 0;
+		auto put = [&](std::uint64_t value, int count_) {
+			bits[used >> 6] |= value << (used & 63);
+			if ((used & 63) + count_ > 64) bits[1] |= value >> (64 - (used & 63));
+			used += count_;
+		};
+		put(records[i].turn == Black ? 1 : 0, 1);
+		put(pos.kings ? 1 : 0, 1);
+		put(occupied, 32);
+		for (std::uint32_t rest = occupied; rest; rest &= rest - 1)
+			put(pos.black >> board::lowestBit(rest) & 1u, 1);
+		if (pos.kings)
+			for (std::uint32_t rest = occupied; rest; rest &= rest - 1)
+				put(pos.kings >> board::lowestBit(rest) & 1u, 1);
+		for (int b = 0; b < used; b += 8)
+			out->push_back(static_cast<std::uint8_t>(bits[b >> 6] >> (b & 63)));
+	}
+}
 
-	std::cout << "All tests passed!\n";
-	Sleep(1500);
+std::size_t poscodec::decodeVariable(const std::uint8_t* data, std::size_t size, std::size_t count, Record* records) {
+	std::size_t offset = 0;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		//occupancy sits in bits 2-33, so the first 5 bytes give the piece count
+		if (size - offset < 5) return 0;
+		const std::uint8_t* p = data + offset;
+		const std::uint64_t head = p[0] | p[1] << 8 | p[2] << 16 | static_cast<std::uint64_t>(p[3]) << 24 | static_cast<std::uint64_t>(p[4]) << 32;
+		const bool kings = (head >> 1 & 1u) != 0;
+		const std::uint32_t occupied = static_cast<std::uint32_t>(head >> 2);
+		int pieces = 0;
+		for (std::uint32_t rest = occupied; rest; rest &= rest - 1) ++pieces;
+		const std::size_t bytes = (34 + pieces * (kings ? 2 : 1) + 7) / 8;
+		if (size - offset < bytes) return 0;
+
+		auto bit = [p](int index) { return p[index >> 3] >> (index & 7) & 1u; };
+		board::Position pos;
+		int index = 34;
+		for (std::uint32_t rest = occupied; rest; rest &= rest - 1, ++index)
+		{
+			const std::uint32_t square = rest & (0u - rest);
+			if (bit(index)) pos.black |= square; else pos.red |= square;
+			if (kings && bit(index + pieces)) pos.kings |= square;
+		}
+		records[i].position = pos;
+		records[i].turn = (head & 1u) ? Black : Red;
+		offset += bytes;
+	}
+	return offset;
 }
 
-void Square::changeColor(char newColor) {
-	if (c != newColor) c = newColor;
+#ifdef CHECKERS_SSE2
+namespace {
+	//spreads a 32-bit mask into two vectors of 16 bytes, 0xFF where the bit is set
+	inline void spreadMask(std::uint32_t mask, __m128i* low, __m128i* high) {
+		const __m128i select = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+		__m128i bytes = _mm_cvtsi32_si128(static_cast<int>(mask));
+		bytes = _mm_unpacklo_epi8(bytes, bytes);   //b0 b0 b1 b1 b2 b2 b3 b3
+		bytes = _mm_unpacklo_epi16(bytes, bytes);  //b0 x4, b1 x4, b2 x4, b3 x4
+		*low = _mm_unpacklo_epi32(bytes, bytes);   //b0 x8, b1 x8
+		*high = _mm_unpackhi_epi32(bytes, bytes);  //b2 x8, b3 x8
+		*low = _mm_cmpeq_epi8(_mm_and_si128(*low, select), select);
+		*high = _mm_cmpeq_epi8(_mm_and_si128(*high, select), select);
+	}
 }
 
-Square::Square() {
-	c = ' ';
-	s = "a1";
-	r = '1';
-	frtAdjSqs = setFrtAdjSqs(s);
-	bacAdjSqs = setBacAdjSqs(s);
-	frtJmpSqs = setFrtJmpSqs(s);
-	bacJmpSqs = setBacJmpSqs(s);
-	crowned = false;
-	captured = false;
-	return;
+void poscodec::expand(const Record* records, std::size_t count, std::uint8_t* squares) {
+	const __m128i one = _mm_set1_epi8(1), three = _mm_set1_epi8(3);
+	for (std::size_t i = 0; i < count; ++i, squares += 32)
+	{
+		__m128i red[2], black[2], kings[2];
+		spreadMask(records[i].position.red, &red[0], &red[1]);
+		spreadMask(records[i].position.black, &black[0], &black[1]);
+		spreadMask(records[i].position.kings, &kings[0], &kings[1]);
+		for (int h = 0; h < 2; ++h)
+		{
+			//red man 1, black man 3, plus one for a king
+			__m128i code = _mm_or_si128(_mm_and_si128(red[h], one), _mm_and_si128(black[h], three));
+			code = _mm_add_epi8(code, _mm_and_si128(kings[h], one));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(squares + 16 * h), code);
+		}
+	}
+}
+#else
+void poscodec::expand(const Record* records, std::size_t count, std::uint8_t* squares) {
+	for (std::size_t i = 0; i < count; ++i, squares += 32)
+	{
+		const board::Position& pos = records[i].position;
+		for (int sq = 0; sq < 32; ++sq)
+			squares[sq] = static_cast<std::uint8_t>((pos.red >> sq & 1u) + 3 * (pos.black >> sq & 1u) + (pos.kings >> sq & 1u));
+	}
 }
+#endif
 
-Square::Square(char c_, std::string s_, char r_)
-	:c(c_), s(s_), r(r_)
+void poscodec::poscodec_Test()
 {
-	//the 5 vector members (frtAdjSqs, bacAdjSqs, etc.) are
-	//not in the arguments because they are dependent on std::string s_
+	Record records[3];
+	records[0].position = board::startPosition();
+	records[1].position = { 1u << 13, (1u << 22) | (1u << 2), (1u << 2) }; // d4, f6 and a black king on e1
+	records[1].turn = Black;
+	records[2].position = { 0xFFFu, 0xFFF00000u, 0xF00000F0u };           // 24 pieces, eight kings
+
+	// Test case 1: the fixed encoding round-trips
+	std::uint8_t fixed[3 * fixedSize];
+	encodeFixed(records, 3, fixed);
+	assert(fixed[0] == 0xFF && fixed[1] == 0x0F && fixed[7] == 0xFF && fixed[12] == Red);
+	Record decoded[3];
+	decodeFixed(fixed, 3, decoded);
+	for (int i = 0; i < 3; ++i)
+		assert(decoded[i].position.red == records[i].position.red && decoded[i].position.black == records[i].position.black
+			&& decoded[i].position.kings == records[i].position.kings && decoded[i].turn == records[i].turn);
+
+	// Test case 2: the variable encoding round-trips and is smaller
+	std::vector<std::uint8_t> variable;
+	encodeVariable(records, 3, &variable);
+	assert(variable.size() == 8 + 5 + maxVariableSize);
+	assert(decodeVariable(variable.data(), variable.size(), 3, decoded) == variable.size());
+	for (int i = 0; i < 3; ++i)
+		assert(decoded[i].position.red == records[i].position.red && decoded[i].position.black == records[i].position.black
+			&& decoded[i].position.kings == records[i].position.kings && decoded[i].turn == records[i].turn);
+	assert(decodeVariable(variable.data(), 10, 2, decoded) == 0);
+
+	// Test case 3: squares are expanded to piece codes
+	std::uint8_t squares[2 * 32];
+	expand(records, 2, squares);
+	assert(squares[0] == 1 && squares[12] == 0 && squares[31] == 3);
+	assert(squares[32 + 13] == 1 && squares[32 + 22] == 3 && squares[32 + 2] == 4 && squares[32 + 0] == 0);
+
+	std::cout << "poscodec(): All test cases passed!\n";
+}
 
-	//check for constructor errors:
-	if (c_ != Red && c_ != cRed && c_ != Black && c_ != cBlack && c_ != ' ')
-		error("Exception: constructor use without correct color ('r','R','b','B',' ')");
-	if (!isSquare(s_))
-		error("Exception: constructor use without correct square");
-	switch (r_) {
-	case '1': case '2': case '3': case '4':
-	case '5': case '6': case '7': case '8':
-		break;
-	default:
-		error("Exception: constructor use without correct row");
+bool render::enableAnsi() {
+	static const bool enabled = [] {
+#ifdef _WIN32
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004 //older SDKs
+#endif
+		HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+		DWORD mode = 0;
+		if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) return false;
+		return SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+		const char* term = std::getenv("TERM");
+		return isatty(STDOUT_FILENO) && term && std::string(term) != "dumb";
+#endif
+	}();
+	return enabled;
+}
+
+void render::clearScreen() {
+	if (enableAnsi()) std::cout << "\x1b[H\x1b[2J" << std::flush;
+}
+
+namespace {
+	//the board text: a blank line, then for every row from 8 to 1 a line with the
+	//pieces and a line with the row number, then the column letters
+	const int boardLines = 19;
+
+	//screen line and column (1-based) of the piece of a square
+	int cellLine(int index) { return 2 + 2 * (7 - index / 4); }
+	int cellColumn(int index) { return (index / 4) % 2 ? 8 + 8 * (index % 4) : 4 + 8 * (index % 4); }
+
+	void appendNumber(std::string* frame, int n) {
+		if (n >= 10) frame->push_back(static_cast<char>('0' + n / 10));
+		frame->push_back(static_cast<char>('0' + n % 10));
 	}
+}
 
-	//initialize 7 other members
-	frtAdjSqs = setFrtAdjSqs(s);
-	bacAdjSqs = setBacAdjSqs(s);
-	frtJmpSqs = setFrtJmpSqs(s);
-	bacJmpSqs = setBacJmpSqs(s);
-	if (c_ == cRed || c_ == cBlack)
-		crowned = true; //'R' and 'B' indicate the piece is crowned
-	else
-		crowned = false;  //'r' and 'b' (and ' ') indicate the piece is uncrowned
-	captured = false;
-	return;
+render::Renderer::Renderer() {
+	frame.reserve(1024);
+	ansi = enableAnsi();
 }
 
-std::vector<std::string> Square::setFrtAdjSqs(std::string sq) {
-	//sets std::vector<std::string> frtAdjSqs
+void render::Renderer::draw(const std::vector<Square>& sqVect, std::ostream& out) {
+	frame.clear();
+	if (ansi) frame += "\x1b[H\x1b[2J"; //cursor home, clear screen
+	frame += '\n';
+	for (int row = 7; row >= 0; --row)
+	{
+		frame += row % 2 ? "     | " : "   ";
+		for (int k = 0; k < 4; ++k)
+		{
+			const char c = sqVect[row * 4 + k].color();
+			shown[row * 4 + k] = c;
+			frame += c;
+			if (row % 2) frame += k < 3 ? " |   | " : "\n";
+			else frame += k < 3 ? " |   | " : " |\n";
+		}
+		frame += static_cast<char>('1' + row);
+		frame += " ___|___|___|___|___|___|___|___\n";
+	}
+	frame += "   a   b   c   d   e   f   g   h \n\n";
+	out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+	out.flush();
+	onScreen = ansi;
+}
 
-	std::vector<std::string> sqs(2, " "); //holds the squares to give to frtAdjSqs
+void render::Renderer::update(const std::vector<Square>& sqVect, std::ostream& out) {
+	if (!onScreen)
+	{
+		draw(sqVect, out);
+		return;
+	}
+	frame.clear();
+	for (int i = 0; i < 32; ++i)
+	{
+		const char c = sqVect[i].color();
+		if (c == shown[i]) continue;
+		shown[i] = c;
+		//move the cursor to the square: ESC [ line ; column H
+		frame += "\x1b[";
+		appendNumber(&frame, cellLine(i));
+		frame += ';';
+		appendNumber(&frame, cellColumn(i));
+		frame += 'H';
+		frame += c;
+	}
+	frame += "\x1b[";
+	appendNumber(&frame, boardLines + 1);
+	frame += ";1H\x1b[J"; //below the board, clear what was printed there
+	out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+	out.flush();
+}
 
-	if (sq == "a1") { sqs[0] = "b2"; return sqs; }
-	if (sq == "a3") { sqs[0] = "b4"; return sqs; }
-	if (sq == "a5") { sqs[0] = "b6"; return sqs; }
-	if (sq == "a7") { sqs[0] = "b8"; return sqs; }
+render::Renderer render::screen;
 
-	if (sq == "b2") { sqs[0] = "a3"; sqs[1] = "c3"; return sqs; }
-	if (sq == "b4") { sqs[0] = "a5"; sqs[1] = "c5"; return sqs; }
-	if (sq == "b6") { sqs[0] = "a7"; sqs[1] = "c7"; return sqs; }
-	if (sq == "b8") return sqs;	//a piece on b8 cannot move forward
+void render::render_Test()
+{
+	prepareGame();
+	std::ostringstream out;
+	Renderer renderer;
+
+	// Test case 1: the frame matches the board layout
+	renderer.draw(squares, out);
+	std::string frame = renderer.lastFrame();
+	if (frame.compare(0, 2, "\x1b[") == 0) frame.erase(0, frame.find('J') + 1);
+	std::istringstream lines(frame);
+	std::string line;
+	std::vector<std::string> board;
+	while (std::getline(lines, line)) board.push_back(line);
+	assert(board.size() == 19);
+	assert(board[1] == "     | b |   | b |   | b |   | b" && board[16] == "1 ___|___|___|___|___|___|___|___");
+	assert(board[15] == "   r |   | r |   | r |   | r |" && board[17] == "   a   b   c   d   e   f   g   h ");
+
+	// Test case 2: squares are found where the frame puts them
+	for (int i = 0; i < 32; ++i)
+		assert(board[cellLine(i) - 1][cellColumn(i) - 1] == squares[i].color());
+
+	// Test case 3: an update rewrites only changed squares (with cursor addressing)
+	squares[9].changeColor(' ');
+	squares[13].changeColor(Red);
+	renderer.update(squares, out);
+	if (enableAnsi())
+		assert(renderer.lastFrame() == "\x1b[12;12H \x1b[10;16Hr\x1b[20;1H\x1b[J");
 
-	if (sq == "c1") { sqs[0] = "b2"; sqs[1] = "d2"; return sqs; }
-	if (sq == "c3") { sqs[0] = "b4"; sqs[1] = "d4"; return sqs; }
-	if (sq == "c5") { sqs[0] = "b6"; sqs[1] = "d6"; return sqs; }
-	if (sq == "c7") { sqs[0] = "b8"; sqs[1] = "d8"; return sqs; }
+	prepareGame();
+	std::cout << "render(): All test cases passed!\n";
+}
 
-	if (sq == "d2") { sqs[0] = "c3"; sqs[1] = "e3"; return sqs; }
-	if (sq == "d4") { sqs[0] = "c5"; sqs[1] = "e5"; return sqs; }
-	if (sq == "d6") { sqs[0] = "c7"; sqs[1] = "e7"; return sqs; }
-	if (sq == "d8") return sqs;	//a piece on d8 cannot move forward
+void render::Spectator::start(const std::vector<Square>& board_, std::ostream& out_, int fps) {
+	stop();
+	board = board_;
+	out = &out_;
+	frames = 0;
+	renderer.invalidate();
+	running = true;
+	thread = std::thread(&Spectator::run, this, fps);
+}
 
-	if (sq == "e1") { sqs[0] = "d2"; sqs[1] = "f2"; return sqs; }
-	if (sq == "e3") { sqs[0] = "d4"; sqs[1] = "f4"; return sqs; }
-	if (sq == "e5") { sqs[0] = "d6"; sqs[1] = "f6"; return sqs; }
-	if (sq == "e7") { sqs[0] = "d8"; sqs[1] = "f8"; return sqs; }
+void render::Spectator::stop() {
+	if (!thread.joinable()) return;
+	running = false;
+	thread.join();
+	drawLatest();
+}
 
-	if (sq == "f2") { sqs[0] = "e3"; sqs[1] = "g3"; return sqs; }
-	if (sq == "f4") { sqs[0] = "e5"; sqs[1] = "g5"; return sqs; }
-	if (sq == "f6") { sqs[0] = "e7"; sqs[1] = "g7"; return sqs; }
-	if (sq == "f8") return sqs;	//a piece on f8 cannot move forward
+void render::Spectator::run(int fps) {
+	const auto frame = std::chrono::microseconds(1000000 / (fps > 0 ? fps : 30));
+	auto next = std::chrono::steady_clock::now();
+	while (running)
+	{
+		drawLatest();
+		next += frame;
+		std::this_thread::sleep_until(next);
+	}
+}
 
-	if (sq == "g1") { sqs[0] = "f2"; sqs[1] = "h2"; return sqs; }
-	if (sq == "g3") { sqs[0] = "f4"; sqs[1] = "h4"; return sqs; }
-	if (sq == "g5") { sqs[0] = "f6"; sqs[1] = "h6"; return sqs; }
-	if (sq == "g7") { sqs[0] = "f8"; sqs[1] = "h8"; return sqs; }
+bool render::Spectator::drawLatest() {
+	Snapshot snapshot;
+	if (!mailbox.take(&snapshot)) return false;
+	board::fromPosition(snapshot.position, &board);
+	renderer.update(board, *out);
+	status = "Hops: " + std::to_string(snapshot.hops) + ", turn: " + snapshot.turn + "   \n";
+	out->write(status.data(), static_cast<std::streamsize>(status.size()));
+	out->flush();
+	++frames;
+	return true;
+}
 
-	if (sq == "h2") { sqs[0] = "g3"; return sqs; }
-	if (sq == "h4") { sqs[0] = "g5"; return sqs; }
-	if (sq == "h6") { sqs[0] = "g7"; return sqs; }
-	if (sq == "h8") return sqs;	//a piece on h8 cannot move forward
+void render::spectator_Test()
+{
+	// Test case 1: the mailbox keeps only the latest value
+	Mailbox<int> box;
+	int value = 0;
+	assert(!box.take(&value));
+	box.publish(1); box.publish(2); box.publish(3);
+	assert(box.take(&value) && value == 3);
+	assert(!box.take(&value));
+	box.publish(4);
+	assert(box.take(&value) && value == 4);
+
+	// Test case 2: a reader on another thread never sees a torn or older value
+	Mailbox<Snapshot> snapshots;
+	std::atomic<bool> done(false);
+	bool ordered = true;
+	std::uint32_t last = 0;
+	std::thread reader([&] {
+		Snapshot s;
+		const auto check = [&] {
+			if (s.hops < last || s.position.red != s.hops || s.position.black != ~s.hops) ordered = false;
+			last = s.hops;
+		};
+		for (;;)
+		{
+			if (!snapshots.take(&s))
+			{
+				if (done) break;
+				std::this_thread::yield();
+				continue;
+			}
+			check();
+		}
+		//the last value may have been published just before done was set
+		while (snapshots.take(&s)) check();
+	});
+	for (std::uint32_t i = 1; i <= 100000; ++i)
+	{
+		Snapshot s;
+		s.position.red = i; s.position.black = ~i; s.hops = i;
+		snapshots.publish(s);
+	}
+	done = true;
+	reader.join();
+	assert(ordered && last == 100000);
 
-	error("Exception: constructor use without an accessible square");
+	// Test case 3: the spectator draws the last published position when stopped
+	prepareGame();
+	std::ostringstream out;
+	Spectator spectator;
+	spectator.start(squares, out, 30);
+	Snapshot s;
+	s.position = board::startPosition();
+	s.hops = 7;
+	spectator.publish(s);
+	spectator.stop();
+	assert(spectator.framesDrawn() >= 1 && out.str().find("Hops: 7, turn: r") != std::string::npos);
+
+	std::cout << "spectator(): All test cases passed!\n";
 }
 
-std::vector<std::string> Square::setBacAdjSqs(std::string sq) {
-	//sets std::vector<std::string> bacAdjSqs
+bool script::play(std::string_view moves, Game* game, std::string* error) {
+	board::Hop list[movecodec::maxHops];
+	std::size_t pos = 0;
+	while (true)
+	{
+		while (pos < moves.size() && std::isspace(static_cast<unsigned char>(moves[pos]))) ++pos;
+		if (pos == moves.size()) return true;
+		std::size_t end = pos;
+		while (end < moves.size() && !std::isspace(static_cast<unsigned char>(moves[end]))) ++end;
+		const std::string_view move = moves.substr(pos, end - pos);
+		pos = end;
+
+		auto fail = [&](const char* reason) {
+			*error = "move " + std::to_string(game->moves + 1) + " '" + std::string(move) + "': " + reason;
+			return false;
+		};
+		//squares are two characters, separated by one '-' or 'x'
+		if (move.size() < 5 || move.size() % 3 != 2) return fail("expected squares joined by '-' or 'x'");
+		const char separator = move[2];
+		if ((separator != '-' && separator != 'x') || (separator == '-' && move.size() != 5))
+			return fail("expected squares joined by '-' or 'x'");
+
+		if (!movecodec::isValid(game->position, game->turn)) return fail("not a valid position");
+		board::Position next = game->position;
+		int from = board::squareIndex(std::string(move.substr(0, 2)));
+		if (from < 0) return fail("not a square");
+		for (std::size_t i = 3; i < move.size(); i += 3)
+		{
+			if (i > 3 && move[i - 1] != separator) return fail("expected squares joined by '-' or 'x'");
+			const int to = board::squareIndex(std::string(move.substr(i, 2)));
+			if (to < 0) return fail("not a square");
+			//the first hop may be any legal hop, later ones only jumps of the same piece
+			const int count = movecodec::legalHops(next, game->turn, i == 3 ? -1 : from, list, movecodec::maxHops);
+			const board::Hop* hop = std::find_if(list, list + count,
+				[&](const board::Hop& h) { return h.from == from && h.to == to; });
+			if (hop == list + count || board::isJump(*hop) != (separator == 'x')) return fail("illegal move");
+			board::applyHop(&next, *hop);
+			from = to;
+		}
+		game->position = next;
+		game->turn = game->turn == Red ? Black : Red;
+		++game->moves;
+	}
+}
 
-	std::vector<std::string> sqs(2, " "); //holds the squares to give to bacAdjSqs
+std::string script::outcome(const Game& game) {
+	board::Hop list[movecodec::maxHops];
+	if (game.position.red == 0) return "black wins";
+	if (game.position.black == 0) return "red wins";
+	if (!movecodec::isValid(game.position, game.turn)) return "not a valid position";
+	if (movecodec::legalHops(game.position, game.turn, -1, list, movecodec::maxHops) == 0)
+		return std::string("draw, ") + (game.turn == Red ? "red" : "black") + " cannot move";
+	return std::string(game.turn == Red ? "red" : "black") + " to move";
+}
 
-	if (sq == "a1") return sqs;	//a piece on a1 cannot move backward
-	if (sq == "a3") { sqs[0] = "b2"; return sqs; }
-	if (sq == "a5") { sqs[0] = "b4"; return sqs; }
-	if (sq == "a7") { sqs[0] = "b6"; return sqs; }
+void script::script_Test()
+{
+	// Test case 1: steps and a jump, as in the game
+	Game game;
+	std::string error;
+	assert(play("c3-d4 f6-e5\nd4xf6 g7xe5", &game, &error));
+	assert(game.moves == 4 && game.turn == Red && outcome(game) == "red to move");
+	assert(!(game.position.red >> 13 & 1u) && (game.position.black >> 18 & 1u));
+
+	// Test case 2: a bad move is reported and leaves the game as it was
+	const board::Position before = game.position;
+	assert(!play("e3-d4 e5xc3 c3xe5", &game, &error) && error.find("move 7 'c3xe5'") == 0);
+	assert(game.moves == 6 && game.position.red != before.red);
+	assert(!play("c3-e5", &game, &error) && !play("b2-c3xd4", &game, &error) && !play("c3", &game, &error));
+
+	// Test case 3: a game is won when a side has no pieces left
+	game = Game();
+	game.position = { 1u << 13, 1u << 18, 0 }; // d4 and e5
+	assert(play("d4xf6", &game, &error) && outcome(game) == "red wins");
+
+	std::cout << "script(): All test cases passed!\n";
+}
 
-	if (sq == "b2") { sqs[0] = "a1"; sqs[1] = "c1"; return sqs; }
-	if (sq == "b4") { sqs[0] = "a3"; sqs[1] = "c3"; return sqs; }
-	if (sq == "b6") { sqs[0] = "a5"; sqs[1] = "c5"; return sqs; }
-	if (sq == "b8") { sqs[0] = "a7"; sqs[1] = "c7"; return sqs; }
+static Protocol_Board toSnapshot(const board::Position& pos, char turn) {
+	Protocol_Board snapshot;
+	snapshot.red = pos.red;
+	snapshot.black = pos.black;
+	snapshot.kings = pos.kings;
+	snapshot.turn = static_cast<std::uint8_t>(turn);
+	return snapshot;
+}
 
-	if (sq == "c1") return sqs;	//a piece on c1 cannot move backward
-	if (sq == "c3") { sqs[0] = "b2"; sqs[1] = "d2"; return sqs; }
-	if (sq == "c5") { sqs[0] = "b4"; sqs[1] = "d4"; return sqs; }
-	if (sq == "c7") { sqs[0] = "b6"; sqs[1] = "d6"; return sqs; }
+std::uint16_t wire::boardHash(const board::Position& pos, char turn) {
+	const Protocol_Board snapshot = toSnapshot(pos, turn);
+	return Protocol_BoardHash(&snapshot);
+}
 
-	if (sq == "d2") { sqs[0] = "c1"; sqs[1] = "e1"; return sqs; }
-	if (sq == "d4") { sqs[0] = "c3"; sqs[1] = "e3"; return sqs; }
-	if (sq == "d6") { sqs[0] = "c5"; sqs[1] = "e5"; return sqs; }
-	if (sq == "d8") { sqs[0] = "c7"; sqs[1] = "e7"; return sqs; }
+std::size_t wire::moveFrame(std::uint8_t seq, std::uint16_t hash, const board::Hop* hops, int count, std::uint8_t* out) {
+	std::uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+	if (count <= 0 || PROTOCOL_HASH_SIZE + 2 * count > static_cast<int>(PROTOCOL_MAX_PAYLOAD)) return 0;
+	payload[0] = static_cast<std::uint8_t>(hash >> 8);
+	payload[1] = static_cast<std::uint8_t>(hash);
+	for (int i = 0; i < count; ++i)
+	{
+		payload[PROTOCOL_HASH_SIZE + 2 * i] = hops[i].from;
+		payload[PROTOCOL_HASH_SIZE + 2 * i + 1] = hops[i].to;
+	}
+	return Protocol_Encode(PROTOCOL_MSG_MOVE, seq, payload, static_cast<std::uint8_t>(PROTOCOL_HASH_SIZE + 2 * count), out);
+}
 
-	if (sq == "e1") return sqs;	//a piece on e1 cannot move backward
-	if (sq == "e3") { sqs[0] = "d2"; sqs[1] = "f2"; return sqs; }
-	if (sq == "e5") { sqs[0] = "d4"; sqs[1] = "f4"; return sqs; }
-	if (sq == "e7") { sqs[0] = "d6"; sqs[1] = "f6"; return sqs; }
+int wire::readMove(const Protocol_Frame& frame, std::uint16_t* hash, board::Hop* hops) {
+	if (frame.type != PROTOCOL_MSG_MOVE || frame.length <= PROTOCOL_HASH_SIZE || frame.length % 2 != 0) return 0;
+	*hash = static_cast<std::uint16_t>(frame.payload[0] << 8 | frame.payload[1]);
+	const int count = (frame.length - PROTOCOL_HASH_SIZE) / 2;
+	for (int i = 0; i < count; ++i)
+	{
+		hops[i].from = frame.payload[PROTOCOL_HASH_SIZE + 2 * i];
+		hops[i].to = frame.payload[PROTOCOL_HASH_SIZE + 2 * i + 1];
+		if (hops[i].from > 31 || hops[i].to > 31) return 0;
+	}
+	return count;
+}
 
-	if (sq == "f2") { sqs[0] = "e1"; sqs[1] = "g1"; return sqs; }
-	if (sq == "f4") { sqs[0] = "e3"; sqs[1] = "g3"; return sqs; }
-	if (sq == "f6") { sqs[0] = "e5"; sqs[1] = "g5"; return sqs; }
-	if (sq == "f8") { sqs[0] = "e7"; sqs[1] = "g7"; return sqs; }
+std::size_t wire::syncFrame(std::uint8_t seq, const board::Position& pos, char turn, std::uint8_t* out) {
+	const Protocol_Board snapshot = toSnapshot(pos, turn);
+	std::uint8_t payload[PROTOCOL_SYNC_SIZE];
+	Protocol_PackBoard(&snapshot, payload);
+	return Protocol_Encode(PROTOCOL_MSG_BOARD_SYNC, seq, payload, PROTOCOL_SYNC_SIZE, out);
+}
 
-	if (sq == "g1") return sqs;	//a piece on g1 cannot move backward
-	if (sq == "g3") { sqs[0] = "f2"; sqs[1] = "h2"; return sqs; }
-	if (sq == "g5") { sqs[0] = "f4"; sqs[1] = "h4"; return sqs; }
-	if (sq == "g7") { sqs[0] = "f6"; sqs[1] = "h6"; return sqs; }
+bool wire::readSync(const Protocol_Frame& frame, board::Position* pos, char* turn) {
+	Protocol_Board snapshot;
+	if (frame.type != PROTOCOL_MSG_BOARD_SYNC || frame.length != PROTOCOL_SYNC_SIZE) return false;
+	if (!Protocol_UnpackBoard(frame.payload, &snapshot)) return false;
+	pos->red = snapshot.red;
+	pos->black = snapshot.black;
+	pos->kings = snapshot.kings;
+	*turn = static_cast<char>(snapshot.turn);
+	return true;
+}
 
-	if (sq == "h2") { sqs[0] = "g1"; return sqs; }
-	if (sq == "h4") { sqs[0] = "g3"; return sqs; }
-	if (sq == "h6") { sqs[0] = "g5"; return sqs; }
-	if (sq == "h8") { sqs[0] = "g7"; return sqs; }
+bool wire::readGame(const Protocol_Frame& frame, int* slot, save::GameState* state) {
+	//slot, snapshot, mode, then the hops
+	const std::size_t fixed = 2 + PROTOCOL_SYNC_SIZE;
+	Protocol_Board snapshot;
+	if (frame.type != PROTOCOL_MSG_GAME || frame.length < fixed || (frame.length - fixed) % 2 != 0) return false;
+	if (!Protocol_UnpackBoard(frame.payload + 1, &snapshot)) return false;
+	std::vector<board::Hop> history;
+	for (std::size_t i = fixed; i < frame.length; i += 2)
+	{
+		if (frame.payload[i] > 31 || frame.payload[i + 1] > 31) return false;
+		history.push_back(board::Hop{ frame.payload[i], frame.payload[i + 1] });
+	}
+	*slot = frame.payload[0];
+	state->position = board::Position{ snapshot.red, snapshot.black, snapshot.kings };
+	state->turn = static_cast<char>(snapshot.turn);
+	state->selector = frame.payload[1 + PROTOCOL_SYNC_SIZE];
+	state->history = std::move(history);
+	return true;
+}
 
-	error("Exception: constructor use without an accessible square");
+bool wire::readList(const Protocol_Frame& frame, std::vector<SavedGame>* games) {
+	if (frame.type != PROTOCOL_MSG_LIST || frame.length % PROTOCOL_LIST_ENTRY_SIZE != 0) return false;
+	games->clear();
+	for (std::size_t i = 0; i < frame.length; i += PROTOCOL_LIST_ENTRY_SIZE)
+	{
+		const std::uint8_t* entry = frame.payload + i;
+		games->push_back(SavedGame{ entry[0], entry[1], static_cast<char>(entry[2]), entry[3], entry[4] });
+	}
+	return true;
 }
 
-std::vector<std::string> Square::setFrtJmpSqs(std::string sq) {
-	//sets std::vector<std::string> frtJmpSqs
+void wire::wire_Test()
+{
+	std::uint8_t out[PROTOCOL_MAX_FRAME];
+	Protocol_Parser parser;
+	Protocol_Reset(&parser);
+
+	// Test case 1: CRC-16/CCITT-FALSE check value
+	const std::uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	assert(Protocol_Crc16(0xFFFF, check, sizeof check) == 0x29B1);
+
+	// Test case 2: a frame is complete on its last byte, even after line noise
+	const board::Hop hops[2] = { { 9, 18 }, { 18, 27 } };
+	std::size_t size = moveFrame(7, 0xBEEF, hops, 2, out);
+	assert(size == PROTOCOL_OVERHEAD + PROTOCOL_HASH_SIZE + 4);
+	const std::uint8_t noise[] = { 0x00, 0x41, PROTOCOL_SOF, 0xFF };
+	for (std::uint8_t byte : noise) assert(Protocol_Feed(&parser, byte) != PROTOCOL_FRAME);
+	for (std::size_t i = 0; i < size; ++i)
+		assert(Protocol_Feed(&parser, out[i]) == (i + 1 == size ? PROTOCOL_FRAME : PROTOCOL_NONE));
+	assert(parser.frame.type == PROTOCOL_MSG_MOVE && parser.frame.seq == 7);
+	board::Hop back[PROTOCOL_MAX_PAYLOAD / 2];
+	std::uint16_t moveHash = 0;
+	assert(readMove(parser.frame, &moveHash, back) == 2 && moveHash == 0xBEEF);
+	assert(back[0].to == 18 && back[1].to == 27);
+
+	// Test case 3: every single-bit error is detected
+	board::Position pos = board::startPosition();
+	pos.kings = 1u << 31;
+	size = syncFrame(200, pos, Black, out);
+	for (std::size_t bit = 8; bit < 8 * size; ++bit)
+	{
+		out[bit / 8] ^= 1u << bit % 8;
+		int last = PROTOCOL_NONE;
+		for (std::size_t i = 0; i < size && last == PROTOCOL_NONE; ++i) last = Protocol_Feed(&parser, out[i]);
+		assert(last != PROTOCOL_FRAME);
+		Protocol_Reset(&parser);
+		out[bit / 8] ^= 1u << bit % 8;
+	}
 
-	std::vector<std::string> sqs(2, " "); //holds the squares to give to frtJmpSqs
+	// Test case 4: a board sync round-trips in 12 bytes
+	assert(size == PROTOCOL_OVERHEAD + 12);
+	for (std::size_t i = 0; i < size; ++i) Protocol_Feed(&parser, out[i]);
+	board::Position synced;
+	char turn = Red;
+	assert(readSync(parser.frame, &synced, &turn) && turn == Black);
+	assert(synced.red == pos.red && synced.black == pos.black && synced.kings == pos.kings);
+	assert(moveFrame(0, 0, hops, 0, out) == 0);
+
+	// Test case 5: the hash tells positions and sides to move apart
+	assert(boardHash(pos, Black) != boardHash(pos, Red));
+	board::Position moved = pos;
+	board::applyHop(&moved, board::Hop{ 9, 13 });
+	assert(boardHash(moved, Black) != boardHash(pos, Black));
+
+	// Test case 6: a snapshot with a king bit past the last piece is rejected
+	board::Position few;
+	few.red = 1u << 9;
+	few.black = few.kings = 1u << 22;
+	size = syncFrame(1, few, Red, out);
+	for (std::size_t i = 0; i < size; ++i) Protocol_Feed(&parser, out[i]);
+	assert(readSync(parser.frame, &synced, &turn) && synced.kings == few.kings);
+	parser.frame.payload[8] |= 0x04;
+	assert(!readSync(parser.frame, &synced, &turn));
+
+	// Test case 7: a loaded game comes in one frame with its mode and last hops; the list has an entry per slot
+	std::uint8_t game[2 + PROTOCOL_SYNC_SIZE + 4] = { 3 };
+	const Protocol_Board snapshot = { pos.red, pos.black, pos.kings, static_cast<std::uint8_t>(Black) };
+	Protocol_PackBoard(&snapshot, game + 1);
+	game[1 + PROTOCOL_SYNC_SIZE] = 2;
+	const std::uint8_t gameHops[4] = { 9, 13, 22, 18 };
+	std::memcpy(game + 2 + PROTOCOL_SYNC_SIZE, gameHops, sizeof gameHops);
+	size = Protocol_Encode(PROTOCOL_MSG_GAME, 9, game, sizeof game, out);
+	for (std::size_t i = 0; i < size; ++i) Protocol_Feed(&parser, out[i]);
+	save::GameState state;
+	int slot = -1;
+	assert(readGame(parser.frame, &slot, &state) && slot == 3 && state.selector == 2 && state.turn == Black);
+	assert(state.position.kings == pos.kings && state.history.size() == 2 && state.history[1].to == 18);
+	parser.frame.length -= 1;
+	assert(!readGame(parser.frame, &slot, &state));
+	const std::uint8_t list[2 * PROTOCOL_LIST_ENTRY_SIZE] = { 0, 1, Red, 12, 12, 3, 2, Black, 9, 7 };
+	size = Protocol_Encode(PROTOCOL_MSG_LIST, 10, list, sizeof list, out);
+	for (std::size_t i = 0; i < size; ++i) Protocol_Feed(&parser, out[i]);
+	std::vector<SavedGame> games;
+	assert(readList(parser.frame, &games) && games.size() == 2);
+	assert(games[1].slot == 3 && games[1].turn == Black && games[1].red == 9 && games[1].black == 7);
+	parser.frame.length = 4;
+	assert(!readList(parser.frame, &games));
+
+	std::cout << "wire(): All test cases passed!\n";
+}
 
-	if (sq == "a1") { sqs[0] = "c3"; return sqs; }
-	if (sq == "a3") { sqs[0] = "c5"; return sqs; }
-	if (sq == "a5") { sqs[0] = "c7"; return sqs; }
-	if (sq == "a7") return sqs;	//a piece on a7 cannot jump forward
+#ifdef _WIN32
+transport::SerialPort::~SerialPort() {
+	if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+}
 
-	if (sq == "b2") { sqs[0] = "d4"; return sqs; }
-	if (sq == "b4") { sqs[0] = "d6"; return sqs; }
-	if (sq == "b6") { sqs[0] = "d8"; return sqs; }
-	if (sq == "b8") return sqs;	//a piece on b8 cannot jump forward
+bool transport::SerialPort::open(const std::string& name, int baud) {
+	handle = CreateFileA(("\\\\.\\" + name).c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	DCB dcb = {};
+	dcb.DCBlength = sizeof dcb;
+	if (!GetCommState(handle, &dcb)) return false;
+	dcb.BaudRate = baud;
+	dcb.ByteSize = 8;
+	dcb.Parity = NOPARITY;
+	dcb.StopBits = ONESTOPBIT;
+	dcb.fBinary = TRUE;
+	dcb.fOutxCtsFlow = FALSE;
+	dcb.fRtsControl = RTS_CONTROL_ENABLE;
+	dcb.fDtrControl = DTR_CONTROL_ENABLE;
+	if (!SetCommState(handle, &dcb)) return false;
+	//reads return at once until read() asks for a wait; writes give up after 1 ms
+	COMMTIMEOUTS timeouts = {};
+	timeouts.ReadIntervalTimeout = MAXDWORD;
+	timeouts.WriteTotalTimeoutConstant = 1;
+	timeoutMs = 0;
+	return SetCommTimeouts(handle, &timeouts) != 0;
+}
 
-	if (sq == "c1") { sqs[0] = "a3"; sqs[1] = "e3"; return sqs; }
-	if (sq == "c3") { sqs[0] = "a5"; sqs[1] = "e5"; return sqs; }
-	if (sq == "c5") { sqs[0] = "a7"; sqs[1] = "e7"; return sqs; }
-	if (sq == "c7") return sqs;	//a piece on c7 cannot jump forward
+long transport::SerialPort::read(std::uint8_t* buf, std::size_t size, int waitMs) {
+	if (waitMs != timeoutMs)
+	{
+		//return at once with what has arrived, or wait up to waitMs for the first byte
+		COMMTIMEOUTS timeouts = {};
+		timeouts.ReadIntervalTimeout = MAXDWORD;
+		timeouts.ReadTotalTimeoutMultiplier = waitMs > 0 ? MAXDWORD : 0;
+		timeouts.ReadTotalTimeoutConstant = waitMs;
+		timeouts.WriteTotalTimeoutConstant = 1;
+		if (!SetCommTimeouts(handle, &timeouts)) return -1;
+		timeoutMs = waitMs;
+	}
+	DWORD count = 0;
+	if (!ReadFile(handle, buf, static_cast<DWORD>(size), &count, nullptr)) return -1;
+	return static_cast<long>(count);
+}
 
-	if (sq == "d2") { sqs[0] = "b4"; sqs[1] = "f4"; return sqs; }
-	if (sq == "d4") { sqs[0] = "b6"; sqs[1] = "f6"; return sqs; }
-	if (sq == "d6") { sqs[0] = "b8"; sqs[1] = "f8"; return sqs; }
-	if (sq == "d8") return sqs;	//a piece on d8 cannot jump forward
+long transport::SerialPort::write(const std::uint8_t* data, std::size_t size) {
+	DWORD count = 0;
+	if (!WriteFile(handle, data, static_cast<DWORD>(size), &count, nullptr) && GetLastError() != ERROR_TIMEOUT) return -1;
+	return static_cast<long>(count);
+}
+#else
+transport::SerialPort::~SerialPort() {
+	if (fd >= 0) ::close(fd);
+}
 
-	if (sq == "e1") { sqs[0] = "c3"; sqs[1] = "g3"; return sqs; }
-	if (sq == "e3") { sqs[0] = "c5"; sqs[1] = "g5"; return sqs; }
-	if (sq == "e5") { sqs[0] = "c7"; sqs[1] = "g7"; return sqs; }
-	if (sq == "e7") return sqs;	//a piece on e7 cannot jump forward
+bool transport::SerialPort::open(const std::string& name, int baud) {
+	speed_t speed;
+	switch (baud) {
+	case 9600: speed = B9600; break;
+	case 19200: speed = B19200; break;
+	case 38400: speed = B38400; break;
+	case 57600: speed = B57600; break;
+	case 115200: speed = B115200; break;
+	default: return false;
+	}
+	fd = ::open(name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) return false;
+	termios settings;
+	if (tcgetattr(fd, &settings) != 0) return false;
+	cfmakeraw(&settings);
+	settings.c_cflag |= CLOCAL | CREAD;
+	cfsetispeed(&settings, speed);
+	cfsetospeed(&settings, speed);
+	return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
 
-	if (sq == "f2") { sqs[0] = "d4"; sqs[1] = "h4"; return sqs; }
-	if (sq == "f4") { sqs[0] = "d6"; sqs[1] = "h6"; return sqs; }
-	if (sq == "f6") { sqs[0] = "d8"; sqs[1] = "h8"; return sqs; }
-	if (sq == "f8") return sqs;	//a piece on f8 cannot jump forward
+long transport::SerialPort::read(std::uint8_t* buf, std::size_t size, int waitMs) {
+	pollfd ready = { fd, POLLIN, 0 };
+	const int events = ::poll(&ready, 1, waitMs);
+	if (events < 0) return errno == EINTR ? 0 : -1;
+	if (events == 0) return 0;
+	const long count = ::read(fd, buf, size);
+	if (count > 0) return count;
+	if (count < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+	return -1; //end of file, or the other side of a pty went away
+}
 
-	if (sq == "g1") { sqs[0] = "e3"; return sqs; }
-	if (sq == "g3") { sqs[0] = "e5"; return sqs; }
-	if (sq == "g5") { sqs[0] = "e7"; return sqs; }
-	if (sq == "g7") return sqs;	//a piece on g7 cannot jump forward
+long transport::SerialPort::write(const std::uint8_t* data, std::size_t size) {
+	const long count = ::write(fd, data, size);
+	if (count >= 0) return count;
+	return errno == EAGAIN || errno == EINTR ? 0 : -1;
+}
+#endif
 
-	if (sq == "h2") { sqs[0] = "f4"; return sqs; }
-	if (sq == "h4") { sqs[0] = "f6"; return sqs; }
-	if (sq == "h6") { sqs[0] = "f8"; return sqs; }
-	if (sq == "h8") return sqs;	//a piece on h8 cannot jump forward
+int transport::LinkStats::bucketOf(std::uint32_t microseconds) {
+	int bucket = 0;
+	while (microseconds > 1 && bucket < buckets - 1)
+	{
+		microseconds >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
 
-	error("Exception: constructor use without an accessible square");
+transport::LinkStats::Period& transport::LinkStats::periodAt(Clock::time_point at) {
+	//only the I/O thread writes, so it alone moves a period on to a new number
+	const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(at.time_since_epoch()).count();
+	const long long number = ns / 1000000000LL / periodSeconds;
+	Period& period = rolling[number % periods];
+	if (firstNs.load(std::memory_order_relaxed) < 0) firstNs = ns;
+	if (period.number.load(std::memory_order_relaxed) != number)
+	{
+		period.number = -1;
+		for (auto& series : period.counts)
+			for (auto& bucket : series) bucket.store(0, std::memory_order_relaxed);
+		period.sent.store(0, std::memory_order_relaxed);
+		period.received.store(0, std::memory_order_relaxed);
+		period.retransmits.store(0, std::memory_order_relaxed);
+		period.number = number;
+	}
+	return period;
 }
 
-std::vector<std::string> Square::setBacJmpSqs(std::string sq) {
-	//sets std::vector<std::string> bacJmpSqs
+bool transport::LinkStats::isRecent(const Period& period, Clock::time_point at) const {
+	const long long now = std::chrono::duration_cast<std::chrono::seconds>(at.time_since_epoch()).count() / periodSeconds;
+	const long long number = period.number;
+	return number >= 0 && number <= now && number > now - periods;
+}
 
-	std::vector<std::string> sqs(2, " "); //holds the squares to give to bacJumpSqs
+void transport::LinkStats::record(Series series, std::uint32_t microseconds, Clock::time_point at) {
+	periodAt(at).counts[series][bucketOf(microseconds)].fetch_add(1, std::memory_order_relaxed);
+}
 
-	if (sq == "a1") return sqs;	//a crowned piece on a1 cannot jump backward
-	if (sq == "a3") { sqs[0] = "c1"; return sqs; }
-	if (sq == "a5") { sqs[0] = "c3"; return sqs; }
-	if (sq == "a7") { sqs[0] = "c5"; return sqs; }
+void transport::LinkStats::addBytes(std::uint32_t sent, std::uint32_t received, Clock::time_point at) {
+	Period& period = periodAt(at);
+	period.sent.fetch_add(sent, std::memory_order_relaxed);
+	period.received.fetch_add(received, std::memory_order_relaxed);
+}
 
-	if (sq == "b2") return sqs;	//a crowned piece on b2 cannot jump backward
-	if (sq == "b4") { sqs[0] = "d2"; return sqs; }
-	if (sq == "b6") { sqs[0] = "d4"; return sqs; }
-	if (sq == "b8") { sqs[0] = "d6"; return sqs; }
+void transport::LinkStats::addRetransmit(Clock::time_point at) {
+	periodAt(at).retransmits.fetch_add(1, std::memory_order_relaxed);
+}
 
-	if (sq == "c1") return sqs;	//a crowned piece on c1 cannot jump backward
-	if (sq == "c3") { sqs[0] = "a1"; sqs[1] = "e1"; return sqs; }
-	if (sq == "c5") { sqs[0] = "a3"; sqs[1] = "e3"; return sqs; }
-	if (sq == "c7") { sqs[0] = "a5"; sqs[1] = "e5"; return sqs; }
+void transport::LinkStats::histogram(Series series, Clock::time_point at, std::uint64_t* counts) const {
+	std::fill(counts, counts + buckets, 0);
+	for (const Period& period : rolling)
+	{
+		if (!isRecent(period, at)) continue;
+		for (int i = 0; i < buckets; ++i) counts[i] += period.counts[series][i].load(std::memory_order_relaxed);
+	}
+}
 
-	if (sq == "d2") return sqs;	//a crowned piece on d2 cannot jump backward
-	if (sq == "d4") { sqs[0] = "b2"; sqs[1] = "f2"; return sqs; }
-	if (sq == "d6") { sqs[0] = "b4"; sqs[1] = "f4"; return sqs; }
-	if (sq == "d8") { sqs[0] = "b6"; sqs[1] = "f6"; return sqs; }
+std::uint64_t transport::LinkStats::count(Series series, Clock::time_point at) const {
+	std::uint64_t counts[buckets];
+	histogram(series, at, counts);
+	return std::accumulate(counts, counts + buckets, std::uint64_t(0));
+}
 
-	if (sq == "e1") return sqs;	//a crowned piece on e1 cannot jump backward
-	if (sq == "e3") { sqs[0] = "c1"; sqs[1] = "g1"; return sqs; }
-	if (sq == "e5") { sqs[0] = "c3"; sqs[1] = "g3"; return sqs; }
-	if (sq == "e7") { sqs[0] = "c5"; sqs[1] = "g5"; return sqs; }
+std::uint32_t transport::LinkStats::percentile(Series series, double fraction, Clock::time_point at) const {
+	std::uint64_t counts[buckets];
+	histogram(series, at, counts);
+	const std::uint64_t total = std::accumulate(counts, counts + buckets, std::uint64_t(0));
+	if (total == 0) return 0;
+	//the first bucket that takes the running count to the fraction of the total
+	const double rank = std::max(1.0, std::ceil(fraction * total));
+	std::uint64_t below = 0;
+	int bucket = 0;
+	while (bucket < buckets - 1 && (below += counts[bucket]) < rank) ++bucket;
+	return std::uint32_t(2) << bucket;
+}
 
-	if (sq == "f2") return sqs;	//a crowned piece on f2 cannot jump backward
-	if (sq == "f4") { sqs[0] = "d2"; sqs[1] = "h2"; return sqs; }
-	if (sq == "f6") { sqs[0] = "d4"; sqs[1] = "h4"; return sqs; }
-	if (sq == "f8") { sqs[0] = "d6"; sqs[1] = "h6"; return sqs; }
+void transport::LinkStats::dump(std::ostream& out, Clock::time_point at) const {
+	static const char* const names[SeriesCount] = { "round trip", "on the board" };
+	const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(at.time_since_epoch()).count();
+	const long long windowStart = (ns / 1000000000LL / periodSeconds - periods + 1) * periodSeconds * 1000000000LL;
+	const long long first = firstNs;
+	const double seconds = first < 0 ? 0.0 : (ns - std::max(first, windowStart)) / 1e9;
+	std::uint64_t sent = 0, received = 0, retransmits = 0;
+	for (const Period& period : rolling)
+	{
+		if (!isRecent(period, at)) continue;
+		sent += period.sent;
+		received += period.received;
+		retransmits += period.retransmits;
+	}
 
-	if (sq == "g1") return sqs;	//a crowned piece on g1 cannot jump backward
-	if (sq == "g3") { sqs[0] = "e1"; return sqs; }
-	if (sq == "g5") { sqs[0] = "e3"; return sqs; }
-	if (sq == "g7") { sqs[0] = "e5"; return sqs; }
+	out << "Link over the last " << std::round(seconds * 10) / 10 << " s:\n";
+	for (int series = 0; series < SeriesCount; ++series)
+	{
+		std::uint64_t counts[buckets];
+		histogram(Series(series), at, counts);
+		const std::uint64_t total = std::accumulate(counts, counts + buckets, std::uint64_t(0));
+		out << "  " << names[series] << ": " << total << " frames";
+		if (total == 0)
+		{
+			out << '\n';
+			continue;
+		}
+		out << ", 50% under " << percentile(Series(series), 0.5, at) << " us, 90% under "
+			<< percentile(Series(series), 0.9, at) << " us, 99% under " << percentile(Series(series), 0.99, at) << " us\n";
+		const std::uint64_t most = *std::max_element(counts, counts + buckets);
+		for (int i = 0; i < buckets; ++i)
+		{
+			if (counts[i] == 0) continue;
+			const std::uint32_t low = i == 0 ? 0 : std::uint32_t(1) << i;
+			std::ostringstream range;
+			range << low << (i == buckets - 1 ? "+" : "-" + std::to_string((std::uint32_t(2) << i) - 1)) << " us";
+			out << "    " << std::string(18 - std::min<std::size_t>(18, range.str().size()), ' ') << range.str() << ' '
+				<< std::string(std::size_t(1 + 39 * counts[i] / most), '#') << ' ' << counts[i] << '\n';
+		}
+	}
+	out << "  sent " << (seconds > 0 ? sent / seconds : 0.0) << " B/s, received "
+		<< (seconds > 0 ? received / seconds : 0.0) << " B/s, " << retransmits << " retransmits\n";
+	if (lastPing != 0)
+		out << "  board clock " << boardOffset << " us ahead, by a ping of " << lastPing << " us\n";
+}
+
+void transport::Link::start(std::unique_ptr<Port> port_) {
+	stop();
+	port = std::move(port_);
+	started = std::chrono::steady_clock::now();
+	closed = false;
+	running = true;
+	thread = std::thread(&Link::run, this);
+}
 
-	if (sq == "h2") return sqs;	//a crowned piece on h2 cannot jump backward
-	if (sq == "h4") { sqs[0] = "f2"; return sqs; }
-	if (sq == "h6") { sqs[0] = "f4"; return sqs; }
-	if (sq == "h8") { sqs[0] = "f6"; return sqs; }
+void transport::Link::stop() {
+	if (!thread.joinable()) return;
+	running = false;
+	thread.join();
+	port.reset();
+}
 
-	error("Exception: constructor use without an accessible square");
+int transport::Link::send(std::uint8_t type, const std::uint8_t* payload, std::uint8_t length) {
+	Outgoing frame;
+	frame.size = static_cast<std::uint8_t>(Protocol_Encode(type, nextSeq, payload, length, frame.bytes));
+	if (frame.size == 0 || !outgoing.push(frame)) return -1;
+	++unacked;
+	return nextSeq++;
 }
 
-void displayBoard(const std::vector<Square>& sqVect) {
-	system("cls");
-
-	std::cout << '\n'
-		<< "     | " << sqVect[28].color() << " |   | " << sqVect[29].color() << " |   | " << sqVect[30].color() << " |   | " << sqVect[31].color() << '\n'
-		<< "8 ___|___|___|___|___|___|___|___\n"
-		<< "   " << sqVect[24].color() << " |   | " << sqVect[25].color() << " |   | " << sqVect[26].color() << " |   | " << sqVect[27].color() << " |\n"
-		<< "7 ___|___|___|___|___|___|___|___\n"
-		<< "     | " << sqVect[20].color() << " |   | " << sqVect[21].color() << " |   | " << sqVect[22].color() << " |   | " << sqVect[23].color() << '\n'
-		<< "6 ___|___|___|___|___|___|___|___\n"
-		<< "   " << sqVect[16].color() << " |   | " << sqVect[17].color() << " |   | " << sqVect[18].color() << " |   | " << sqVect[19].color() << " |\n"
-		<< "5 ___|___|___|___|___|___|___|___\n"
-		<< "     | " << sqVect[12].color() << " |   | " << sqVect[13].color() << " |   | " << sqVect[14].color() << " |   | " << sqVect[15].color() << '\n'
-		<< "4 ___|___|___|___|___|___|___|___\n"
-		<< "   " << sqVect[8].color() << " |   | " << sqVect[9].color() << " |   | " << sqVect[10].color() << " |   | " << sqVect[11].color() << " |\n"
-		<< "3 ___|___|___|___|___|___|___|___\n"
-		<< "     | " << sqVect[4].color() << " |   | " << sqVect[5].color() << " |   | " << sqVect[6].color() << " |   | " << sqVect[7].color() << '\n'
-		<< "2 ___|___|___|___|___|___|___|___\n"
-		<< "   " << sqVect[0].color() << " |   | " << sqVect[1].color() << " |   | " << sqVect[2].color() << " |   | " << sqVect[3].color() << " |\n"
-		<< "1 ___|___|___|___|___|___|___|___\n"
-		<< "   a   b   c   d   e   f   g   h \n"
-		<< '\n';
-	return;
+std::uint32_t transport::Link::microseconds(std::chrono::steady_clock::time_point at) const {
+	//wraps after about 71 minutes, as the board's clock does
+	return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(at - started).count());
 }
 
-void prepareGame() {
-	//prepare variables:
-	selection = " ";
-	turn = Red;
-	captureDirection = ' ';
-	initialRowParity = ' ';
-	wasCapture = false;
-	loser = ' ';
-	selected = 0;
-	targeted = 0;
-	inBetween = 0;
+int transport::Link::ping() {
+	const std::uint32_t now = microseconds(std::chrono::steady_clock::now());
+	std::uint8_t payload[4];
+	for (int i = 0; i < 4; ++i) payload[i] = static_cast<std::uint8_t>(now >> (8 * i));
+	return send(PROTOCOL_MSG_PING, payload, sizeof payload);
+}
 
-	//prepare squares and pieces:
-	squares[0] = Square(Red, "a1", '1'); squares[1] = Square(Red, "c1", '1');
-	squares[2] = Square(Red, "e1", '1'); squares[3] = Square(Red, "g1", '1');
-	squares[4] = Square(Red, "b2", '2'); squares[5] = Square(Red, "d2", '2');
-	squares[6] = Square(Red, "f2", '2'); squares[7] = Square(Red, "h2", '2');
-	squares[8] = Square(Red, "a3", '3'); squares[9] = Square(Red, "c3", '3');
-	squares[10] = Square(Red, "e3", '3'); squares[11] = Square(Red, "g3", '3');
-	squares[12] = Square(' ', "b4", '4'); squares[13] = Square(' ', "d4", '4');
-	squares[14] = Square(' ', "f4", '4'); squares[15] = Square(' ', "h4", '4');
-	squares[16] = Square(' ', "a5", '5'); squares[17] = Square(' ', "c5", '5');
-	squares[18] = Square(' ', "e5", '5'); squares[19] = Square(' ', "g5", '5');
-	squares[20] = Square(Black, "b6", '6'); squares[21] = Square(Black, "d6", '6');
-	squares[22] = Square(Black, "f6", '6'); squares[23] = Square(Black, "h6", '6');
-	squares[24] = Square(Black, "a7", '7'); squares[25] = Square(Black, "c7", '7');
-	squares[26] = Square(Black, "e7", '7'); squares[27] = Square(Black, "g7", '7');
-	squares[28] = Square(Black, "b8", '8'); squares[29] = Square(Black, "d8", '8');
-	squares[30] = Square(Black, "f8", '8'); squares[31] = Square(Black, "h8", '8');
-	return;
+bool transport::Link::nextToWrite(InFlight* inFlight, std::size_t* count, Outgoing* pending, std::size_t* index) {
+	//frames to write again go first, oldest first; then new ones while the window has room
+	for (std::size_t i = 0; i < *count; ++i)
+	{
+		if (!inFlight[i].again) continue;
+		inFlight[i].again = false;
+		inFlight[i].resent = true;
+		*pending = inFlight[i].frame;
+		*index = i;
+		++resent;
+		counters.addRetransmit(std::chrono::steady_clock::now());
+		return true;
+	}
+	//a SAVE waits until every frame before it is acked, and the frames after it wait for its ack
+	if (*count > 0 && inFlight[0].frame.bytes[2] == PROTOCOL_MSG_SAVE) return false;
+	if (*count >= static_cast<std::size_t>(window.load()) || (!holding && !outgoing.pop(&held))) return false;
+	holding = *count > 0 && held.bytes[2] == PROTOCOL_MSG_SAVE;
+	if (holding) return false;
+	*pending = held;
+	inFlight[*count].frame = *pending;
+	inFlight[*count].written = std::chrono::steady_clock::now();
+	inFlight[*count].again = false;
+	inFlight[*count].resent = false;
+	*index = (*count)++;
+	return true;
 }
 
-bool saveGame(std::vector<Square>* squares, char turn_, int selector_) {
-	std::ofstream saveFile;
-	std::cout << "Enter name of file where you want to save game\n";
-	std::cout << ">> ";
-	std::cin >> selection;
-	//check if file ends in .ini
-	if (selection.substr(selection.find_last_of(".") + 1) != "ini")
+std::size_t transport::Link::acked(InFlight* inFlight, std::size_t count, const Protocol_Frame& ack) {
+	//returns how many of the oldest frames the ack releases
+	const std::uint8_t seq = ack.payload[0];
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		std::cout << "File must be in .ini format\n";
-		return false;
+		const std::uint8_t frameSeq = inFlight[i].frame.bytes[3];
+		if (frameSeq != seq) continue;
+		if (ack.payload[1] != PROTOCOL_BAD_CRC) return i + 1;
+		inFlight[i].again = true;
+		return 0;
 	}
-	saveFile.open(selection);
-	if (saveFile.is_open())
+	return 0;
+}
+
+void transport::Link::run() {
+	Protocol_Parser parser;
+	Protocol_Reset(&parser);
+	InFlight inFlight[PROTOCOL_WINDOW];
+	std::size_t inFlightCount = 0;
+	Outgoing pending;
+	const std::size_t released = PROTOCOL_WINDOW; //pendingIndex of a frame acked while it was written
+	std::size_t pendingIndex = released;
+	std::size_t written = 0;
+	bool writing = false;
+	std::uint8_t buf[256];
+
+	while (running)
 	{
-		saveFile << "[Game]\nTurn=" << turn_ << "\n\n";
-		saveFile << "[Selector]\nSelector=" << selector_ << "\n\n";
+		//write as far as the port takes it; a frame's timer starts when it is written
+		bool progress = false;
+		while (writing || (writing = nextToWrite(inFlight, &inFlightCount, &pending, &pendingIndex)))
+		{
+			const long count = port->write(pending.bytes + written, pending.size - written);
+			if (count < 0)
+			{
+				closed = true;
+				return;
+			}
+			if (count == 0) break;
+			progress = true;
+			counters.addBytes(static_cast<std::uint32_t>(count), 0, std::chrono::steady_clock::now());
+			written += count;
+			if (written < pending.size) break;
+			written = 0;
+			writing = false;
+			if (pendingIndex != released) inFlight[pendingIndex].written = std::chrono::steady_clock::now();
+		}
 
-		for (size_t i = 0; i < squares->size(); ++i) {
-			saveFile << "[Square" << i << "]\n";
-			saveFile << "Color=" << squares->at(i).color() << "\n";
-			saveFile << "Square=" << squares->at(i).square() << "\n";
-			saveFile << "Row=" << squares->at(i).row() << "\n\n";
+		//then read; when there is nothing to write, wait for input a short while
+		const long count = port->read(buf, sizeof buf, progress ? 0 : idleWaitMs);
+		if (count < 0)
+		{
+			closed = true;
+			return;
 		}
-		saveFile.close();
+		const auto now = std::chrono::steady_clock::now();
+		if (count > 0) counters.addBytes(0, static_cast<std::uint32_t>(count), now);
+		for (long i = 0; i < count; ++i)
+		{
+			const int result = Protocol_Feed(&parser, buf[i]);
+			if (result == PROTOCOL_ERROR || result == PROTOCOL_BAD_LENGTH) ++bad;
+			if (result != PROTOCOL_FRAME) continue;
+			const Protocol_Frame& frame = parser.frame;
+			if (frame.type == PROTOCOL_MSG_ACK && frame.length >= 2)
+			{
+				//release the acked frames; a frame being written is finished from its copy
+				const std::size_t done = acked(inFlight, inFlightCount, frame);
+				//an ack of a frame written twice could be for either copy, so it is not timed
+				if (done > 0 && !inFlight[done - 1].resent)
+				{
+					const auto roundTrip = std::chrono::duration_cast<std::chrono::microseconds>(now - inFlight[done - 1].written);
+					counters.record(LinkStats::RoundTrip, static_cast<std::uint32_t>(std::max<long long>(0, roundTrip.count())), now);
+				}
+				//the board counts whole units, so the time is at most the end of its unit
+				if (frame.length >= PROTOCOL_ACK_SIZE)
+					counters.record(LinkStats::BoardTime, ((frame.payload[2] | frame.payload[3] << 8) + 1) * PROTOCOL_ACK_TIME_UNIT - 1, now);
+				std::move(inFlight + done, inFlight + inFlightCount, inFlight);
+				inFlightCount -= done;
+				unacked -= static_cast<unsigned>(done);
+				if (writing && pendingIndex != released) pendingIndex = pendingIndex < done ? released : pendingIndex - done;
+			}
+			else if (frame.type == PROTOCOL_MSG_PING && frame.length == PROTOCOL_PING_SIZE)
+			{
+				//the board's clock is taken to be read halfway through the round trip
+				std::uint32_t sentAt = 0, boardAt = 0;
+				for (int j = 3; j >= 0; --j)
+				{
+					sentAt = sentAt << 8 | frame.payload[j];
+					boardAt = boardAt << 8 | frame.payload[4 + j];
+				}
+				const std::uint32_t roundTrip = microseconds(now) - sentAt;
+				counters.recordPing(roundTrip, static_cast<std::int32_t>(boardAt - (sentAt + roundTrip / 2)));
+			}
+			Event event{ frame, now };
+			//the game is not keeping up; wait for room rather than lose a frame
+			while (!events.push(event) && running) std::this_thread::yield();
+		}
+
+		//a frame whose ack is late is written again, and only that frame
+		for (std::size_t i = 0; i < inFlightCount; ++i)
+			if (!(writing && i == pendingIndex) && now - inFlight[i].written > std::chrono::milliseconds(retransmitMs.load()))
+				inFlight[i].again = true;
 	}
-	else
+}
+
+void transport::transport_Test()
+{
+	// Test case 1: the queue keeps its order across threads and reports full and empty
+	SpscQueue<int, 8> queue;
+	int item;
+	assert(!queue.pop(&item));
+	for (int i = 0; i < 8; ++i) assert(queue.push(i));
+	assert(!queue.push(8));
+	for (int i = 0; i < 8; ++i) assert(queue.pop(&item) && item == i);
+	// A side that finds the queue full or empty yields, so the other side runs even on one CPU
+	const int items = 20000;
+	std::thread producer([&queue] {
+		for (int i = 0; i < items; )
+		{
+			if (queue.push(i)) ++i;
+			else std::this_thread::yield();
+		}
+	});
+	for (int expected = 0; expected < items; )
 	{
-		std::cout << "Unable to open file\n";
-		return false;
+		if (queue.pop(&item)) assert(item == expected++);
+		else std::this_thread::yield();
 	}
-
-	return true;
+	producer.join();
+
+#ifndef _WIN32
+	// Test case 2: frames go both ways through a pty standing in for the board
+	const int board = posix_openpt(O_RDWR | O_NOCTTY);
+	assert(board >= 0 && grantpt(board) == 0 && unlockpt(board) == 0);
+	auto port = std::make_unique<SerialPort>();
+	assert(port->open(ptsname(board), 115200));
+	Link link;
+	link.start(std::move(port));
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+	const std::uint8_t move[2] = { 22, 18 };
+	std::uint8_t frame[PROTOCOL_MAX_FRAME];
+	const std::size_t size = Protocol_Encode(PROTOCOL_MSG_MOVE, 5, move, 2, frame);
+	assert(::write(board, frame, size) == static_cast<long>(size));
+	Event event;
+	while (!link.poll(&event)) assert(std::chrono::steady_clock::now() < deadline);
+	assert(event.frame.type == PROTOCOL_MSG_MOVE && event.frame.seq == 5 && event.frame.payload[1] == 18);
+
+	assert(link.send(PROTOCOL_MSG_NEW_GAME, nullptr, 0) == 0);
+	Protocol_Parser parser;
+	Protocol_Reset(&parser);
+	for (int result = PROTOCOL_NONE; result != PROTOCOL_FRAME; )
+	{
+		pollfd ready = { board, POLLIN, 0 };
+		std::uint8_t byte;
+		assert(::poll(&ready, 1, 5000) == 1 && ::read(board, &byte, 1) == 1);
+		result = Protocol_Feed(&parser, byte);
+	}
+	assert(parser.frame.type == PROTOCOL_MSG_NEW_GAME && parser.frame.seq == 0);
+
+	// Test case 3: a corrupted frame is counted and dropped
+	frame[5] ^= 0x10;
+	assert(::write(board, frame, size) == static_cast<long>(size));
+	while (link.badFrames() == 0) assert(std::chrono::steady_clock::now() < deadline);
+	assert(!link.poll(&event));
+
+	// Test case 4: a window of frames goes out at once; acks are cumulative and only
+	// the frame asked for again, or whose ack is late, is written again
+	const auto readFrame = [&](int waitMs) {
+		Protocol_Reset(&parser);
+		for (;;)
+		{
+			pollfd ready = { board, POLLIN, 0 };
+			std::uint8_t byte;
+			if (::poll(&ready, 1, waitMs) != 1 || ::read(board, &byte, 1) != 1) return -1;
+			if (Protocol_Feed(&parser, byte) == PROTOCOL_FRAME) return int(parser.frame.seq);
+		}
+	};
+	const auto ack = [&](std::uint8_t seq, std::uint8_t status) {
+		const std::uint8_t payload[2] = { seq, status };
+		const std::size_t length = Protocol_Encode(PROTOCOL_MSG_ACK, 0, payload, 2, frame);
+		assert(::write(board, frame, length) == static_cast<long>(length));
+	};
+	link.setRetransmitTimeout(500);
+	ack(0, PROTOCOL_OK);
+	const std::uint8_t slot = 1;
+	for (int i = 1; i <= 6; ++i) assert(link.send(PROTOCOL_MSG_LOAD, &slot, 1) == i);
+	for (int i = 1; i <= int(PROTOCOL_WINDOW); ++i) assert(readFrame(1000) == i);
+	assert(readFrame(50) == -1);
+	ack(2, PROTOCOL_OK);
+	assert(readFrame(1000) == 5 && readFrame(1000) == 6);
+	ack(4, PROTOCOL_BAD_CRC);
+	assert(readFrame(1000) == 4 && link.retransmits() == 1);
+	ack(6, PROTOCOL_OK);
+	while (!link.idle()) assert(std::chrono::steady_clock::now() < deadline + std::chrono::seconds(5));
+	assert(link.send(PROTOCOL_MSG_LOAD, &slot, 1) == 7 && readFrame(1000) == 7);
+	assert(readFrame(2000) == 7 && link.retransmits() == 2);
+	ack(7, PROTOCOL_OK);
+	while (!link.idle()) assert(std::chrono::steady_clock::now() < deadline + std::chrono::seconds(5));
+	int acks = 0;
+	while (link.poll(&event)) acks += event.frame.type == PROTOCOL_MSG_ACK;
+	assert(acks == 5);
+	//acks of frames 0, 2 and 6 are timed; 4 and 7 were written twice
+	assert(link.stats().count(LinkStats::RoundTrip) == 3 && link.stats().count(LinkStats::BoardTime) == 0);
+	std::ostringstream dump;
+	link.stats().dump(dump);
+	assert(dump.str().find(" 2 retransmits") != std::string::npos);
+
+	// Test case 5: one frame of a full window is lost; the board asks for it when the next
+	// one comes, and only that frame is written again before the window is acked
+	for (int i = 8; i < 8 + int(PROTOCOL_WINDOW); ++i) assert(link.send(PROTOCOL_MSG_LOAD, &slot, 1) == i);
+	for (int i = 8; i < 8 + int(PROTOCOL_WINDOW); ++i) assert(readFrame(1000) == i);
+	ack(8, PROTOCOL_BAD_CRC);
+	assert(readFrame(1000) == 8 && readFrame(50) == -1 && link.retransmits() == 3);
+	ack(7 + PROTOCOL_WINDOW, PROTOCOL_OK);
+	while (!link.idle()) assert(std::chrono::steady_clock::now() < deadline + std::chrono::seconds(5));
+	assert(link.retransmits() == 3);
+
+	// Test case 6: a SAVE waits for the frames before it to be acked, and the frames after it for its ack
+	assert(link.send(PROTOCOL_MSG_LOAD, &slot, 1) == 12 && link.send(PROTOCOL_MSG_SAVE, &slot, 1) == 13);
+	assert(link.send(PROTOCOL_MSG_LOAD, &slot, 1) == 14);
+	assert(readFrame(1000) == 12 && readFrame(50) == -1);
+	ack(12, PROTOCOL_OK);
+	assert(readFrame(1000) == 13 && readFrame(50) == -1);
+	ack(13, PROTOCOL_OK);
+	assert(readFrame(1000) == 14);
+	ack(14, PROTOCOL_OK);
+	while (!link.idle()) assert(std::chrono::steady_clock::now() < deadline + std::chrono::seconds(5));
+
+	// Test case 7: the link notices when the board goes away
+	assert(link.isOpen());
+	::close(board);
+	while (link.isOpen()) assert(std::chrono::steady_clock::now() < deadline);
+#endif
+
+	// Test case 8: times go in power-of-two buckets, and the counts roll out after the last period
+	assert(LinkStats::bucketOf(0) == 0 && LinkStats::bucketOf(1) == 0 && LinkStats::bucketOf(2) == 1);
+	assert(LinkStats::bucketOf(1023) == 9 && LinkStats::bucketOf(1024) == 10);
+	assert(LinkStats::bucketOf(0xFFFFFFFFu) == LinkStats::buckets - 1);
+	LinkStats stats;
+	const LinkStats::Clock::time_point at(std::chrono::seconds(1000));
+	assert(stats.count(LinkStats::RoundTrip, at) == 0 && stats.percentile(LinkStats::RoundTrip, 0.5, at) == 0);
+	for (int i = 0; i < 90; ++i) stats.record(LinkStats::RoundTrip, 1500, at);
+	for (int i = 0; i < 10; ++i) stats.record(LinkStats::RoundTrip, 40000, at + std::chrono::seconds(15));
+	const auto later = at + std::chrono::seconds(20);
+	assert(stats.count(LinkStats::RoundTrip, later) == 100);
+	assert(stats.percentile(LinkStats::RoundTrip, 0.5, later) == 2048 && stats.percentile(LinkStats::RoundTrip, 0.9, later) == 2048);
+	assert(stats.percentile(LinkStats::RoundTrip, 0.91, later) == 65536);
+	const auto rolled = at + std::chrono::seconds(LinkStats::periods * LinkStats::periodSeconds);
+	assert(stats.count(LinkStats::RoundTrip, rolled) == 10);
+	stats.record(LinkStats::RoundTrip, 3, rolled);
+	assert(stats.count(LinkStats::RoundTrip, rolled) == 11 && stats.percentile(LinkStats::RoundTrip, 0.05, rolled) == 4);
+	stats.addBytes(1000, 500, rolled);
+	std::ostringstream text;
+	stats.dump(text, rolled + std::chrono::seconds(5));
+	assert(text.str().find("round trip: 11 frames") != std::string::npos);
+	assert(text.str().find("32768-65535 us") != std::string::npos);
+
+	std::cout << "transport(): All test cases passed!\n";
 }
 
-bool loadGame(std::vector<Square>* squares, char* turn_, int* selector_) {
-	std::ifstream loadFile;
-	std::cout << "Enter name of file:\n";
-	std::cout << ">> ";
-	std::cin >> selection;
-	loadFile.open(selection);
-	std::string line;
-	size_t squareIndex = 0;
+transport::Link* hardware::link = nullptr;
 
-	if (loadFile.is_open()) {
-		while (getline(loadFile, line)) {
-			if (line.find("Turn=") != std::string::npos) {
-				*turn_ = line.substr(line.find("=") + 1)[0];
-			}
-			else if (line.find("Selector=") != std::string::npos) {
-				*selector_ = std::stoi(line.substr(line.find("=") + 1));
-			}
-			else if (line.find("[Square") != std::string::npos) {
-				char color;
-				std::string square;
-				char row;
+namespace {
+	std::vector<std::string> boardEntries; //entries of the board's last move, in reverse order
+	std::vector<board::Hop> boardMove;     //hops of the board's last move, not to be sent back
+	bool snapshotDue = false;              //a snapshot could not be queued yet
 
-				getline(loadFile, line); // Color line
-				color = line.substr(line.find("=") + 1)[0];
+	bool consoleReady(int waitMs) {
+		//words left on a line already read come first; line breaks alone are skipped
+		std::streambuf* in = std::cin.rdbuf();
+		while (in->in_avail() > 0)
+		{
+			if (!std::isspace(static_cast<unsigned char>(in->sgetc()))) return true;
+			in->sbumpc();
+		}
+#ifdef _WIN32
+		return WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE), waitMs) == WAIT_OBJECT_0;
+#else
+		pollfd console = { 0, POLLIN, 0 };
+		return ::poll(&console, 1, waitMs) > 0;
+#endif
+	}
+}
 
-				getline(loadFile, line); // Square line
-				square = line.substr(line.find("=") + 1);
+void hardware::sendSnapshot() {
+	if (!link) return;
+	const Protocol_Board snapshot = toSnapshot(board::toPosition(squares), turn);
+	std::uint8_t payload[PROTOCOL_SYNC_SIZE];
+	Protocol_PackBoard(&snapshot, payload);
+	snapshotDue = link->send(PROTOCOL_MSG_BOARD_SYNC, payload, PROTOCOL_SYNC_SIZE) < 0;
+	boardEntries.clear();
+}
 
-				getline(loadFile, line); // Row line
-				row = line.substr(line.find("=") + 1)[0];
+void hardware::sendMove(const board::Position& before, char mover, std::size_t first) {
+	if (!link || history.size() <= first) return;
+	const std::size_t count = history.size() - first;
+	if (count == boardMove.size() && std::equal(boardMove.begin(), boardMove.end(), history.begin() + first,
+		[](const board::Hop& a, const board::Hop& b) { return a.from == b.from && a.to == b.to; }))
+	{
+		boardMove.clear(); //the board made it and has played it already
+		return;
+	}
+	boardMove.clear();
+	//a move too long for one frame is sent as the position it leads to
+	if (PROTOCOL_HASH_SIZE + 2 * count > PROTOCOL_MAX_PAYLOAD)
+	{
+		sendSnapshot();
+		return;
+	}
+	std::uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+	const std::uint16_t hash = wire::boardHash(before, mover);
+	std::uint8_t length = 0;
+	payload[length++] = static_cast<std::uint8_t>(hash >> 8);
+	payload[length++] = static_cast<std::uint8_t>(hash);
+	for (std::size_t i = first; i < history.size(); ++i)
+	{
+		payload[length++] = history[i].from;
+		payload[length++] = history[i].to;
+	}
+	if (link->send(PROTOCOL_MSG_MOVE, payload, length) < 0) snapshotDue = true;
+	service();
+}
 
-				if (squareIndex < squares->size()) {
-					squares->at(squareIndex) = Square(color, square, row);
-					squareIndex++;
-				}
+void hardware::service() {
+	if (!link) return;
+	transport::Event event;
+	while (link->poll(&event))
+	{
+		const Protocol_Frame& frame = event.frame;
+		board::Hop hops[PROTOCOL_MAX_PAYLOAD / 2];
+		std::uint16_t hash = 0;
+		int count = 0;
+		if (frame.type == PROTOCOL_MSG_ACK && frame.length >= 2)
+		{
+			//the board's snapshot that follows these is not ours to take: the game is played here
+			const std::uint8_t status = frame.payload[1];
+			if (status == PROTOCOL_OUT_OF_SYNC || status == PROTOCOL_ILLEGAL_MOVE) snapshotDue = true;
+		}
+		else if ((count = wire::readMove(frame, &hash, hops)) > 0)
+		{
+			if (hash != wire::boardHash(board::toPosition(squares), turn))
+			{
+				snapshotDue = true;
+				continue;
 			}
+			//the squares as the player would type them, and "sk" in case the game offers another jump
+			boardMove.assign(hops, hops + count);
+			boardEntries.clear();
+			boardEntries.push_back("sk");
+			for (int i = count - 1; i >= 0; --i) boardEntries.push_back(board::squareName(hops[i].to));
+			boardEntries.push_back(board::squareName(hops[0].from));
 		}
-		loadFile.close();
 	}
-	else
+	if (snapshotDue) sendSnapshot();
+}
+
+bool hardware::boardEntry(std::string* entry, bool chain) {
+	while (!boardEntries.empty())
 	{
-		std::cout << "Unable to open file\n";
-		return false;
+		*entry = boardEntries.back();
+		boardEntries.pop_back();
+		if (*entry != "sk" || chain) return true;
 	}
+	return false;
+}
 
-	captureDirection = ' ';
-	initialRowParity = ' ';
-	wasCapture = false;
-	loser = ' ';
-	selected = 0;
-	targeted = 0;
-	inBetween = 0;
+bool hardware::readEntry(std::string* entry, bool chain) {
+	if (!link) return static_cast<bool>(std::cin >> *entry);
+	while (true)
+	{
+		service();
+		if (boardEntry(entry, chain))
+		{
+			std::cout << *entry << " (on the board)\n";
+			return true;
+		}
+		//the board is looked at again every 10 ms while the console is quiet
+		if (consoleReady(10)) return static_cast<bool>(std::cin >> *entry);
+	}
+}
 
-	return true;
+void hardware::hardware_Test()
+{
+	// Test case 1: without a link nothing is sent and no board entry comes
+	assert(!link);
+	prepareGame();
+	sendSnapshot();
+	sendMove(board::toPosition(squares), turn, 0);
+	std::string entry;
+	assert(!boardEntry(&entry, false));
+
+#ifndef _WIN32
+	const int boardEnd = posix_openpt(O_RDWR | O_NOCTTY);
+	assert(boardEnd >= 0 && grantpt(boardEnd) == 0 && unlockpt(boardEnd) == 0);
+	auto port = std::make_unique<transport::SerialPort>();
+	assert(port->open(ptsname(boardEnd), 115200));
+	transport::Link boardLink;
+	boardLink.start(std::move(port));
+	link = &boardLink;
+	Protocol_Parser parser;
+	std::uint8_t frame[PROTOCOL_MAX_FRAME];
+	const auto write = [&](std::uint8_t type, const std::uint8_t* payload, std::uint8_t length) {
+		const std::size_t size = Protocol_Encode(type, 0, payload, length, frame);
+		assert(::write(boardEnd, frame, size) == static_cast<long>(size));
+	};
+	const auto waiting = [&](int waitMs) {
+		pollfd ready = { boardEnd, POLLIN, 0 };
+		return ::poll(&ready, 1, waitMs) == 1;
+	};
+	//reads the next frame from the game and acks it with a status
+	const auto readFrame = [&](std::uint8_t status) {
+		Protocol_Reset(&parser);
+		for (int result = PROTOCOL_NONE; result != PROTOCOL_FRAME; )
+		{
+			std::uint8_t byte;
+			assert(waiting(5000) && ::read(boardEnd, &byte, 1) == 1);
+			result = Protocol_Feed(&parser, byte);
+		}
+		const Protocol_Frame received = parser.frame;
+		const std::uint8_t ack[2] = { received.seq, status };
+		write(PROTOCOL_MSG_ACK, ack, 2);
+		return received;
+	};
+	const auto serviceUntil = [&](auto done) {
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!done())
+		{
+			assert(std::chrono::steady_clock::now() < deadline);
+			service();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	};
+
+	// Test case 2: a game starts with a snapshot of its position
+	sendSnapshot();
+	Protocol_Frame sent = readFrame(PROTOCOL_OK);
+	board::Position pos;
+	char side = ' ';
+	assert(wire::readSync(sent, &pos, &side) && side == Red);
+	assert(pos.red == board::startPosition().red && pos.black == board::startPosition().black);
+
+	// Test case 3: a move played here goes out on the hash of the position before it
+	const board::Position before = board::toPosition(squares);
+	history.push_back(board::Hop{ 9, 13 }); //c3-d4
+	sendMove(before, Red, 0);
+	sent = readFrame(PROTOCOL_OUT_OF_SYNC);
+	board::Hop hops[PROTOCOL_MAX_PAYLOAD / 2];
+	std::uint16_t hash = 0;
+	assert(wire::readMove(sent, &hash, hops) == 1 && hash == wire::boardHash(before, Red));
+	assert(hops[0].from == 9 && hops[0].to == 13);
+
+	// Test case 4: the answer that the board has another position brings a snapshot
+	serviceUntil([&] { return waiting(0); });
+	sent = readFrame(PROTOCOL_OK);
+	assert(sent.type == PROTOCOL_MSG_BOARD_SYNC && sent.length == PROTOCOL_SYNC_SIZE);
+
+	// Test case 5: a move made on the board becomes the player's entries and is not sent back
+	history.clear();
+	hash = wire::boardHash(board::toPosition(squares), turn);
+	const std::uint8_t move[4] = { static_cast<std::uint8_t>(hash >> 8), static_cast<std::uint8_t>(hash), 10, 14 }; //e3-f4
+	write(PROTOCOL_MSG_MOVE, move, 4);
+	serviceUntil([&] { return boardEntry(&entry, false); });
+	assert(entry == "e3");
+	assert(boardEntry(&entry, false) && entry == "f4");
+	assert(!boardEntry(&entry, false)); //the chain's "sk" is dropped when no jump is offered
+	history.push_back(board::Hop{ 10, 14 });
+	sendMove(board::toPosition(squares), Red, 0);
+	assert(!waiting(100));
+
+	// Test case 6: a move on another position is not played; the board gets the game's position
+	const std::uint8_t stale[4] = { move[0], static_cast<std::uint8_t>(move[1] ^ 1u), 10, 14 };
+	write(PROTOCOL_MSG_MOVE, stale, 4);
+	serviceUntil([&] { return waiting(0); });
+	sent = readFrame(PROTOCOL_OK);
+	assert(sent.type == PROTOCOL_MSG_BOARD_SYNC && !boardEntry(&entry, false));
+
+	link = nullptr;
+	history.clear();
+	::close(boardEnd);
+#endif
+	std::cout << "hardware(): All test cases passed!\n";
 }
 
 bool isSquare(std::string sq) {
@@ -1370,7 +6343,6 @@ void isSquare_Test()
 	assert(!isSquare(test_square));
 
 	std::cout << "isSquare(): All test cases passed!\n";
-	Sleep(25);
 }
 
 char reverseCrown(char color) {
@@ -1410,7 +6382,6 @@ void reverseCrown_Test()
 	assert(!(reverseCrown(cBlack) == Red));
 
 	std::cout << "reverseCrown(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool cannotMakeMove() {
@@ -1506,40 +6477,80 @@ void possibleMovement_Test()
 	assert(possibleMovement(&squares[11]));
 
 	std::cout << "possibleMovement(): All test cases passed!\n";
-	Sleep(25);
 }
 
-void getSquare() {
-	std::cout << "Current turn: " << turn << "\n";
-	std::cout << "Enter coordinate of piece you want to move (ex. a1, f8):\n";
-	std::cin >> selection;
-	// selection = get_GUI_Input();
-	// std::cout << selection << std::endl;
+InputState readInput(InputState state) {
+	switch (state) {
+	case InputState::Piece:
+		std::cout << "Current turn: " << turn << "\n";
+		std::cout << "Enter coordinate of piece you want to move (ex. a1, f8):\n";
+		break;
+	case InputState::Target:
+		std::cout << "Enter coordinate of target square (ex. a1, f8):\n";
+		break;
+	case InputState::ConsecutiveJump:
+		std::cout << "Current turn is still: " << turn << '\n';
+		std::cout << "Piece to move is on " << squares[selected].square() << ".\n";
+		std::cout << "Enter coordinate of target square for consecutive jump (ex. a1, f8).\n";
+		std::cout << "Or enter 'sk' or 'skip' to skip this consecutive jump.\n";
+		break;
+	case InputState::Done:
+		return state;
+	}
+	if (!hardware::readEntry(&selection, state == InputState::ConsecutiveJump))
+		selection = "q"; //end of input quits the game
 
-	//std::cout << selection << '\n';
+	//commands
+	if (selection == "q" || selection == "quit") return InputState::Done;
 	if (selection == "h" || selection == "help")
 	{
-		displayHelp(); getSquare();
+		//the help may scroll the board away, so the next display draws it whole
+		displayHelp(); render::screen.invalidate(); return state;
 	}
 	if (selection == "d" || selection == "display")
 	{
-		displayBoard(squares); getSquare();
+		render::screen.draw(squares, std::cout); return state;
+	}
+	if (state == InputState::ConsecutiveJump)
+	{
+		if (selection == "sk" || selection == "skip") return InputState::Done;
+	}
+	else if (selection == "r" || selection == "reset")
+	{
+		displayBoard(squares);
+		if (state == InputState::Piece) std::cout << "\nCannot reset! No selected piece.\n";
+		return InputState::Piece; //reset option in case no possible target
 	}
-	if (selection == "sv" || selection == "save")
+	if (state == InputState::Piece && (selection == "sv" || selection == "save"))
 	{
 		if (!saveGame(&squares, turn, selector))
 		{
 			std::cout << "Save failed.\n";
 		}
-		getSquare();
+		return state;
 	}
-	if (selection == "r" || selection == "reset")
+	if (state == InputState::Piece && selection == "pdn")
 	{
-		displayBoard(squares); std::cout << "\nCannot reset! No selected piece.\n"; getSquare();
+		if (!pdn::exportGame())
+		{
+			std::cout << "Export failed.\n";
+		}
+		return state;
 	}
-	if (selection == "q" || selection == "quit") return;
-	if (!goodSquare(selection)) getSquare();
-	return;
+
+	//squares
+	if (state == InputState::Piece)
+		return goodSquare(selection) ? InputState::Target : state;
+	if (state == InputState::Target ? !goodTarget(selection) : !goodConsecutiveJmpTarget(selection))
+		return state;
+	updateBoard();
+	if (wasCapture && possibleCapture(&squares[targeted]))
+	{
+		selected = targeted;
+		displayBoard(squares);
+		return InputState::ConsecutiveJump;
+	}
+	return InputState::Done;
 }
 
 bool goodSquare(std::string sq) {
@@ -1579,33 +6590,6 @@ void goodSquare_Test()
 	assert(!goodSquare("c7"));
 
 	std::cout << "goodSquare(): All test cases passed!\n";
-	Sleep(25);
-}
-
-void getTarget() {
-	if (selection == "q" || selection == "quit") return;
-	std::cout << "Enter coordinate of target square (ex. a1, f8):\n";
-	std::cin >> selection;
-	// selection = get_GUI_Input();
-	// std::cout << selection << '\n';
-
-	if (selection == "h" || selection == "help")
-	{
-		displayHelp(); getTarget();
-	}
-	if (selection == "d" || selection == "display")
-	{
-		displayBoard(squares); getTarget();
-	}
-	if (selection == "r" || selection == "reset")	//reset option in case no possible target
-	{
-		displayBoard(squares); getSquare();
-		if (selection == "q" || selection == "quit") return; getTarget();
-	}
-
-	if (selection == "q" || selection == "quit") return;
-	if (!goodTarget(selection)) getTarget();
-	return;
 }
 
 bool goodTarget(std::string sq) {
@@ -1729,7 +6713,6 @@ void goodTarget_Test()
 	assert(!goodTarget(selection));
 
 	std::cout << "goodTarget(): All test cases passed!\n";
-	Sleep(25);
 }
 
 int getAddress(std::string sq)
@@ -1764,7 +6747,6 @@ void getAddress_Test()
 	assert(getAddress(selection) == 25);
 
 	std::cout << "getAddress(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool oneFrSqAway()
@@ -1796,7 +6778,6 @@ void oneFrSqAway_Test()
 	assert(!oneFrSqAway());
 
 	std::cout << "oneFrSqAway(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool oneBcSqAway()
@@ -1828,7 +6809,6 @@ void oneBcSqAway_Test()
 	assert(oneBcSqAway());
 
 	std::cout << "oneBcSqAway(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool twoFrSqAway()
@@ -1860,7 +6840,6 @@ void twoFrSqAway_Test()
 	assert(!twoFrSqAway());
 
 	std::cout << "twoFrSqAway(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool twoBcSqAway()
@@ -1892,7 +6871,6 @@ void twoBcSqAway_Test()
 	assert(twoBcSqAway());
 
 	std::cout << "twoBcSqAway(): All test cases passed!\n";
-	Sleep(25);
 }
 
 char getLetCoordinate(std::string sq)
@@ -1928,7 +6906,6 @@ void getLetCoordinate_Test()
 	assert(getLetCoordinate(selection) == 'c');
 
 	std::cout << "getLetCoordinate(): All test cases passed!\n";
-	Sleep(25);
 }
 
 std::string getSqInBetween(Square* initSq, Square* targetSq)
@@ -2032,8 +7009,6 @@ void getSqInBetween_Test()
 	assert(getSqInBetween(&squares[selected], &squares[targeted]) == "d6");
 
 	std::cout << "getSqInBetween(): All test cases passed!\n";
-	Sleep(25);
-
 }
 
 char getCapDirection(std::string* initSq, std::string* targetSq)
@@ -2092,8 +7067,6 @@ void getCapDirection_Test()
 	assert(getCapDirection(&test_squares_selected, &test_squares_targeted) == Right);
 
 	std::cout << "getCapDirection(): All test cases passed!\n";
-	Sleep(25);
-
 }
 
 char getRowParity(char row)
@@ -2138,7 +7111,6 @@ void getRowParity_Test()
 	assert(getRowParity('8') == Even);
 
 	std::cout << "getRowParity(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool upCapture(Square* initSq, Square* targetSq) {
@@ -2182,7 +7154,6 @@ void upCapture_Test()
 	assert(!upCapture(&squares[selected], &squares[targeted]));
 
 	std::cout << "upCapture(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool downCapture(Square* initSq, Square* targetSq) {
@@ -2226,8 +7197,6 @@ void downCapture_Test()
 	assert(downCapture(&squares[selected], &squares[targeted]));
 
 	std::cout << "downCapture(): All test cases passed!\n";
-	Sleep(25);
-
 }
 
 bool R_Capture1()
@@ -2268,7 +7237,6 @@ void R_Capture1_Test()
 	assert(!R_Capture1());
 
 	std::cout << "R_Capture1(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool R_Capture2()
@@ -2309,7 +7277,6 @@ void R_Capture2_Test()
 	assert(R_Capture2());
 
 	std::cout << "R_Capture2(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool R_Capture3()
@@ -2350,7 +7317,6 @@ void R_Capture3_Test()
 	assert(!R_Capture3());
 
 	std::cout << "R_Capture3(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool R_Capture4()
@@ -2391,7 +7357,6 @@ void R_Capture4_Test()
 	assert(R_Capture4());
 
 	std::cout << "R_Capture4(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool B_Capture1()
@@ -2432,7 +7397,6 @@ void B_Capture1_Test()
 	assert(!B_Capture1());
 
 	std::cout << "B_Capture1(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool B_Capture2()
@@ -2473,7 +7437,6 @@ void B_Capture2_Test()
 	assert(B_Capture2());
 
 	std::cout << "B_Capture2(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool B_Capture3()
@@ -2514,7 +7477,6 @@ void B_Capture3_Test()
 	assert(!B_Capture3());
 
 	std::cout << "B_Capture3(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool B_Capture4()
@@ -2555,7 +7517,6 @@ void B_Capture4_Test()
 	assert(B_Capture4());
 
 	std::cout << "B_Capture4(): All test cases passed!\n";
-	Sleep(25);
 }
 
 char oppoColor(char color) {
@@ -2584,7 +7545,6 @@ void oppoColor_Test()
 	assert(oppoColor(cBlack) == cRed);
 
 	std::cout << "oppoColor(): All test cases passed!\n";
-	Sleep(25);
 }
 
 bool isCapture() {
@@ -2707,10 +7667,12 @@ void isCapture_Test()
 	assert(!isCapture());
 
 	std::cout << "isCapture(): All test cases passed!\n";
-	Sleep(25);
 }
 
 void updateBoard() {
+	history.push_back({ static_cast<std::uint8_t>(selected), static_cast<std::uint8_t>(targeted) });
+	journal::active.append(history.back());
+
 	// 1) resolve piece movement:
 	//to "move" a piece, change targeted square's color to
 	//selected square's color, 
@@ -2791,8 +7753,6 @@ void isPromotion_Test()
 	assert(isPromotion());
 
 	std::cout << "isPromotion(): All test cases passed!\n";
-	Sleep(25);
-
 }
 
 bool possibleCapture(Square* initSq) {
@@ -2916,27 +7876,6 @@ void possibleCapture_Test()
 	assert(!possibleCapture(&squares[30]));
 
 	std::cout << "possibleCapture(): All test cases passed!\n";
-	Sleep(25);
-}
-
-void getConsecutiveJmpTarget() {
-	if (selection == "q" || selection == "quit") return;
-	std::cout << "Current turn is still: " << turn << '\n';
-	std::cout << "Piece to move is on " << squares[selected].square() << ".\n";
-	std::cout << "Enter coordinate of target square for consecutive jump (ex. a1, f8).\n";
-	std::cout << "Or enter 'sk' or 'skip' to skip this consecutive jump.\n";
-	// selection = get_GUI_Input();
-	// std::cout << selection << '\n';
-	std::cin >> selection;
-
-	if (selection == "d" || selection == "display")
-	{
-		displayBoard(squares); getConsecutiveJmpTarget();
-	}
-	if (selection == "q" || selection == "quit") return;
-	if (selection == "sk" || selection == "skip") return; //enter "s" or "skip" to skip consecutive jump
-	if (!goodConsecutiveJmpTarget(selection)) getConsecutiveJmpTarget();
-	return;
 }
 
 bool goodConsecutiveJmpTarget(std::string sq) {
@@ -3079,7 +8018,6 @@ void goodConsecutiveJmpTarget_Test()
 	assert(goodConsecutiveJmpTarget(selection));
 
 	std::cout << "goodConsecutiveJmpTarget(): All test cases passed!\n";
-	Sleep(25);
 }
 
 void displayHelp() {
@@ -3087,7 +8025,8 @@ void displayHelp() {
 		<< "\t'q' to quit\n"
 		<< "\t'd' to display the game board again\n"
 		<< "\t'r' to reset the current turn (to pick a different piece to move)\n"
-		<< "\t'sv' to save the game\n\n";
+		<< "\t'sv' to save the game\n"
+		<< "\t'pdn' to append the game to a PDN archive\n\n";
 }
 
 void displayMenu() {
@@ -3102,26 +8041,15 @@ void displayMods() {
 	std::cout << "Select one of the following options:\n"
 		<< "1) Man VS Man\n"
 		<< "2) Man VS AI\n"
-		<< "3) AI VS AI\n";
+		<< "3) AI VS AI\n"
+		<< "4) AI VS AI match (SPRT)\n";
 }
 
 void playerTurn() {
 	displayBoard(squares);
-	getSquare();
-	if (selection == "q" || selection == "quit") return;
-	getTarget();
-	if (selection == "q" || selection == "quit") return;
-	updateBoard();
-	while (wasCapture && possibleCapture(&squares[targeted]))
-	{
-		selected = targeted;
-		displayBoard(squares);
-		getConsecutiveJmpTarget();
-		if (selection == "q" || selection == "quit") return;
-		if (selection == "sk" || selection == "skip") return; //do this before updateBoard()
-		//otherwise updateBoard removes squares[selected]
-		updateBoard();
-	}
+	InputState state = InputState::Piece;
+	while (state != InputState::Done)
+		state = readInput(state);
 }
 
 /*
@@ -3145,37 +8073,44 @@ TO-DO list:
 */
 
 void AI_Turn() {
+	AI_Turn(match::randomEngine, generator);
+}
+
+void AI_Turn(const match::EngineConfig& engine, prng::Rng& rng) {
 	//getSquare();
 	bool isMove = false;
 	int index[32] = { 0 };
-	for (size_t i = 0; i < squares.size(); ++i)
-	{
-		for (int i = 0; i < 32; i++) {
-			index[i] = i;
-		}
-		shuffleArray(index, 32);
-		if (squares[index[i]].color() == turn || squares[index[i]].color() == reverseCrown(turn))
-		{
-			selection = squares[index[i]].square();
-			if (!goodSquare(selection))
-			{
-				continue;
-			}
-		}
-		else
-			continue;
+	for (int i = 0; i < 32; i++) {
+		index[i] = i;
+	}
+	shuffleArray(index, 32, rng); //shuffle once so every square is visited exactly once
 
-		for (int j = 0; j < 2; ++j)
+	//an engine that prefers captures first looks only at jumps (pass 0),
+	//then at every move (pass 1) if no jump was found
+	for (int pass = engine.preferCaptures ? 0 : 1; pass < 2 && !isMove; ++pass)
+	{
+		for (size_t i = 0; i < squares.size(); ++i)
 		{
-			selection = squares[index[i]].getFrtJmpSqs()[j];
-			if (goodTarget(selection))
+			if (squares[index[i]].color() == turn || squares[index[i]].color() == reverseCrown(turn))
 			{
-				updateBoard();
-				isMove = true;
-				break;
+				selection = squares[index[i]].square();
+				if (!goodSquare(selection))
+				{
+					continue;
+				}
 			}
 			else
+				continue;
+
+			for (int j = 0; j < 2; ++j)
 			{
+				selection = squares[index[i]].getFrtJmpSqs()[j];
+				if (goodTarget(selection))
+				{
+					updateBoard();
+					isMove = true;
+					break;
+				}
 				selection = squares[index[i]].getBacJmpSqs()[j];
 				if (goodTarget(selection))
 				{
@@ -3183,31 +8118,27 @@ void AI_Turn() {
 					isMove = true;
 					break;
 				}
-				else
+				if (pass == 0) continue; //jumps only
+
+				selection = squares[index[i]].getFrtAdjSqs()[j];
+				if (goodTarget(selection))
 				{
-					selection = squares[index[i]].getFrtAdjSqs()[j];
-					if (goodTarget(selection))
-					{
-						updateBoard();
-						isMove = true;
-						break;
-					}
-					else
-					{
-						selection = squares[index[i]].getBacAdjSqs()[j];
-						if (goodTarget(selection))
-						{
-							updateBoard();
-							isMove = true;
-							break;
-						}
-					}
+					updateBoard();
+					isMove = true;
+					break;
+				}
+				selection = squares[index[i]].getBacAdjSqs()[j];
+				if (goodTarget(selection))
+				{
+					updateBoard();
+					isMove = true;
+					break;
 				}
 			}
-		}
 
-		if (isMove)
-			break;
+			if (isMove)
+				break;
+		}
 	}
 }
 
@@ -3256,11 +8187,17 @@ void gameOver_Test()
 	assert(gameOver());
 
 	std::cout << "gameOver(): All test cases passed!\n";
-	Sleep(25);
+}
+
+namespace {
+	//swallows the prompts and error messages the shared game functions print
+	//while AI-vs-AI games are played or watched
+	struct NullBuffer : std::streambuf {
+		int overflow(int c) override { return c; }
+	};
 }
 
 void checkersGame(int selector_) {
-	bool quit = false;
 	bool AI_vs_AI = false;
 	bool Man_vs_AI = false;
 
@@ -3282,41 +8219,79 @@ void checkersGame(int selector_) {
 	break;
 	}
 
-	while (!gameOver() && !quit)
+	//games are played one after another for as long as the user wants
+	while (true)
 	{
-		if (cannotMakeMove())
+		bool quit = false;
+		//the first board of a game is drawn whole, later ones only where they changed
+		render::screen.invalidate();
+
+		//AI VS AI is watched from a render thread at 30 fps; the game thread
+		//only publishes positions and its own messages are muted
+		render::Spectator spectator;
+		NullBuffer nullBuffer;
+		std::streambuf* console = std::cout.rdbuf();
+		std::ostream screenOut(console);
+		if (AI_vs_AI)
+		{
+			spectator.start(squares, screenOut, 30);
+			std::cout.rdbuf(&nullBuffer);
+		}
+
+		//the board starts each game (new, loaded or resumed) from the game's position
+		hardware::sendSnapshot();
+		while (!gameOver() && !quit)
 		{
-			//if there is no possible move for the turn player (which can happen in checkers),
-			//then the game is a draw
-			loser = Both; //this will cause gameOver() to return true
+			//the board gets every move, played here or by the AI
+			const board::Position before = board::toPosition(squares);
+			const char mover = turn;
+			const std::size_t first = history.size();
+			if (cannotMakeMove())
+			{
+				//if there is no possible move for the turn player (which can happen in checkers),
+				//then the game is a draw
+				loser = Both; //this will cause gameOver() to return true
+			}
+			else if (turn == Red)
+			{
+				if (AI_vs_AI)
+					AI_Turn();
+				else
+					playerTurn();
+				if (selection == "q" || selection == "quit") quit = true;
+				turn = oppoColor(turn);
+			}
+			else if (turn == Black)
+			{
+				if (Man_vs_AI || AI_vs_AI)
+					AI_Turn();
+				else
+					playerTurn();
+				if (selection == "q" || selection == "quit") quit = true;
+				turn = oppoColor(turn);
+			}
+			wasCapture = false; //prepare for next turn
+			journal::active.endTurn(generator.draws());
+			if (!quit) hardware::sendMove(before, mover, first);
+			if (AI_vs_AI) spectator.publish({ board::toPosition(squares), turn, static_cast<std::uint32_t>(history.size()) });
 		}
-		else if (turn == Red)
+		if (AI_vs_AI)
 		{
-			if (AI_vs_AI)
-				AI_Turn();
-			else
-				playerTurn();
-			if (selection == "q" || selection == "quit") quit = true;
-			turn = oppoColor(turn);
+			spectator.stop();
+			std::cout.rdbuf(console);
+			render::screen.invalidate(); //the spectator drew over the screen
 		}
-		else if (turn == Black)
+		if (gameOver() && !quit)
 		{
-			if (Man_vs_AI || AI_vs_AI)
-				AI_Turn();
-			else
-				playerTurn();
-			if (selection == "q" || selection == "quit") quit = true;
-			turn = oppoColor(turn);
+			handleLoss();
+			journal::active.discard(); //a finished game has nothing to resume
 		}
-		wasCapture = false; //prepare for next turn
-	}
-	if (gameOver() && !quit)
-	{
-		handleLoss();
-	}
-	if (playAgain()) {
+		journal::active.close();
+		if (!playAgain()) break;
 		prepareGame();
-		checkersGame(selector_);
+		gameSeed = prng::newSeed();
+		generator.seed(gameSeed);
+		startJournal();
 	}
 }
 
@@ -3336,6 +8311,7 @@ void handleLoss() {
 		if (turn == Red) std::cout << "Red cannot make a move.\n";
 		if (turn == Black) std::cout << "Black cannot make a move.\n";
 	}
+	std::cout << "Game seed: " << gameSeed << '\n';
 }
 
 bool playAgain() {
@@ -3343,7 +8319,8 @@ bool playAgain() {
 	std::cout << "\nWould you like to play another game?\n";
 	while (selection != "yes" && selection != "y" && selection != "no" && selection != "n")
 	{
-		std::cout << "Type 'y' or 'n':\n"; std::cin >> selection;
+		std::cout << "Type 'y' or 'n':\n";
+		if (!(std::cin >> selection)) return false;
 	}
 	if (selection == "yes" || selection == "y") return true;
 	return false;
@@ -3356,10 +8333,101 @@ void exit() {
 	std::cin >> c;
 }
 
-void shuffleArray(int* array, int size) {
+void prng::Rng::seed(std::uint64_t seed_) {
+	//expand the 64-bit seed into 128 bits of state with splitmix64,
+	//which never leaves the state all zero
+	for (int i = 0; i < 4; i += 2)
+	{
+		std::uint64_t z = (seed_ += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		s[i] = static_cast<std::uint32_t>(z);
+		s[i + 1] = static_cast<std::uint32_t>(z >> 32);
+	}
+	drawn = 0;
+}
+
+std::uint32_t prng::Rng::next() {
+	const std::uint32_t x = s[1] * 5;
+	const std::uint32_t result = ((x << 7) | (x >> 25)) * 9;
+	const std::uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 11) | (s[3] >> 21);
+
+	++drawn;
+	return result;
+}
+
+std::uint32_t prng::Rng::below(std::uint32_t bound) {
+	//multiply-shift with rejection of the few values that would bias the result
+	std::uint64_t m = static_cast<std::uint64_t>(next()) * bound;
+	std::uint32_t low = static_cast<std::uint32_t>(m);
+	if (low < bound)
+	{
+		const std::uint32_t threshold = (0u - bound) % bound;
+		while (low < threshold)
+		{
+			m = static_cast<std::uint64_t>(next()) * bound;
+			low = static_cast<std::uint32_t>(m);
+		}
+	}
+	return static_cast<std::uint32_t>(m >> 32);
+}
+
+void prng::Rng::skip(std::uint64_t count) {
+	for (std::uint64_t i = 0; i < count; ++i) next();
+}
+
+std::uint64_t prng::newSeed() {
+	std::random_device device;
+	return (static_cast<std::uint64_t>(device()) << 32) | device();
+}
+
+void prng::Rng_Test()
+{
+	// Test case 1: the same seed gives the same sequence
+	Rng a(42), b(42);
+	for (int i = 0; i < 100; ++i)
+		assert(a.next() == b.next());
+
+	// Test case 2: different seeds give different sequences
+	Rng c(43);
+	a.seed(42);
+	bool differ = false;
+	for (int i = 0; i < 4; ++i)
+		if (a.next() != c.next()) differ = true;
+	assert(differ);
+
+	// Test case 3: below() stays within its bound and reaches every value
+	bool seen[6] = { false };
+	for (int i = 0; i < 600; ++i)
+	{
+		std::uint32_t v = a.below(6);
+		assert(v < 6);
+		seen[v] = true;
+	}
+	for (int i = 0; i < 6; ++i)
+		assert(seen[i]);
+
+	// Test case 4: reseeding restarts the sequence
+	a.seed(7);
+	std::uint32_t firstValue = a.next();
+	a.seed(7);
+	assert(a.next() == firstValue);
+
+	std::cout << "Rng(): All test cases passed!\n";
+}
+
+void shuffleArray(int* array, int size, prng::Rng& gen) {
 	for (int i = size - 1; i > 0; --i) {
 		//generate random index
-		int j = rand() % (i + 1);
+		int j = static_cast<int>(gen.below(static_cast<std::uint32_t>(i + 1)));
 
 		//swap array[i] and array[j]
 		int temp = array[i];
@@ -3370,14 +8438,14 @@ void shuffleArray(int* array, int size) {
 
 void shuffleArray_Test()
 {
-	srand(time(NULL)); // Seed for randomness
+	prng::Rng gen(12345); // Fixed seed, so the test is reproducible
 
 	const int size = 5;
 	int original[size] = { 1, 2, 3, 4, 5 };
 	int testArray[size];
 
 	std::copy(original, original + size, testArray);
-	shuffleArray(testArray, size);
+	shuffleArray(testArray, size, gen);
 
 	// Test 1: Array size should remain the same
 	assert(sizeof(testArray) == sizeof(original));
@@ -3385,7 +8453,7 @@ void shuffleArray_Test()
 	// Test 2: Test for randomness (not perfect, but a basic check)
 	int anotherTestArray[size];
 	std::copy(original, original + size, anotherTestArray);
-	shuffleArray(anotherTestArray, size);
+	shuffleArray(anotherTestArray, size, gen);
 
 	bool arraysDiffer = false;
 	for (int i = 0; i < size; ++i) {
@@ -3396,8 +8464,938 @@ void shuffleArray_Test()
 	}
 	assert(arraysDiffer);
 
+	// Test 3: The same seed gives the same permutation
+	prng::Rng first(777), second(777);
+	std::copy(original, original + size, testArray);
+	std::copy(original, original + size, anotherTestArray);
+	shuffleArray(testArray, size, first);
+	shuffleArray(anotherTestArray, size, second);
+	assert(std::equal(testArray, testArray + size, anotherTestArray));
+
 	std::cout << "shuffleArray(): All test cases passed!\n";
-	Sleep(25);
+}
+
+const match::EngineConfig match::randomEngine = { "random", false };
+const match::EngineConfig match::greedyEngine = { "greedy", true };
+
+double match::scoreFromElo(double elo) {
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+double match::eloFromScore(double score) {
+	//keep the score away from 0 and 1, where the Elo difference is infinite
+	if (score < 0.001) score = 0.001;
+	if (score > 0.999) score = 0.999;
+	return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+void match::eloEstimate(const Score& s, double* elo, double* margin) {
+	const int games = s.wins + s.draws + s.losses;
+	if (games == 0)
+	{
+		*elo = 0.0; *margin = 0.0; return;
+	}
+	const double n = games;
+	const double w = s.wins / n, d = s.draws / n, l = s.losses / n;
+	const double mu = w + d / 2.0;
+	//variance of a single game result around the mean score
+	const double var = w * (1.0 - mu) * (1.0 - mu) + d * (0.5 - mu) * (0.5 - mu) + l * mu * mu;
+	const double delta = 1.959964 * std::sqrt(var / n); //95% interval of the mean score
+
+	*elo = eloFromScore(mu);
+	*margin = (eloFromScore(mu + delta) - eloFromScore(mu - delta)) / 2.0;
+}
+
+void match::eloEstimate_Test()
+{
+	double elo = 0.0, margin = 0.0;
+
+	// Test case 1: equal score gives no Elo difference
+	Score even;
+	even.wins = 10; even.draws = 5; even.losses = 10;
+	eloEstimate(even, &elo, &margin);
+	assert(std::fabs(elo) < 1e-9);
+	assert(margin > 0.0);
+
+	// Test case 2: 75% score is about +191 Elo
+	Score ahead;
+	ahead.wins = 75; ahead.losses = 25;
+	eloEstimate(ahead, &elo, &margin);
+	assert(elo > 190.0 && elo < 192.0);
+
+	// Test case 3: more games give a narrower error bar
+	double smallMargin = 0.0;
+	ahead.wins = 750; ahead.losses = 250;
+	eloEstimate(ahead, &elo, &smallMargin);
+	assert(smallMargin < margin);
+
+	// Test case 4: score and Elo conversions are inverse
+	assert(std::fabs(eloFromScore(scoreFromElo(35.0)) - 35.0) < 1e-6);
+
+	std::cout << "eloEstimate(): All test cases passed!\n";
+}
+
+double match::sprtLLR(const Score& s, double elo0, double elo1) {
+	const int games = s.wins + s.draws + s.losses;
+	if (games == 0 || s.wins + s.draws == 0 || s.losses + s.draws == 0) return 0.0;
+
+	const double n = games;
+	const double w = s.wins / n, d = s.draws / n, l = s.losses / n;
+	const double mu = w + d / 2.0;
+	const double var = w * (1.0 - mu) * (1.0 - mu) + d * (0.5 - mu) * (0.5 - mu) + l * mu * mu;
+	if (var <= 0.0) return 0.0;
+
+	const double mu0 = scoreFromElo(elo0);
+	const double mu1 = scoreFromElo(elo1);
+	return (mu1 - mu0) * (2.0 * mu - mu0 - mu1) * n / (2.0 * var);
+}
+
+void match::sprtLLR_Test()
+{
+	// Test case 1: no games, no evidence
+	Score s;
+	assert(sprtLLR(s, 0.0, 50.0) == 0.0);
+
+	// Test case 2: a clearly winning score favors H1
+	s.wins = 300; s.draws = 100; s.losses = 100;
+	assert(sprtLLR(s, 0.0, 50.0) > std::log((1.0 - 0.05) / 0.05));
+
+	// Test case 3: an even score favors H0
+	s.wins = 200; s.draws = 100; s.losses = 200;
+	assert(sprtLLR(s, 0.0, 50.0) < std::log(0.05 / (1.0 - 0.05)));
+
+	// Test case 4: a score exactly between H0 and H1 is undecided
+	s.wins = 100; s.draws = 50; s.losses = 100;
+	assert(std::fabs(sprtLLR(s, -10.0, 10.0)) < 1e-9);
+
+	std::cout << "sprtLLR(): All test cases passed!\n";
+}
+
+char match::playGame(const EngineConfig& red, const EngineConfig& black,
+	const std::vector<Square>& opening, char openingTurn, int maxPlies, std::uint64_t seed) {
+	squares = opening;
+	turn = openingTurn;
+	gameSeed = seed;
+	prng::Rng rng(seed);
+	history.clear();
+	startPosition = board::toPosition(opening);
+	startTurn = openingTurn;
+	loser = ' ';
+	wasCapture = false;
+
+	int plies = 0;
+	while (!gameOver())
+	{
+		if (plies >= maxPlies || cannotMakeMove())
+		{
+			loser = Both; //adjudicate as a draw
+		}
+		else
+		{
+			AI_Turn(turn == Red ? red : black, rng);
+			turn = oppoColor(turn);
+			++plies;
+		}
+		wasCapture = false;
+	}
+	return loser;
+}
+
+match::Score match::runMatch(const EngineConfig& first, const EngineConfig& second, const Settings& settings) {
+	const double lower = std::log(settings.beta / (1.0 - settings.alpha));
+	const double upper = std::log((1.0 - settings.beta) / settings.alpha);
+	Score score;
+
+	std::cout << "Match: " << first.name << " VS " << second.name
+		<< ", SPRT H0: " << settings.elo0 << " H1: " << settings.elo1
+		<< ", bounds [" << lower << ", " << upper << "], seed " << settings.seed << '\n';
+
+	NullBuffer nullBuffer;
+	std::streambuf* console = std::cout.rdbuf();
+
+	for (int o = 0; o < settings.openings; ++o)
+	{
+		std::cout.rdbuf(&nullBuffer);
+
+		//make an opening by playing a few random plies from the start position
+		std::vector<Square> opening;
+		char openingTurn = Red;
+		const std::uint64_t seed = settings.seed + static_cast<std::uint64_t>(o) * 3;
+		prng::Rng rng(seed);
+		do
+		{
+			prepareGame();
+			for (int ply = 0; ply < settings.openingPlies && !gameOver() && !cannotMakeMove(); ++ply)
+			{
+				AI_Turn(randomEngine, rng);
+				turn = oppoColor(turn);
+				wasCapture = false;
+			}
+		} while (gameOver() || cannotMakeMove());
+		opening = squares;
+		openingTurn = turn;
+
+		//play the opening twice, once with each engine on each color
+		char result1 = playGame(first, second, opening, openingTurn, settings.maxPlies, seed + 1);
+		char result2 = playGame(second, first, opening, openingTurn, settings.maxPlies, seed + 2);
+		std::cout.rdbuf(console);
+
+		if (result1 == Both) ++score.draws; else if (result1 == Black) ++score.wins; else ++score.losses;
+		if (result2 == Both) ++score.draws; else if (result2 == Red) ++score.wins; else ++score.losses;
+
+		double elo = 0.0, margin = 0.0;
+		eloEstimate(score, &elo, &margin);
+		const double llr = sprtLLR(score, settings.elo0, settings.elo1);
+		std::cout << "Games: " << score.wins + score.draws + score.losses
+			<< "  W/D/L: " << score.wins << '/' << score.draws << '/' << score.losses
+			<< "  Elo: " << elo << " +/- " << margin
+			<< "  LLR: " << llr << '\n';
+
+		if (llr >= upper) { std::cout << "H1 accepted: " << first.name << " gains at least " << settings.elo1 << " Elo.\n"; return score; }
+		if (llr <= lower) { std::cout << "H0 accepted: " << first.name << " does not gain " << settings.elo1 << " Elo.\n"; return score; }
+	}
+	std::cout << "No decision after " << settings.openings << " openings.\n";
+	return score;
+}
+
+void matchMenu() {
+	match::Settings settings;
+	std::cout << "Engine " << match::greedyEngine.name << " will be tested against engine "
+		<< match::randomEngine.name << ".\n";
+	std::cout << "Enter Elo gain for H0 and H1 (ex. 0 50):\n";
+	std::cout << ">> ";
+	if (!(std::cin >> settings.elo0 >> settings.elo1) || settings.elo1 <= settings.elo0)
+	{
+		std::cin.clear();
+		std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		std::cout << "Invalid bounds, using H0: 0 H1: 50.\n";
+		settings.elo0 = 0.0; settings.elo1 = 50.0;
+	}
+	settings.seed = prng::newSeed();
+	match::runMatch(match::greedyEngine, match::randomEngine, settings);
+	prepareGame(); //the match leaves its last game on the board
+}
+
+int runTool(int argc, char* argv[]) {
+	const std::string tool = argv[1];
+	if (tool == "pdn-stats" && argc == 3)
+	{
+		//parse a PDN archive and report its size and the parse speed
+		std::ifstream archive(argv[2], std::ios::binary);
+		if (!archive.is_open())
+		{
+			std::cerr << "Unable to open " << argv[2] << '\n';
+			return 1;
+		}
+		pdn::Reader reader(archive);
+		pdn::Game game;
+		std::string message;
+		long games = 0, errors = 0;
+		const auto begin = std::chrono::steady_clock::now();
+		for (pdn::Reader::Status status; (status = reader.next(&game, &message)) != pdn::Reader::Status::End; )
+		{
+			if (status == pdn::Reader::Status::Error) { ++errors; std::cerr << message << '\n'; }
+			else ++games;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << "Games: " << games << ", errors: " << errors << ", moves: " << reader.hopCount()
+			<< ", time: " << seconds << " s, moves/sec: " << (seconds > 0 ? reader.hopCount() / seconds : 0.0) << '\n';
+		return errors ? 1 : 0;
+	}
+
+	if (tool == "db-build" && argc >= 4)
+	{
+		//collect games from PDN archives and saved games into one database
+		gamedb::Builder builder;
+		std::string message;
+		for (int i = 3; i < argc; ++i)
+		{
+			if (builder.addFile(argv[i], &message) < 0) std::cerr << message << '\n';
+		}
+		std::ofstream out(argv[2], std::ios::binary);
+		if (!out.is_open())
+		{
+			std::cerr << "Unable to open " << argv[2] << '\n';
+			return 1;
+		}
+		builder.write(out);
+		std::cout << "Games: " << builder.gameCount() << '\n';
+		return 0;
+	}
+	if (tool == "db-query" && argc == 4)
+	{
+		//how often did the position of a saved game occur, and how did it score?
+		gamedb::Database db;
+		std::string message;
+		if (!db.open(argv[2], &message))
+		{
+			std::cerr << message << '\n';
+			return 1;
+		}
+		std::ifstream file(argv[3], std::ios::binary);
+		std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		save::GameState state;
+		const bool binary = std::string(argv[3]).substr(std::string(argv[3]).find_last_of(".") + 1) == "ckb";
+		if (!(binary ? save::decodeBinary(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size(), &state)
+			: save::parseIni(contents, &state, &message)))
+		{
+			std::cerr << argv[3] << " is not a saved game\n";
+			return 1;
+		}
+		const std::uint64_t key = board::hash(state.position, state.turn);
+		const auto begin = std::chrono::steady_clock::now();
+		const gamedb::PositionRecord* record = db.find(key);
+		const double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+		if (!record)
+		{
+			std::cout << "Position not found (" << micros << " us)\n";
+			return 0;
+		}
+		std::cout << "Occurrences: " << record->occurrences << ", red wins: " << record->redWins
+			<< ", draws: " << record->draws << ", black wins: " << record->blackWins << " (" << micros << " us)\n";
+		for (std::uint32_t i = 0; i < record->occurrences && i < 10; ++i)
+			std::cout << "\tgame " << db.occurrences(*record)[i].game << ", after hop " << db.occurrences(*record)[i].hop << '\n';
+		return 0;
+	}
+
+	if ((tool == "pack" && (argc == 4 || argc == 5)) || (tool == "unpack" && argc == 4))
+	{
+		//convert between PDN and packed archives: magic "CKMA", coding, then for every
+		//game a flags byte (1 = start position follows), the result, the start position
+		//(3 masks and the side to move) if flagged, and the encoded hops
+		std::ifstream in(argv[2], std::ios::binary);
+		std::ofstream out(argv[3], std::ios::binary);
+		if (!in.is_open() || !out.is_open())
+		{
+			std::cerr << "Unable to open " << (in.is_open() ? argv[3] : argv[2]) << '\n';
+			return 1;
+		}
+		const char* resultNames[4] = { "*", "1-0", "1/2-1/2", "0-1" };
+		pdn::Game game;
+		long games = 0, skipped = 0;
+		long long hops = 0;
+		std::vector<std::uint8_t> bytes;
+		const auto begin = std::chrono::steady_clock::now();
+		if (tool == "pack")
+		{
+			const movecodec::Coding coding = argc == 5 && std::string(argv[4]) == "ranked"
+				? movecodec::Coding::Ranked : movecodec::Coding::Fixed;
+			bytes = { 'C', 'K', 'M', 'A', static_cast<std::uint8_t>(coding) };
+			const board::Position standard = board::startPosition();
+			pdn::Reader reader(in);
+			std::string message;
+			for (pdn::Reader::Status status; (status = reader.next(&game, &message)) != pdn::Reader::Status::End; )
+			{
+				if (status == pdn::Reader::Status::Error) { ++skipped; continue; }
+				const size_t mark = bytes.size();
+				const bool custom = game.start.red != standard.red || game.start.black != standard.black
+					|| game.start.kings != standard.kings || game.startTurn != Red;
+				std::uint8_t result = 0;
+				for (std::uint8_t r = 1; r < 4; ++r)
+					if (game.result == resultNames[r]) result = r;
+				bytes.push_back(custom ? 1 : 0);
+				bytes.push_back(result);
+				if (custom)
+				{
+					for (std::uint32_t mask : { game.start.red, game.start.black, game.start.kings })
+						for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<std::uint8_t>(mask >> (8 * i)));
+					bytes.push_back(static_cast<std::uint8_t>(game.startTurn));
+				}
+				if (!movecodec::encode(game.start, game.startTurn, game.hops, coding, &bytes))
+				{
+					bytes.resize(mark); //a hop the move generator does not know
+					++skipped;
+					continue;
+				}
+				++games;
+				hops += static_cast<long long>(game.hops.size());
+			}
+			out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			in.clear();
+			in.seekg(0, std::ios::end);
+			std::cout << "PDN bytes: " << in.tellg() << ", packed bytes: " << bytes.size() << " (" << bytes.size() * 8.0 / (hops ? hops : 1) << " bits per hop)\n";
+		}
+		else
+		{
+			bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			if (bytes.size() < 5 || std::memcmp(bytes.data(), "CKMA", 4) != 0 || bytes[4] > 1)
+			{
+				std::cerr << argv[2] << " is not a packed archive\n";
+				return 1;
+			}
+			const movecodec::Coding coding = static_cast<movecodec::Coding>(bytes[4]);
+			for (size_t pos = 5; pos < bytes.size(); ++games)
+			{
+				if (bytes.size() - pos < 2 || bytes[pos] > 1 || bytes[pos + 1] > 3) { ++skipped; break; }
+				const bool custom = bytes[pos] == 1;
+				game.tags = { { "Result", resultNames[bytes[pos + 1]] } };
+				game.result = resultNames[bytes[pos + 1]];
+				game.start = board::startPosition();
+				game.startTurn = Red;
+				pos += 2;
+				if (custom)
+				{
+					if (bytes.size() - pos < 13) { ++skipped; break; }
+					std::uint32_t masks[3] = { 0 };
+					for (int m = 0; m < 3; ++m)
+						for (int i = 0; i < 4; ++i) masks[m] |= static_cast<std::uint32_t>(bytes[pos++]) << (8 * i);
+					game.start = { masks[0], masks[1], masks[2] };
+					game.startTurn = static_cast<char>(bytes[pos++]);
+					//the length of the game is only known by decoding it, so the rest is lost too
+					if (!movecodec::isValid(game.start, game.startTurn)) { ++skipped; break; }
+				}
+				const size_t used = movecodec::decode(bytes.data() + pos, bytes.size() - pos, game.start, game.startTurn, coding, &game.hops);
+				if (used == 0) { ++skipped; break; }
+				pos += used;
+				hops += static_cast<long long>(game.hops.size());
+				pdn::writeGame(out, game);
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << "Games: " << games << ", skipped: " << skipped << ", moves: " << hops
+			<< ", time: " << seconds << " s, moves/sec: " << (seconds > 0 ? hops / seconds : 0.0) << '\n';
+		return skipped ? 1 : 0;
+	}
+
+	if (tool == "positions" && (argc == 4 || argc == 5))
+	{
+		//write every position of a PDN archive (before each move and at the end) to a position file
+		std::ifstream in(argv[2], std::ios::binary);
+		std::ofstream out(argv[3], std::ios::binary);
+		if (!in.is_open() || !out.is_open())
+		{
+			std::cerr << "Unable to open " << (in.is_open() ? argv[3] : argv[2]) << '\n';
+			return 1;
+		}
+		const bool variable = argc == 5 && std::string(argv[4]) == "variable";
+		std::vector<poscodec::Record> records;
+		pdn::Reader reader(in);
+		pdn::Game game;
+		std::string message;
+		for (pdn::Reader::Status status; (status = reader.next(&game, &message)) != pdn::Reader::Status::End; )
+		{
+			if (status == pdn::Reader::Status::Error) continue;
+			poscodec::Record record = { game.start, game.startTurn };
+			records.push_back(record);
+			for (size_t i = 0; i < game.hops.size(); ++i)
+			{
+				board::applyHop(&record.position, game.hops[i]);
+				const bool continues = i + 1 < game.hops.size() && game.hops[i + 1].from == game.hops[i].to
+					&& board::isJump(game.hops[i]) && board::isJump(game.hops[i + 1]);
+				if (continues) continue;
+				record.turn = (record.position.red >> game.hops[i].to & 1u) ? Black : Red;
+				records.push_back(record);
+			}
+		}
+
+		const auto begin = std::chrono::steady_clock::now();
+		std::vector<std::uint8_t> bytes = { 'C', 'K', 'P', 'S', static_cast<std::uint8_t>(variable ? 1 : 0) };
+		for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<std::uint8_t>(records.size() >> (8 * i)));
+		const size_t header = bytes.size();
+		if (variable)
+			poscodec::encodeVariable(records.data(), records.size(), &bytes);
+		else
+		{
+			bytes.resize(header + records.size() * poscodec::fixedSize);
+			poscodec::encodeFixed(records.data(), records.size(), bytes.data() + header);
+		}
+		const auto encoded = std::chrono::steady_clock::now();
+		std::vector<poscodec::Record> check(records.size());
+		if (variable)
+			poscodec::decodeVariable(bytes.data() + header, bytes.size() - header, check.size(), check.data());
+		else
+			poscodec::decodeFixed(bytes.data() + header, check.size(), check.data());
+		const auto decoded = std::chrono::steady_clock::now();
+		out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+		auto rate = [&](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+			const double seconds = std::chrono::duration<double>(to - from).count();
+			return seconds > 0 ? records.size() / seconds : 0.0;
+		};
+		std::cout << "Positions: " << records.size() << ", bytes: " << bytes.size() - header
+			<< " (" << (records.empty() ? 0.0 : double(bytes.size() - header) / records.size()) << " per position)"
+			<< ", encode/sec: " << rate(begin, encoded) << ", decode/sec: " << rate(encoded, decoded) << '\n';
+		return 0;
+	}
+
+	if (tool == "convert" && (argc == 4 || argc == 5))
+	{
+		//parse every saved game (.ini) under a directory on a pool of threads and
+		//write their distinct positions, sorted by hash, to one position file
+		std::vector<std::filesystem::path> files;
+		std::error_code walkError;
+		for (std::filesystem::recursive_directory_iterator it(argv[2], walkError), end; !walkError && it != end; it.increment(walkError))
+		{
+			if (it->is_regular_file() && it->path().extension() == ".ini") files.push_back(it->path());
+		}
+		if (walkError)
+		{
+			std::cerr << "Unable to read " << argv[2] << ": " << walkError.message() << '\n';
+			return 1;
+		}
+
+		struct Found { std::uint64_t hash; poscodec::Record record; };
+		struct Worker { std::vector<Found> found; std::vector<std::string> errors; };
+		const unsigned threads = argc == 5 ? static_cast<unsigned>(std::max(1, std::atoi(argv[4])))
+			: std::max(1u, std::thread::hardware_concurrency());
+		std::vector<Worker> workers(threads);
+		std::atomic<size_t> nextFile(0);
+		const auto begin = std::chrono::steady_clock::now();
+		auto work = [&](Worker* worker) {
+			std::string contents, message;
+			save::GameState state;
+			for (size_t i; (i = nextFile.fetch_add(1, std::memory_order_relaxed)) < files.size(); )
+			{
+				std::ifstream file(files[i], std::ios::binary | std::ios::ate);
+				contents.resize(file.is_open() ? static_cast<size_t>(file.tellg()) : 0);
+				file.seekg(0);
+				if (!file.is_open() || !file.read(&contents[0], contents.size()))
+				{
+					worker->errors.push_back(files[i].string() + ": unable to read");
+					continue;
+				}
+				if (!save::parseIni(contents, &state, &message))
+				{
+					worker->errors.push_back(files[i].string() + ": " + message);
+					continue;
+				}
+				worker->found.push_back({ board::hash(state.position, state.turn), { state.position, state.turn } });
+			}
+		};
+		std::vector<std::thread> pool;
+		for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work, &workers[t]);
+		work(&workers[0]);
+		for (std::thread& thread : pool) thread.join();
+
+		std::vector<Found> found;
+		size_t malformed = 0;
+		for (Worker& worker : workers)
+		{
+			found.insert(found.end(), worker.found.begin(), worker.found.end());
+			malformed += worker.errors.size();
+			for (const std::string& message : worker.errors) std::cerr << message << '\n';
+		}
+		std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.hash < b.hash; });
+		found.erase(std::unique(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.hash == b.hash; }), found.end());
+
+		std::vector<poscodec::Record> records;
+		records.reserve(found.size());
+		for (const Found& f : found) records.push_back(f.record);
+		std::vector<std::uint8_t> bytes = { 'C', 'K', 'P', 'S', 0 };
+		for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<std::uint8_t>(records.size() >> (8 * i)));
+		bytes.resize(bytes.size() + records.size() * poscodec::fixedSize);
+		poscodec::encodeFixed(records.data(), records.size(), bytes.data() + 9);
+		std::ofstream out(argv[3], std::ios::binary);
+		if (!out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+		{
+			std::cerr << "Unable to write " << argv[3] << '\n';
+			return 1;
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << "Files: " << files.size() << ", malformed: " << malformed << ", distinct positions: " << records.size()
+			<< ", threads: " << threads << ", time: " << seconds << " s, files/sec: " << (seconds > 0 ? files.size() / seconds : 0.0) << '\n';
+		return malformed ? 1 : 0;
+	}
+
+	if (tool == "script" && argc == 3)
+	{
+		//replay games, one per line, and print only how each one ends
+		std::ifstream file;
+		if (std::string(argv[2]) != "-") file.open(argv[2]);
+		if (std::string(argv[2]) != "-" && !file.is_open())
+		{
+			std::cerr << "Unable to open " << argv[2] << '\n';
+			return 1;
+		}
+		std::istream& in = file.is_open() ? static_cast<std::istream&>(file) : std::cin;
+		std::string line, message;
+		long lineNumber = 0, games = 0, errors = 0, moves = 0;
+		const auto begin = std::chrono::steady_clock::now();
+		while (std::getline(in, line))
+		{
+			++lineNumber;
+			if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') continue;
+			script::Game game;
+			++games;
+			const bool ok = script::play(line, &game, &message);
+			moves += game.moves;
+			if (!ok)
+			{
+				++errors;
+				std::cout << "line " << lineNumber << ": error, " << message << '\n';
+			}
+			else
+				std::cout << "line " << lineNumber << ": " << game.moves << " moves, " << script::outcome(game) << '\n';
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		std::cerr << "Games: " << games << ", errors: " << errors << ", moves: " << moves
+			<< ", time: " << seconds << " s\n";
+		return errors ? 1 : 0;
+	}
+
+	if (tool == "play" && (argc == 3 || argc == 4))
+	{
+		//the game, kept in step with the board (see namespace hardware)
+		auto port = std::make_unique<transport::SerialPort>();
+		if (!port->open(argv[2], argc == 4 ? std::atoi(argv[3]) : 115200))
+		{
+			std::cerr << "Unable to open " << argv[2] << '\n';
+			return 1;
+		}
+		//std::cin keeps its own buffer, so the words left on a line are seen without waiting
+		std::ios::sync_with_stdio(false);
+		transport::Link link;
+		link.start(std::move(port));
+		link.send(PROTOCOL_MSG_HELLO, nullptr, 0);
+		hardware::link = &link;
+		const int code = menu();
+		//the last moves are not lost when the game ends right after them
+		const auto end = std::chrono::steady_clock::now();
+		while (!link.idle() && link.isOpen() && std::chrono::steady_clock::now() - end < std::chrono::seconds(1))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		hardware::link = nullptr;
+		return code;
+	}
+
+	if (tool == "board" && (argc == 3 || argc == 4))
+	{
+		//talk to the board (or checkers-sim) by hand: each line is sent as a frame
+		auto port = std::make_unique<transport::SerialPort>();
+		if (!port->open(argv[2], argc == 4 ? std::atoi(argv[3]) : 115200))
+		{
+			std::cerr << "Unable to open " << argv[2] << '\n';
+			return 1;
+		}
+		transport::Link link;
+		link.start(std::move(port));
+		link.send(PROTOCOL_MSG_HELLO, nullptr, 0);
+		static const char* const statuses[] = { "ok", "bad CRC", "unknown type", "bad payload", "empty slot",
+			"illegal move", "no move", "out of sync", "flash write failed" };
+		std::cout << "Enter moves (c3-d4, c3xe5), 'new', 'ai [depth]', 'sync', 'save <slot> [mode]', 'load <slot>', "
+			"'list', 'ping' or 'stats'; end of input quits.\n";
+
+		//our copy of the board: moves are sent on its hash, snapshots replace it
+		board::Position pos = board::startPosition();
+		char turn = Red;
+		const auto play = [&](const board::Hop* hops, int count) {
+			for (int i = 0; i < count; ++i) board::applyHop(&pos, hops[i]);
+			turn = turn == Red ? Black : Red;
+		};
+
+		std::string line;
+		while (std::getline(std::cin, line) && link.isOpen())
+		{
+			std::istringstream words(line);
+			std::string word;
+			if (!(words >> word)) continue;
+			std::uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+			board::Hop hops[PROTOCOL_MAX_PAYLOAD / 2];
+			int hopCount = 0;
+			std::uint8_t length = 0, type = PROTOCOL_MSG_MOVE;
+			int slot = -1;
+			if (word == "stats")
+			{
+				link.stats().dump(std::cout);
+				continue;
+			}
+			if (word == "new") type = PROTOCOL_MSG_NEW_GAME;
+			else if (word == "sync") type = PROTOCOL_MSG_BOARD_SYNC;
+			else if (word == "ping") type = PROTOCOL_MSG_PING;
+			else if (word == "list") type = PROTOCOL_MSG_LIST;
+			else if (word == "ai")
+			{
+				//the board searches and plays the move itself
+				int depth = 0;
+				type = PROTOCOL_MSG_AI_MOVE;
+				if ((words >> depth) && depth > 0 && depth < 256) payload[length++] = static_cast<std::uint8_t>(depth);
+			}
+			else if ((word == "save" || word == "load") && (words >> slot) && slot >= 0 && slot < 256)
+			{
+				//the board keeps the game mode with the game, as the INI saves do
+				int mode = 0;
+				type = word == "save" ? PROTOCOL_MSG_SAVE : PROTOCOL_MSG_LOAD;
+				payload[length++] = static_cast<std::uint8_t>(slot);
+				if (type == PROTOCOL_MSG_SAVE && (words >> mode) && mode >= 0 && mode < 256)
+					payload[length++] = static_cast<std::uint8_t>(mode);
+			}
+			else
+			{
+				//squares joined by '-' or 'x'; each square after the first ends a hop
+				int from = board::squareIndex(word.substr(0, 2));
+				for (std::size_t i = 3; from >= 0 && i + 2 <= word.size() && PROTOCOL_HASH_SIZE + 2 * (hopCount + 1) <= PROTOCOL_MAX_PAYLOAD; i += 3)
+				{
+					const int to = board::squareIndex(word.substr(i, 2));
+					if (to < 0) break;
+					hops[hopCount++] = board::Hop{ static_cast<std::uint8_t>(from), static_cast<std::uint8_t>(to) };
+					from = to;
+				}
+				if (hopCount == 0 || word.size() != 3 * std::size_t(hopCount) + 2)
+				{
+					std::cout << "Not a move: " << word << '\n';
+					continue;
+				}
+				const std::uint16_t hash = wire::boardHash(pos, turn);
+				payload[length++] = static_cast<std::uint8_t>(hash >> 8);
+				payload[length++] = static_cast<std::uint8_t>(hash);
+				for (int i = 0; i < hopCount; ++i)
+				{
+					payload[length++] = hops[i].from;
+					payload[length++] = hops[i].to;
+				}
+			}
+
+			const int seq = type == PROTOCOL_MSG_PING ? link.ping() : link.send(type, payload, length);
+			const auto sent = std::chrono::steady_clock::now();
+			bool acked = false, following = false;
+			transport::Event event;
+			while ((!acked || following) && link.isOpen() && std::chrono::steady_clock::now() - sent < std::chrono::seconds(2))
+			{
+				if (!link.poll(&event))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+				const Protocol_Frame& frame = event.frame;
+				board::Hop played[PROTOCOL_MAX_PAYLOAD / 2];
+				save::GameState game;
+				std::vector<wire::SavedGame> games;
+				int savedSlot = -1;
+				std::uint16_t hash = 0;
+				int count = 0;
+				if (frame.type == PROTOCOL_MSG_ACK && frame.length >= 2)
+				{
+					const std::uint8_t status = frame.payload[1];
+					if (frame.payload[0] == seq)
+					{
+						acked = true;
+						//these answers are followed by a snapshot, the board's move or the PING echo
+						following = status == PROTOCOL_ILLEGAL_MOVE || status == PROTOCOL_OUT_OF_SYNC
+							|| (status == PROTOCOL_OK && (type == PROTOCOL_MSG_LOAD || type == PROTOCOL_MSG_AI_MOVE
+							|| type == PROTOCOL_MSG_PING || type == PROTOCOL_MSG_LIST
+							|| (type == PROTOCOL_MSG_BOARD_SYNC && length == 0)));
+						if (status == PROTOCOL_OK && type == PROTOCOL_MSG_MOVE) play(hops, hopCount);
+						if (status == PROTOCOL_OK && type == PROTOCOL_MSG_NEW_GAME)
+						{
+							pos = board::startPosition();
+							turn = Red;
+						}
+					}
+					std::cout << "ack " << int(frame.payload[0]) << ": "
+						<< (status < 9 ? statuses[status] : "?") << " after "
+						<< std::chrono::duration<double, std::milli>(event.received - sent).count() << " ms";
+					if (frame.length >= PROTOCOL_ACK_SIZE)
+						std::cout << ", " << (frame.payload[2] | frame.payload[3] << 8) * PROTOCOL_ACK_TIME_UNIT << " us on the board";
+					std::cout << '\n';
+				}
+				else if (wire::readGame(frame, &savedSlot, &game))
+				{
+					//the board's saved game, with the hops that led to it
+					following = false;
+					pos = game.position;
+					turn = game.turn;
+					std::cout << "slot " << savedSlot << ": mode " << game.selector << ", " << turn << " to move, last hops:";
+					for (const board::Hop& hop : game.history)
+						std::cout << ' ' << board::squareName(hop.from) << (board::isJump(hop) ? 'x' : '-') << board::squareName(hop.to);
+					std::cout << '\n';
+				}
+				else if (wire::readList(frame, &games))
+				{
+					following = false;
+					if (games.empty()) std::cout << "No saved games.\n";
+					for (const wire::SavedGame& saved : games)
+						std::cout << "slot " << saved.slot << ": mode " << saved.mode << ", " << saved.turn << " to move, "
+							<< saved.red << " red and " << saved.black << " black pieces\n";
+				}
+				else if (frame.type == PROTOCOL_MSG_PING && frame.length == PROTOCOL_PING_SIZE)
+				{
+					following = false;
+					std::cout << "ping: " << link.stats().pingTime() << " us, board clock "
+						<< link.stats().clockOffset() << " us ahead\n";
+				}
+				else if (wire::readSync(frame, &pos, &turn))
+				{
+					following = false;
+					std::cout << "board: red " << std::hex << pos.red << ", black " << pos.black
+						<< ", kings " << pos.kings << std::dec << ", " << turn << " to move\n";
+				}
+				else if ((count = wire::readMove(frame, &hash, played)) > 0)
+				{
+					following = false;
+					std::cout << "board plays " << board::squareName(played[0].from);
+					for (int i = 0; i < count; ++i)
+						std::cout << (board::isJump(played[i]) ? 'x' : '-') << board::squareName(played[i].to);
+					std::cout << '\n';
+					//a move on another position means we missed something: ask for the board
+					if (hash == wire::boardHash(pos, turn)) play(played, count);
+					else link.send(PROTOCOL_MSG_BOARD_SYNC, nullptr, 0);
+				}
+				else
+					std::cout << "frame type " << int(frame.type) << ", " << int(frame.length) << " bytes\n";
+			}
+			if (!acked) std::cout << "No ack.\n";
+		}
+		link.stats().dump(std::cout);
+		return 0;
+	}
+
+	if (tool == "replay" && argc >= 4 && argc <= 6)
+	{
+		//send the games of a script to the board with up to a window of frames in flight
+		std::ifstream file(argv[3]);
+		auto port = std::make_unique<transport::SerialPort>();
+		const int baud = argc >= 5 ? std::atoi(argv[4]) : 115200;
+		if (!file.is_open() || !port->open(argv[2], baud))
+		{
+			std::cerr << "Unable to open " << (file.is_open() ? argv[2] : argv[3]) << '\n';
+			return 1;
+		}
+		transport::Link link;
+		link.setWindow(argc == 6 ? std::atoi(argv[5]) : int(PROTOCOL_WINDOW));
+		link.start(std::move(port));
+
+		long frames = 0, bytes = 0, refused = 0, lineNumber = 0, errors = 0;
+		transport::Event event;
+		const auto drain = [&] {
+			while (link.poll(&event))
+				if (event.frame.type == PROTOCOL_MSG_ACK && event.frame.length >= 2 && event.frame.payload[1] != PROTOCOL_OK) ++refused;
+		};
+		const auto send = [&](std::uint8_t type, const std::uint8_t* payload, std::uint8_t length) {
+			//the queue holds far more than a window, so a short sleep costs no line time
+			while (link.send(type, payload, length) < 0 && link.isOpen())
+			{
+				drain();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			++frames;
+			bytes += PROTOCOL_OVERHEAD + length;
+		};
+
+		const auto begin = std::chrono::steady_clock::now();
+		send(PROTOCOL_MSG_HELLO, nullptr, 0);
+		std::string line, message;
+		while (std::getline(file, line) && link.isOpen())
+		{
+			++lineNumber;
+			if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') continue;
+			script::Game game;
+			send(PROTOCOL_MSG_NEW_GAME, nullptr, 0);
+			std::istringstream words(line);
+			std::string word;
+			while (words >> word)
+			{
+				std::uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+				const std::uint16_t hash = wire::boardHash(game.position, game.turn);
+				std::uint8_t length = PROTOCOL_HASH_SIZE;
+				payload[0] = static_cast<std::uint8_t>(hash >> 8);
+				payload[1] = static_cast<std::uint8_t>(hash);
+				//the rest of a game is not sent after a move the board would not get whole
+				if (!script::play(word, &game, &message))
+				{
+					++errors;
+					std::cout << "line " << lineNumber << ": error, " << message << '\n';
+					break;
+				}
+				//squares joined by '-' or 'x', so a move of n hops is 3n + 2 characters
+				const std::size_t hops = (word.size() - 2) / 3;
+				if (PROTOCOL_HASH_SIZE + 2 * hops > PROTOCOL_MAX_PAYLOAD)
+				{
+					++errors;
+					std::cout << "line " << lineNumber << ": error, " << word << " has too many hops for one frame\n";
+					break;
+				}
+				for (std::size_t i = 0; i < hops; ++i)
+				{
+					payload[length++] = static_cast<std::uint8_t>(board::squareIndex(word.substr(3 * i, 2)));
+					payload[length++] = static_cast<std::uint8_t>(board::squareIndex(word.substr(3 * i + 3, 2)));
+				}
+				send(PROTOCOL_MSG_MOVE, payload, length);
+			}
+		}
+		const auto last = std::chrono::steady_clock::now();
+		while (!link.idle() && link.isOpen() && std::chrono::steady_clock::now() - last < std::chrono::seconds(10))
+		{
+			drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		drain();
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		std::cout << frames << " frames, " << bytes << " bytes in " << seconds << " s: " << frames / seconds
+			<< " frames/s, " << 100.0 * bytes / seconds / (baud / 10.0) << "% of the line\n"
+			<< "Errors: " << errors << ", refused: " << refused << ", retransmits: " << link.retransmits()
+			<< ", bad frames: " << link.badFrames() << (link.idle() ? "" : ", some frames never acked") << '\n';
+		link.stats().dump(std::cout);
+		return errors || refused || !link.idle() ? 1 : 0;
+	}
+
+	std::cerr << "Usage:\n"
+		<< "\t" << argv[0] << "                         play the game\n"
+		<< "\t" << argv[0] << " pdn-stats <archive.pdn>  check a PDN archive and measure parse speed\n"
+		<< "\t" << argv[0] << " db-build <out.ckdb> <files...>  index PDN archives and saved games\n"
+		<< "\t" << argv[0] << " db-query <db.ckdb> <save>  look up the position of a saved game\n"
+		<< "\t" << argv[0] << " pack <archive.pdn> <out.ckm> [fixed|ranked]  store games as legal move indices\n"
+		<< "\t" << argv[0] << " unpack <archive.ckm> <out.pdn>  replay a packed archive back to PDN\n"
+		<< "\t" << argv[0] << " positions <archive.pdn> <out.ckps> [fixed|variable]  extract every position of an archive\n"
+		<< "\t" << argv[0] << " convert <directory> <out.ckps> [threads]  collect the positions of all .ini saves\n"
+		<< "\t" << argv[0] << " script <file|->  replay games written as moves (c3-d4 f6-e5 ...), one per line\n"
+		<< "\t" << argv[0] << " play <port> [baud]  play the game with the board kept in step\n"
+		<< "\t" << argv[0] << " board <port> [baud]  send moves and commands to the board and show its answers\n"
+		<< "\t" << argv[0] << " replay <port> <file> [baud] [window]  send the games of a script to the board, pipelined\n";
+	return 2;
+}
+
+void runTool_Test()
+{
+	// Test case 1: convert keeps one copy of a position saved twice, and counts the malformed saves
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "checkers-convert-test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir / "older");
+	save::GameState start, moved;
+	start.position = board::startPosition();
+	moved.position = start.position;
+	board::applyHop(&moved.position, { 9, 13 });
+	moved.turn = Black;
+	const auto writeSave = [](const std::filesystem::path& path, const save::GameState& state) {
+		std::ofstream file(path);
+		save::writeIni(file, state);
+	};
+	writeSave(dir / "start.ini", start);
+	writeSave(dir / "older" / "start.ini", start);
+	writeSave(dir / "moved.ini", moved);
+	std::ofstream(dir / "broken.ini") << "[Square1]\nColor=x\n";
+	std::ofstream(dir / "notes.txt") << "not a save\n";
+
+	const std::string out = (dir / "out.ckps").string();
+	std::string dirName = dir.string();
+	char* argv[] = { const_cast<char*>("tests"), const_cast<char*>("convert"), &dirName[0], const_cast<char*>(out.c_str()), const_cast<char*>("2") };
+	std::ostringstream shown, errors;
+	std::streambuf* const coutBuf = std::cout.rdbuf(shown.rdbuf());
+	std::streambuf* const cerrBuf = std::cerr.rdbuf(errors.rdbuf());
+	const int code = runTool(5, argv);
+	std::cout.rdbuf(coutBuf);
+	std::cerr.rdbuf(cerrBuf);
+	assert(code == 1);
+	assert(shown.str().find("Files: 4, malformed: 1, distinct positions: 2,") == 0);
+	assert(errors.str().find("broken.ini: ") != std::string::npos && errors.str().find("start.ini") == std::string::npos);
+
+	// Test case 2: the output holds the distinct positions in the fixed encoding, sorted by hash
+	std::ifstream file(out, std::ios::binary);
+	const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	assert(bytes.size() == 9 + 2 * poscodec::fixedSize && bytes.compare(0, 5, std::string("CKPS\0", 5)) == 0);
+	assert(bytes[5] == 2 && bytes[6] == 0 && bytes[7] == 0 && bytes[8] == 0);
+	poscodec::Record records[2];
+	poscodec::decodeFixed(reinterpret_cast<const std::uint8_t*>(bytes.data()) + 9, 2, records);
+	assert(board::hash(records[0].position, records[0].turn) < board::hash(records[1].position, records[1].turn));
+	const bool startFirst = records[0].turn == Red;
+	const poscodec::Record& first = records[startFirst ? 0 : 1];
+	const poscodec::Record& second = records[startFirst ? 1 : 0];
+	assert(first.turn == Red && first.position.red == start.position.red && first.position.black == start.position.black);
+	assert(second.turn == Black && second.position.red == moved.position.red && second.position.black == moved.position.black);
+	file.close();
+	std::filesystem::remove_all(dir);
+
+	std::cout << "runTool(): All test cases passed!\n";
 }
 
 void error(std::string message)
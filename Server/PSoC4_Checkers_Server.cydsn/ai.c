@@ -0,0 +1,223 @@
+#include "ai.h"
+#include "constants.h"
+
+#define SCORE_WIN 30000
+#define SCORE_MAN 100
+#define SCORE_KING 160
+#define SCORE_ROW 3          /* per row a man has advanced */
+#define SCORE_BACK_ROW 10    /* per man still guarding its crowning row */
+
+Ai_Stats Ai_stats;
+
+static Rules_Board undo[AI_MAX_PLY];
+static Rules_Hop arena[AI_ARENA_SIZE];
+static uint16 arenaTop;
+static uint32 nodeBudget;
+static uint8 aborted;
+
+static uint8 countBits(uint32 mask)
+{
+    //no population count instruction on the Cortex-M0
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0Fu;
+    return (uint8)((mask * 0x01010101u) >> 24);
+}
+
+static int16 evaluate(const Rules_Board *board)
+{
+    //the opponent's crowning rows, from the promotion squares of constants.h
+    const uint32 redHome = (1u << a1) | (1u << c1) | (1u << e1) | (1u << g1);
+    const uint32 blackHome = (1u << b8) | (1u << d8) | (1u << f8) | (1u << h8);
+    uint32 redMen = board->red & ~board->kings;
+    uint32 blackMen = board->black & ~board->kings;
+    int16 score = 0;
+    uint8 row;
+
+    score += SCORE_MAN * (countBits(redMen) - countBits(blackMen));
+    score += SCORE_KING * (countBits(board->red & board->kings) - countBits(board->black & board->kings));
+    score += SCORE_BACK_ROW * (countBits(redMen & redHome) - countBits(blackMen & blackHome));
+    for(row = 1; row < 7u; ++row)
+    {
+        uint32 rowMask = 0xFu << (4u * row);
+        score += SCORE_ROW * (row * countBits(redMen & rowMask) - (7 - row) * countBits(blackMen & rowMask));
+    }
+    return board->turn == Red ? score : (int16)-score;
+}
+
+static void passTurn(Rules_Board *board)
+{
+    board->turn = board->turn == Red ? Black : Red;
+}
+
+/* Score of the position for the side to move. piece >= 0: that piece has
+   just jumped and may jump again or stop. */
+static int16 search(Rules_Board *board, int8 piece, uint8 depth, int16 alpha, int16 beta, uint8 ply)
+{
+    uint16 start = arenaTop;
+    int16 best = -SCORE_WIN;
+    uint8 count;
+    uint8 i;
+
+    //an abandoned search unwinds without counting or evaluating anything
+    if(aborted || ++Ai_stats.nodes > nodeBudget)
+    {
+        aborted = 1;
+        return 0;
+    }
+    //a ply with less room than a full hop list is not searched, not cut short
+    if((piece < 0 && depth == 0u) || ply >= AI_MAX_PLY || start + RULES_MAX_HOPS > AI_ARENA_SIZE)
+    {
+        return evaluate(board);
+    }
+
+    count = Rules_LegalHops(board, piece, arena + start, (uint8)(AI_ARENA_SIZE - start));
+    arenaTop = (uint16)(start + count);
+    if(arenaTop > Ai_stats.arenaPeak)
+    {
+        Ai_stats.arenaPeak = arenaTop;
+    }
+
+    if(piece >= 0)
+    {
+        //stopping the chain passes the turn; at depth 0 only the chain goes on
+        undo[ply] = *board;
+        passTurn(board);
+        best = (int16)-search(board, -1, depth > 0u ? depth - 1u : 0u, (int16)-beta, (int16)-alpha, ply + 1u);
+        *board = undo[ply];
+        if(best > alpha)
+        {
+            alpha = best;
+        }
+    }
+    else if(count == 0u)
+    {
+        arenaTop = start;
+        return (int16)(-SCORE_WIN + ply); //no move: lost, the later the better
+    }
+
+    for(i = 0; i < count && alpha < beta; ++i)
+    {
+        Rules_Hop hop = arena[start + i];
+        int16 score;
+
+        undo[ply] = *board;
+        Rules_ApplyHop(board, hop.from, hop.to);
+        if(Rules_IsJump(hop.from, hop.to))
+        {
+            //the same side decides whether to go on jumping
+            score = search(board, (int8)hop.to, depth, alpha, beta, ply + 1u);
+        }
+        else
+        {
+            passTurn(board);
+            score = (int16)-search(board, -1, depth - 1u, (int16)-beta, (int16)-alpha, ply + 1u);
+        }
+        *board = undo[ply];
+
+        if(score > best)
+        {
+            best = score;
+        }
+        if(score > alpha)
+        {
+            alpha = score;
+        }
+    }
+    arenaTop = start;
+    return best;
+}
+
+/* Picks the best hop of the side to move (of 'piece' if it is jumping on).
+   Returns 0 if stopping the chain is better than any hop. */
+static uint8 bestHop(Rules_Board *board, int8 piece, uint8 depth, Rules_Hop *best)
+{
+    int16 bestScore = -SCORE_WIN - 1;
+    uint8 count;
+    uint8 i;
+    uint8 found = 0;
+
+    arenaTop = 0;
+    count = Rules_LegalHops(board, piece, arena, RULES_MAX_HOPS);
+    arenaTop = count;
+
+    if(piece >= 0)
+    {
+        undo[0] = *board;
+        passTurn(board);
+        bestScore = (int16)-search(board, -1, depth - 1u, -SCORE_WIN, SCORE_WIN, 1);
+        *board = undo[0];
+    }
+    for(i = 0; i < count; ++i)
+    {
+        Rules_Hop hop = arena[i];
+        int16 score;
+
+        undo[0] = *board;
+        Rules_ApplyHop(board, hop.from, hop.to);
+        if(Rules_IsJump(hop.from, hop.to))
+        {
+            score = search(board, (int8)hop.to, depth, bestScore, SCORE_WIN, 1);
+        }
+        else
+        {
+            passTurn(board);
+            score = (int16)-search(board, -1, depth - 1u, -SCORE_WIN, (int16)-bestScore, 1);
+        }
+        *board = undo[0];
+
+        if(score > bestScore)
+        {
+            bestScore = score;
+            *best = hop;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+uint8 Ai_FindMove(const Rules_Board *board, uint8 maxDepth, uint8 *hops)
+{
+    uint8 result = 0;
+    uint8 depth;
+
+    Ai_stats.nodes = 0;
+    Ai_stats.depth = 0;
+    Ai_stats.arenaPeak = 0;
+    aborted = 0;
+
+    for(depth = 1; depth <= maxDepth && !aborted; ++depth)
+    {
+        Rules_Board scratch = *board;
+        uint8 chain[2 * AI_MAX_CHAIN];
+        uint8 count = 0;
+        int8 piece = -1;
+        Rules_Hop hop;
+
+        //the first depth always finishes, so there is always a move
+        nodeBudget = depth == 1u ? 0xFFFFFFFFu : AI_NODE_BUDGET;
+        while(count < AI_MAX_CHAIN && !aborted && bestHop(&scratch, piece, depth, &hop))
+        {
+            chain[2 * count] = hop.from;
+            chain[2 * count + 1] = hop.to;
+            ++count;
+            Rules_ApplyHop(&scratch, hop.from, hop.to);
+            if(!Rules_IsJump(hop.from, hop.to))
+            {
+                break;
+            }
+            piece = (int8)hop.to;
+        }
+        if(aborted)
+        {
+            break;
+        }
+        for(result = 0; result < 2u * count; ++result)
+        {
+            hops[result] = chain[result];
+        }
+        result = count;
+        Ai_stats.depth = depth;
+    }
+    return result;
+}
@@ -0,0 +1,40 @@
+#ifndef AI_H
+#define AI_H
+
+/*
+ * Fixed-depth alpha-beta search, so the board can choose moves itself.
+ *
+ * Everything it needs is allocated statically: one undo record per ply and
+ * one arena that the plies share for their hop lists. A search that would
+ * run out of either evaluates the position instead of going deeper. Depths
+ * are searched one after the other, and the last one is abandoned when the
+ * node budget runs out, so a move never costs more than about
+ * AI_CYCLE_BUDGET cycles.
+ */
+
+#include "rules.h"
+
+#define AI_DEFAULT_DEPTH 6u
+#define AI_MAX_PLY 24u              /* plies of moves and capture chains */
+#define AI_ARENA_SIZE 192u          /* hops of all plies on the search path */
+#define AI_MAX_CHAIN 16u            /* hops in the move returned */
+
+#define AI_CYCLE_BUDGET 24000000u   /* 0.5 s at 48 MHz */
+#define AI_CYCLES_PER_NODE 800u     /* rough Cortex-M0 cost of one node */
+#define AI_NODE_BUDGET (AI_CYCLE_BUDGET / AI_CYCLES_PER_NODE)
+
+typedef struct
+{
+    uint32 nodes;        /* nodes visited for the last move */
+    uint8 depth;         /* deepest search that was completed */
+    uint16 arenaPeak;    /* most hops held in the arena at once */
+} Ai_Stats;
+
+extern Ai_Stats Ai_stats;
+
+/* Chooses a move for the side to move, searching up to maxDepth moves ahead.
+   Writes (from, to) pairs to hops (2 * AI_MAX_CHAIN bytes) and returns the
+   number of hops, or 0 if the side to move cannot move. */
+uint8 Ai_FindMove(const Rules_Board *board, uint8 maxDepth, uint8 *hops);
+
+#endif
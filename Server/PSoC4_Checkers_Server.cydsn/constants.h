@@ -1,55 +1,55 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
     
-const char Red = 'r';
-const char cRed = 'R'; //crowned red
-const char Black = 'b';
-const char cBlack = 'B'; //crowned black
-const char Both = 'x'; //in case of a tie, char loser = Both
-const char Left = 'L';
-const char Right = 'R';
-const char Odd = 'O';
-const char Even = 'E';
-const int lowVectorRange = 0; //lowest subscript within range of vector
+static const char Red = 'r';
+static const char cRed = 'R'; //crowned red
+static const char Black = 'b';
+static const char cBlack = 'B'; //crowned black
+static const char Both = 'x'; //in case of a tie, char loser = Both
+static const char Left = 'L';
+static const char Right = 'R';
+static const char Odd = 'O';
+static const char Even = 'E';
+static const int lowVectorRange = 0; //lowest subscript within range of vector
 
 //addresses of squares at ends of board (for detecting promotion):
-const int b8 = 28;
-const int d8 = 29;
-const int f8 = 30;
-const int h8 = 31;
-const int a1 = 0;
-const int c1 = 1;
-const int e1 = 2;
-const int g1 = 3;
+static const int b8 = 28;
+static const int d8 = 29;
+static const int f8 = 30;
+static const int h8 = 31;
+static const int a1 = 0;
+static const int c1 = 1;
+static const int e1 = 2;
+static const int g1 = 3;
 
 //for capturing (see description at top of mainGame.cpp for explanation):
-const int rOddRightCapJmp = 9; //distance from start to landing square if
+static const int rOddRightCapJmp = 9; //distance from start to landing square if
 //piece starts on odd row heading right
 //red's first capture condition true
-const int rOddRightHafJmp = 4; //distance from start to in-between square if
+static const int rOddRightHafJmp = 4; //distance from start to in-between square if
 //piece starts on odd row heading right
 //red's first capture condition true
 //following constants follow same pattern
-const int rEvenRightCapJmp = 9; //red's second capture condition
-const int rEvenRightHafJmp = 5;
+static const int rEvenRightCapJmp = 9; //red's second capture condition
+static const int rEvenRightHafJmp = 5;
 
-const int rOddLeftCapJmp = 7; //red's third capture condition
-const int rOddLeftHafJmp = 3;
+static const int rOddLeftCapJmp = 7; //red's third capture condition
+static const int rOddLeftHafJmp = 3;
 
-const int rEvenLeftCapJmp = 7; //red's fourth capture condition
-const int rEvenLeftHafJmp = 4;
+static const int rEvenLeftCapJmp = 7; //red's fourth capture condition
+static const int rEvenLeftHafJmp = 4;
 
-const int bOddLeftCapJmp = -9; //black's first capture condition
-const int bOddLeftHafJmp = -5;
+static const int bOddLeftCapJmp = -9; //black's first capture condition
+static const int bOddLeftHafJmp = -5;
 
-const int bEvenLeftCapJmp = -9; //black's second capture condition
-const int bEvenLeftHafJmp = -4;
+static const int bEvenLeftCapJmp = -9; //black's second capture condition
+static const int bEvenLeftHafJmp = -4;
 
-const int bOddRightCapJmp = -7; //black's third capture condition
-const int bOddRightHafJmp = -4;
+static const int bOddRightCapJmp = -7; //black's third capture condition
+static const int bOddRightHafJmp = -4;
 
-const int bEvenRightCapJmp = -7; //black's fourth capture condition
-const int bEvenRightHafJmp = -3;
+static const int bEvenRightCapJmp = -7; //black's fourth capture condition
+static const int bEvenRightHafJmp = -3;
     
 void returnInteger();
 void returnChar();
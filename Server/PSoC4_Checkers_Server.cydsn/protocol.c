@@ -0,0 +1,200 @@
+#include "protocol.h"
+
+enum
+{
+    STATE_SOF,
+    STATE_LENGTH,
+    STATE_TYPE,
+    STATE_SEQ,
+    STATE_PAYLOAD,
+    STATE_CRC_HIGH,
+    STATE_CRC_LOW
+};
+
+/* CRC of each nibble, so the table fits in 32 bytes of flash */
+static const uint16_t crcTable[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t crcByte(uint16_t crc, uint8_t byte)
+{
+    crc = (uint16_t)((crc << 4) ^ crcTable[(crc >> 12) ^ (byte >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ crcTable[(crc >> 12) ^ (byte & 0x0Fu)]);
+    return crc;
+}
+
+uint16_t Protocol_Crc16(uint16_t crc, const uint8_t *data, size_t size)
+{
+    size_t i;
+    for(i = 0; i < size; ++i)
+    {
+        crc = crcByte(crc, data[i]);
+    }
+    return crc;
+}
+
+static void putMask(uint8_t *out, uint32_t mask)
+{
+    out[0] = (uint8_t)mask;
+    out[1] = (uint8_t)(mask >> 8);
+    out[2] = (uint8_t)(mask >> 16);
+    out[3] = (uint8_t)(mask >> 24);
+}
+
+static uint32_t getMask(const uint8_t *in)
+{
+    return in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+void Protocol_PackBoard(const Protocol_Board *board, uint8_t *out)
+{
+    uint32_t pieces = board->red | board->black;
+    uint32_t kingBits = 0;
+    uint8_t piece = 0;
+    uint8_t sq;
+
+    //one king bit per piece, so the kings take 3 bytes instead of 4
+    for(sq = 0; sq < 32u && piece < 24u; ++sq)
+    {
+        if((pieces >> sq) & 1u)
+        {
+            kingBits |= ((board->kings >> sq) & 1u) << piece;
+            ++piece;
+        }
+    }
+    putMask(out, board->red);
+    putMask(out + 4, board->black);
+    out[8] = (uint8_t)kingBits;
+    out[9] = (uint8_t)(kingBits >> 8);
+    out[10] = (uint8_t)(kingBits >> 16);
+    out[11] = board->turn;
+}
+
+int Protocol_UnpackBoard(const uint8_t *in, Protocol_Board *board)
+{
+    uint32_t kingBits = in[8] | ((uint32_t)in[9] << 8) | ((uint32_t)in[10] << 16);
+    uint32_t pieces;
+    uint8_t piece = 0;
+    uint8_t redCount = 0;
+    uint8_t blackCount = 0;
+    uint8_t sq;
+
+    board->red = getMask(in);
+    board->black = getMask(in + 4);
+    board->kings = 0;
+    board->turn = in[11];
+    pieces = board->red | board->black;
+    if((board->red & board->black) != 0u || (board->turn != 'r' && board->turn != 'b'))
+    {
+        return 0;
+    }
+    for(sq = 0; sq < 32u; ++sq)
+    {
+        if((pieces >> sq) & 1u)
+        {
+            if((board->red >> sq) & 1u ? ++redCount > PROTOCOL_MAX_PIECES : ++blackCount > PROTOCOL_MAX_PIECES)
+            {
+                return 0;
+            }
+            board->kings |= ((kingBits >> piece) & 1u) << sq;
+            ++piece;
+        }
+    }
+    //king bits past the last piece mean the snapshot is damaged
+    return piece == 24u || (kingBits >> piece) == 0u;
+}
+
+uint16_t Protocol_BoardHash(const Protocol_Board *board)
+{
+    uint8_t snapshot[PROTOCOL_SYNC_SIZE];
+    Protocol_PackBoard(board, snapshot);
+    return Protocol_Crc16(0xFFFFu, snapshot, PROTOCOL_SYNC_SIZE);
+}
+
+void Protocol_Reset(Protocol_Parser *parser)
+{
+    parser->state = STATE_SOF;
+    parser->index = 0;
+    parser->crc = 0xFFFFu;
+}
+
+int Protocol_Feed(Protocol_Parser *parser, uint8_t byte)
+{
+    Protocol_Frame *frame = &parser->frame;
+    int result;
+
+    if(parser->state != STATE_SOF && parser->state < STATE_CRC_HIGH)
+    {
+        parser->crc = crcByte(parser->crc, byte);
+    }
+
+    switch(parser->state)
+    {
+    case STATE_SOF:
+        if(byte == PROTOCOL_SOF)
+        {
+            parser->crc = 0xFFFFu;
+            parser->state = STATE_LENGTH;
+        }
+        return PROTOCOL_NONE;
+    case STATE_LENGTH:
+        if(byte > PROTOCOL_MAX_PAYLOAD)
+        {
+            Protocol_Reset(parser);
+            return PROTOCOL_BAD_LENGTH;
+        }
+        frame->length = byte;
+        parser->state = STATE_TYPE;
+        return PROTOCOL_NONE;
+    case STATE_TYPE:
+        frame->type = byte;
+        parser->state = STATE_SEQ;
+        return PROTOCOL_NONE;
+    case STATE_SEQ:
+        frame->seq = byte;
+        parser->index = 0;
+        parser->state = frame->length > 0 ? STATE_PAYLOAD : STATE_CRC_HIGH;
+        return PROTOCOL_NONE;
+    case STATE_PAYLOAD:
+        frame->payload[parser->index++] = byte;
+        if(parser->index == frame->length)
+        {
+            parser->state = STATE_CRC_HIGH;
+        }
+        return PROTOCOL_NONE;
+    case STATE_CRC_HIGH:
+        parser->crc ^= (uint16_t)(byte << 8);
+        parser->state = STATE_CRC_LOW;
+        return PROTOCOL_NONE;
+    default:
+        result = (parser->crc ^ byte) == 0 ? PROTOCOL_FRAME : PROTOCOL_ERROR;
+        Protocol_Reset(parser);
+        return result;
+    }
+}
+
+size_t Protocol_Encode(uint8_t type, uint8_t seq, const uint8_t *payload, uint8_t length, uint8_t *out)
+{
+    uint16_t crc;
+    uint8_t i;
+
+    if(length > PROTOCOL_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    out[0] = PROTOCOL_SOF;
+    out[1] = length;
+    out[2] = type;
+    out[3] = seq;
+    for(i = 0; i < length; ++i)
+    {
+        out[4 + i] = payload[i];
+    }
+    crc = Protocol_Crc16(0xFFFFu, out + 1, 3u + length);
+    out[4 + length] = (uint8_t)(crc >> 8);
+    out[5 + length] = (uint8_t)crc;
+    return PROTOCOL_OVERHEAD + length;
+}
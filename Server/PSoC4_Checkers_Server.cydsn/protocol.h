@@ -0,0 +1,148 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/*
+ * Framed link between the client and the board.
+ *
+ * Frame:  SOF | LEN | TYPE | SEQ | PAYLOAD (LEN bytes) | CRC high | CRC low
+ *
+ * The CRC is CRC-16/CCITT-FALSE over LEN, TYPE, SEQ and the payload. A frame
+ * is handled as soon as its last byte arrives, whatever its size. A frame
+ * with a bad CRC or length is dropped and the parser hunts for the next SOF.
+ *
+ * Both ends keep the position and a hash of it (the CRC of its snapshot). A
+ * MOVE carries only the hash of the position it was played on and its hops;
+ * the whole snapshot (12 bytes: red and black masks, one king bit per piece
+ * in square order, the side to move) is sent at startup, after LOAD (in the
+ * GAME frame), when asked for and when a MOVE was played on another position
+ * than the board's.
+ *
+ * The client may have up to PROTOCOL_WINDOW frames in flight. The board
+ * handles them in SEQ order, holding back frames that arrive early, and acks
+ * each one; an ACK of SEQ also acknowledges every frame before it. An ACK
+ * with BAD_CRC acknowledges nothing and asks for that frame again; the board
+ * sends one for the missing frame when it starts holding frames back. A frame
+ * that was handled already is answered with the ack of the last one handled.
+ * HELLO starts a session at any SEQ. The board's frames are not acked; the
+ * hash puts a lost one right.
+ *
+ * Multi-byte numbers are little endian, except the CRC and the hash. Every
+ * ACK tells how long the board spent on the frame, and PING carries both
+ * clocks, so the link can be timed from either end.
+ *
+ * Saved games live in the board's flash. SAVE writes a flash row before it
+ * is acked, which stalls the board for about 20 ms, so it should be the
+ * last frame in flight.
+ *
+ * This file is shared by the firmware and the client, so it is plain C.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROTOCOL_SOF 0xA5u
+#define PROTOCOL_MAX_PAYLOAD 48u
+#define PROTOCOL_OVERHEAD 6u  /* SOF, LEN, TYPE, SEQ and the CRC */
+#define PROTOCOL_MAX_FRAME (PROTOCOL_MAX_PAYLOAD + PROTOCOL_OVERHEAD)
+#define PROTOCOL_WINDOW 4u  /* client frames in flight; a power of two */
+
+/* message types */
+#define PROTOCOL_MSG_ACK 0x01u        /* payload: acked SEQ, status, board time on it (16 bits, 10 us units) */
+#define PROTOCOL_MSG_MOVE 0x10u       /* payload: hash before the move (high byte first), then (from, to) per hop */
+#define PROTOCOL_MSG_BOARD_SYNC 0x11u /* payload: snapshot, or none to ask for the board's */
+#define PROTOCOL_MSG_NEW_GAME 0x12u   /* no payload */
+#define PROTOCOL_MSG_SAVE 0x13u       /* payload: slot, game mode (optional); the board keeps its position,
+                                         the mode and its last hops */
+#define PROTOCOL_MSG_LOAD 0x14u       /* payload: slot; answered by ACK and GAME */
+#define PROTOCOL_MSG_AI_MOVE 0x15u    /* payload: depth (optional); the board moves, answered by ACK and MOVE */
+#define PROTOCOL_MSG_HELLO 0x16u      /* no payload; the board expects SEQ + 1 next */
+#define PROTOCOL_MSG_PING 0x17u       /* payload: client time (32 bits); answered by ACK and PING with
+                                         the client time and the board's (32 bits, microseconds) */
+#define PROTOCOL_MSG_LIST 0x18u       /* no payload; answered by ACK and LIST with an entry per saved game:
+                                         slot, game mode, side to move, red pieces, black pieces */
+#define PROTOCOL_MSG_GAME 0x19u       /* from the board: slot, snapshot, game mode, then (from, to) of
+                                         the last hops played, oldest first */
+
+#define PROTOCOL_SYNC_SIZE 12u
+#define PROTOCOL_HASH_SIZE 2u
+#define PROTOCOL_ACK_SIZE 4u
+#define PROTOCOL_PING_SIZE 8u
+#define PROTOCOL_ACK_TIME_UNIT 10u  /* microseconds */
+#define PROTOCOL_LIST_ENTRY_SIZE 5u
+#define PROTOCOL_MAX_PIECES 12u  /* of a side in a snapshot, as at the start */
+#define PROTOCOL_SLOTS 4u
+#define PROTOCOL_GAME_HOPS 16u  /* hops kept with a saved game */
+
+/* ACK status */
+#define PROTOCOL_OK 0u
+#define PROTOCOL_BAD_CRC 1u     /* not an ack: send SEQ again (it may itself be damaged) */
+#define PROTOCOL_BAD_TYPE 2u
+#define PROTOCOL_BAD_PAYLOAD 3u
+#define PROTOCOL_EMPTY_SLOT 4u
+#define PROTOCOL_ILLEGAL_MOVE 5u  /* followed by a BOARD_SYNC of the board's position */
+#define PROTOCOL_NO_MOVE 6u       /* the side to move has lost */
+#define PROTOCOL_OUT_OF_SYNC 7u   /* the MOVE's hash is not the board's; followed by a BOARD_SYNC */
+#define PROTOCOL_FLASH_FAILED 8u  /* the game could not be written; the slot keeps its last one */
+
+/* results of Protocol_Feed */
+#define PROTOCOL_NONE 0
+#define PROTOCOL_FRAME 1
+#define PROTOCOL_ERROR 2       /* parser->frame.seq is that of the dropped frame */
+#define PROTOCOL_BAD_LENGTH 3  /* dropped at LEN, before SEQ was read */
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t seq;
+    uint8_t length;
+    uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+} Protocol_Frame;
+
+typedef struct
+{
+    uint8_t state;
+    uint8_t index;
+    uint16_t crc;
+    Protocol_Frame frame;  /* the frame being received, complete after PROTOCOL_FRAME */
+} Protocol_Parser;
+
+typedef struct
+{
+    uint32_t red;
+    uint32_t black;
+    uint32_t kings;
+    uint8_t turn;   /* 'r' or 'b' */
+} Protocol_Board;
+
+uint16_t Protocol_Crc16(uint16_t crc, const uint8_t *data, size_t size);
+
+/* Writes the snapshot of a board of at most 24 pieces (PROTOCOL_SYNC_SIZE bytes). */
+void Protocol_PackBoard(const Protocol_Board *board, uint8_t *out);
+
+/* Reads a snapshot. Returns 0 if it is not a well-formed one, or a side
+   has more than PROTOCOL_MAX_PIECES. */
+int Protocol_UnpackBoard(const uint8_t *in, Protocol_Board *board);
+
+/* Hash of a board: the CRC of its snapshot. */
+uint16_t Protocol_BoardHash(const Protocol_Board *board);
+
+void Protocol_Reset(Protocol_Parser *parser);
+
+/* Takes one received byte. Returns PROTOCOL_FRAME when parser->frame is
+   complete, PROTOCOL_ERROR or PROTOCOL_BAD_LENGTH when a frame was dropped,
+   PROTOCOL_NONE otherwise. */
+int Protocol_Feed(Protocol_Parser *parser, uint8_t byte);
+
+/* Writes a frame to out (PROTOCOL_MAX_FRAME bytes) and returns its size,
+   or 0 if the payload is too long. */
+size_t Protocol_Encode(uint8_t type, uint8_t seq, const uint8_t *payload, uint8_t length, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
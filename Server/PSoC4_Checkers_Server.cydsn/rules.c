@@ -0,0 +1,225 @@
+#include "rules.h"
+#include "constants.h"
+
+/* neighbours of each square along the diagonals up-left, up-right,
+   down-left and down-right, or -1 off the board; red moves up */
+static const int8 stepTable[32][4] =
+{
+    { -1,  4, -1, -1 }, {  4,  5, -1, -1 }, {  5,  6, -1, -1 }, {  6,  7, -1, -1 },
+    {  8,  9,  0,  1 }, {  9, 10,  1,  2 }, { 10, 11,  2,  3 }, { 11, -1,  3, -1 },
+    { -1, 12, -1,  4 }, { 12, 13,  4,  5 }, { 13, 14,  5,  6 }, { 14, 15,  6,  7 },
+    { 16, 17,  8,  9 }, { 17, 18,  9, 10 }, { 18, 19, 10, 11 }, { 19, -1, 11, -1 },
+    { -1, 20, -1, 12 }, { 20, 21, 12, 13 }, { 21, 22, 13, 14 }, { 22, 23, 14, 15 },
+    { 24, 25, 16, 17 }, { 25, 26, 17, 18 }, { 26, 27, 18, 19 }, { 27, -1, 19, -1 },
+    { -1, 28, -1, 20 }, { 28, 29, 20, 21 }, { 29, 30, 21, 22 }, { 30, 31, 22, 23 },
+    { -1, -1, 24, 25 }, { -1, -1, 25, 26 }, { -1, -1, 26, 27 }, { -1, -1, 27, -1 }
+};
+
+/* landing squares of jumps along the same diagonals */
+static const int8 jumpTable[32][4] =
+{
+    { -1,  9, -1, -1 }, {  8, 10, -1, -1 }, {  9, 11, -1, -1 }, { 10, -1, -1, -1 },
+    { -1, 13, -1, -1 }, { 12, 14, -1, -1 }, { 13, 15, -1, -1 }, { 14, -1, -1, -1 },
+    { -1, 17, -1,  1 }, { 16, 18,  0,  2 }, { 17, 19,  1,  3 }, { 18, -1,  2, -1 },
+    { -1, 21, -1,  5 }, { 20, 22,  4,  6 }, { 21, 23,  5,  7 }, { 22, -1,  6, -1 },
+    { -1, 25, -1,  9 }, { 24, 26,  8, 10 }, { 25, 27,  9, 11 }, { 26, -1, 10, -1 },
+    { -1, 29, -1, 13 }, { 28, 30, 12, 14 }, { 29, 31, 13, 15 }, { 30, -1, 14, -1 },
+    { -1, -1, -1, 17 }, { -1, -1, 16, 18 }, { -1, -1, 17, 19 }, { -1, -1, 18, -1 },
+    { -1, -1, -1, 21 }, { -1, -1, 20, 22 }, { -1, -1, 21, 23 }, { -1, -1, 22, -1 }
+};
+
+static uint8 lowestBit(uint32 mask)
+{
+    //the Cortex-M0 has no count-trailing-zeros instruction
+    uint8 index = 0;
+    if((mask & 0xFFFFu) == 0u)
+    {
+        mask >>= 16;
+        index += 16;
+    }
+    if((mask & 0xFFu) == 0u)
+    {
+        mask >>= 8;
+        index += 8;
+    }
+    if((mask & 0xFu) == 0u)
+    {
+        mask >>= 4;
+        index += 4;
+    }
+    if((mask & 0x3u) == 0u)
+    {
+        mask >>= 2;
+        index += 2;
+    }
+    if((mask & 0x1u) == 0u)
+    {
+        index += 1;
+    }
+    return index;
+}
+
+static uint8 countBits(uint32 mask)
+{
+    uint8 count = 0;
+    for(; mask != 0u; mask &= mask - 1u)
+    {
+        ++count;
+    }
+    return count;
+}
+
+void Rules_NewGame(Rules_Board *board)
+{
+    board->red = 0x00000FFFu;   //a1 to g3
+    board->black = 0xFFF00000u; //b6 to h8
+    board->kings = 0;
+    board->turn = Red;
+}
+
+uint8 Rules_IsValid(const Rules_Board *board)
+{
+    return (board->red & board->black) == 0u
+        && (board->kings & ~(board->red | board->black)) == 0u
+        && countBits(board->red) <= RULES_MAX_PIECES && countBits(board->black) <= RULES_MAX_PIECES
+        && (board->turn == Red || board->turn == Black);
+}
+
+uint8 Rules_IsJump(uint8 from, uint8 to)
+{
+    return from / 4 - to / 4 == 2 || to / 4 - from / 4 == 2;
+}
+
+uint8 Rules_LegalHops(const Rules_Board *board, int8 piece, Rules_Hop *out, uint8 capacity)
+{
+    uint32 own = board->turn == Red ? board->red : board->black;
+    uint32 other = board->turn == Red ? board->black : board->red;
+    uint32 empty = ~(board->red | board->black);
+    uint8 firstDir = board->turn == Red ? 0u : 2u; //men only move forward
+    uint8 count = 0;
+    uint8 kind;
+
+    //jumps first, then steps
+    for(kind = 0; kind < 2u; ++kind)
+    {
+        uint32 pieces = piece >= 0 ? (1u << piece) : own;
+        if(kind == 1u && piece >= 0)
+        {
+            break; //a piece that has jumped may only jump again
+        }
+        for(; pieces != 0u; pieces &= pieces - 1u)
+        {
+            uint8 sq = lowestBit(pieces);
+            uint8 king = (board->kings >> sq & 1u) != 0u;
+            uint8 d;
+            for(d = king ? 0u : firstDir; d < (king ? 4u : firstDir + 2u); ++d)
+            {
+                int8 over = stepTable[sq][d];
+                int8 to = kind == 0u ? jumpTable[sq][d] : over;
+                if(to < 0 || !(empty >> to & 1u))
+                {
+                    continue;
+                }
+                if(kind == 0u && !(other >> over & 1u))
+                {
+                    continue;
+                }
+                if(count == capacity)
+                {
+                    return count; //the list is cut, never overrun
+                }
+                out[count].from = sq;
+                out[count].to = (uint8)to;
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+void Rules_ApplyHop(Rules_Board *board, uint8 from, uint8 to)
+{
+    uint32 fromBit = 1u << from;
+    uint32 toBit = 1u << to;
+    uint8 red = (board->red & fromBit) != 0u;
+
+    if(red)
+    {
+        board->red ^= fromBit | toBit;
+    }
+    else
+    {
+        board->black ^= fromBit | toBit;
+    }
+    if((board->kings & fromBit) != 0u)
+    {
+        board->kings ^= fromBit | toBit;
+    }
+
+    if(Rules_IsJump(from, to))
+    {
+        //the jumped square is one step along the diagonal of the jump
+        uint8 d = 0;
+        uint32 midBit;
+        while(d < 3u && jumpTable[from][d] != (int8)to)
+        {
+            ++d;
+        }
+        midBit = 1u << stepTable[from][d];
+        board->red &= ~midBit;
+        board->black &= ~midBit;
+        board->kings &= ~midBit;
+    }
+
+    //promotion on the far row
+    if((red && to >= b8) || (!red && to <= g1))
+    {
+        board->kings |= toBit;
+    }
+}
+
+static uint8 isLegalHop(const Rules_Board *board, int8 piece, uint8 from, uint8 to)
+{
+    Rules_Hop list[RULES_MAX_HOPS];
+    uint8 count = Rules_LegalHops(board, piece, list, RULES_MAX_HOPS);
+    uint8 i;
+    for(i = 0; i < count; ++i)
+    {
+        if(list[i].from == from && list[i].to == to)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint8 Rules_PlayMove(Rules_Board *board, const uint8 *hops, uint8 count)
+{
+    Rules_Board next = *board;
+    int8 piece = -1;
+    uint8 i;
+
+    if(count == 0u)
+    {
+        return 0;
+    }
+    for(i = 0; i < count; ++i)
+    {
+        uint8 from = hops[2 * i];
+        uint8 to = hops[2 * i + 1];
+        if(from > 31u || to > 31u || (piece >= 0 && from != (uint8)piece))
+        {
+            return 0;
+        }
+        //only a jump may be followed by another hop, and only by a jump of the same piece
+        if(!isLegalHop(&next, piece, from, to) || (i + 1u < count && !Rules_IsJump(from, to)))
+        {
+            return 0;
+        }
+        Rules_ApplyHop(&next, from, to);
+        piece = (int8)to;
+    }
+    next.turn = next.turn == Red ? Black : Red;
+    *board = next;
+    return 1;
+}
@@ -0,0 +1,56 @@
+#ifndef RULES_H
+#define RULES_H
+
+/*
+ * Rules of the game on the board, the same as in the client: men move and
+ * capture forward, kings both ways, captures are not forced, a capture
+ * chain may stop after any jump, and a piece crowned by a jump may go on
+ * jumping.
+ *
+ * A board is three 32-bit masks (bit i is square i, a1 = 0, h8 = 31) and
+ * the side to move. The diagonal tables are const, so they stay in flash;
+ * a position takes 16 bytes of RAM (13 and padding) and a hop list 2 bytes
+ * per hop.
+ */
+
+#include "project.h"
+
+#define RULES_MAX_PIECES 12u  /* of a side, as at the start */
+#define RULES_MAX_HOPS 48u    /* 4 a piece: enough for any valid position */
+
+typedef struct
+{
+    uint32 red;    /* squares holding a red piece (crowned or not) */
+    uint32 black;  /* squares holding a black piece (crowned or not) */
+    uint32 kings;  /* squares holding a crowned piece of either color */
+    uint8 turn;    /* side to move, Red or Black (constants.h) */
+} Rules_Board;
+
+typedef struct
+{
+    uint8 from;
+    uint8 to;
+} Rules_Hop;
+
+void Rules_NewGame(Rules_Board *board);
+
+/* Checks that the masks do not overlap, kings are pieces, no side has more
+   than RULES_MAX_PIECES and the turn is a color. */
+uint8 Rules_IsValid(const Rules_Board *board);
+
+uint8 Rules_IsJump(uint8 from, uint8 to);
+
+/* Lists the hops of the side to move, jumps first. With piece >= 0 only
+   the jumps of that piece are listed (it has just jumped). At most 'capacity'
+   hops are written to out. Returns the count. */
+uint8 Rules_LegalHops(const Rules_Board *board, int8 piece, Rules_Hop *out, uint8 capacity);
+
+/* Plays a hop without checking it: moves the piece, removes a jumped piece
+   and crowns. The turn is not changed. */
+void Rules_ApplyHop(Rules_Board *board, uint8 from, uint8 to);
+
+/* Plays a whole move given as (from, to) byte pairs, then passes the turn.
+   Returns 0 and leaves the board as it was if any hop is illegal. */
+uint8 Rules_PlayMove(Rules_Board *board, const uint8 *hops, uint8 count);
+
+#endif
@@ -0,0 +1,101 @@
+#include "serial.h"
+
+volatile uint32 Serial_rxOverflows = 0;
+
+static volatile uint8 rxRing[SERIAL_RX_SIZE];
+static volatile uint8 rxHead = 0;  /* written by the interrupt */
+static volatile uint8 rxTail = 0;  /* written by the main loop */
+
+static volatile uint8 txRing[SERIAL_TX_SIZE];
+static volatile uint8 txHead = 0;  /* written by the main loop */
+static volatile uint8 txTail = 0;  /* written by the interrupt */
+
+CY_ISR(Serial_Isr)
+{
+    uint8 next;
+
+    if((UART_GetRxInterruptSourceMasked() & UART_INTR_RX_NOT_EMPTY) != 0u)
+    {
+        while(UART_SpiUartGetRxBufferSize() != 0u)
+        {
+            uint8 byte = (uint8)UART_SpiUartReadRxData();
+            next = (uint8)((rxHead + 1u) & (SERIAL_RX_SIZE - 1u));
+            if(next == rxTail)
+            {
+                ++Serial_rxOverflows;
+            }
+            else
+            {
+                rxRing[rxHead] = byte;
+                rxHead = next;
+            }
+        }
+        UART_ClearRxInterruptSource(UART_INTR_RX_NOT_EMPTY);
+    }
+
+    if((UART_GetTxInterruptSourceMasked() & UART_INTR_TX_NOT_FULL) != 0u)
+    {
+        while(txTail != txHead && (UART_GetTxInterruptSource() & UART_INTR_TX_NOT_FULL) != 0u)
+        {
+            UART_SpiUartWriteTxData(txRing[txTail]);
+            txTail = (uint8)((txTail + 1u) & (SERIAL_TX_SIZE - 1u));
+        }
+        if(txTail == txHead)
+        {
+            //nothing left to send, so stop asking for FIFO space
+            UART_SetTxInterruptMode(UART_NO_INTR_SOURCES);
+        }
+        UART_ClearTxInterruptSource(UART_INTR_TX_NOT_FULL);
+    }
+}
+
+void Serial_Start(void)
+{
+    UART_Start();
+    UART_SetCustomInterruptHandler(&Serial_Isr);
+    UART_SetTxInterruptMode(UART_NO_INTR_SOURCES);
+    UART_SetRxInterruptMode(UART_INTR_RX_NOT_EMPTY);
+}
+
+uint8 Serial_Read(uint8 *byte)
+{
+    if(rxTail == rxHead)
+    {
+        return 0;
+    }
+    *byte = rxRing[rxTail];
+    rxTail = (uint8)((rxTail + 1u) & (SERIAL_RX_SIZE - 1u));
+    return 1;
+}
+
+void Serial_Write(const uint8 *data, uint32 size)
+{
+    uint32 i;
+    for(i = 0; i < size; ++i)
+    {
+        uint8 next = (uint8)((txHead + 1u) & (SERIAL_TX_SIZE - 1u));
+        if(next == txTail)
+        {
+            //the ring is full; let the interrupt drain it
+            UART_SetTxInterruptMode(UART_INTR_TX_NOT_FULL);
+            while(next == txTail)
+            {
+            }
+        }
+        txRing[txHead] = data[i];
+        txHead = next;
+    }
+    UART_SetTxInterruptMode(UART_INTR_TX_NOT_FULL);
+}
+
+void Serial_WaitForInput(void)
+{
+    //interrupts stay masked between the check and the sleep, so a byte that
+    //arrives in between still wakes the CPU instead of being noticed late
+    uint8 interruptState = CyEnterCriticalSection();
+    if(rxTail == rxHead)
+    {
+        CySysPmSleep();
+    }
+    CyExitCriticalSection(interruptState);
+}
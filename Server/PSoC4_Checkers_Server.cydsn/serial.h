@@ -0,0 +1,34 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+/*
+ * Interrupt-driven UART buffering.
+ *
+ * The UART interrupt moves received bytes from the hardware FIFO into the
+ * RX ring and feeds the TX FIFO from the TX ring, so no byte is lost while
+ * the main loop is busy and writing never waits on the line unless the TX
+ * ring is full. Each ring has one producer and one consumer (the interrupt
+ * and the main loop), so no locking is needed around the indices.
+ *
+ * The UART component must have its interrupt set to "Internal".
+ */
+
+#include "project.h"
+
+#define SERIAL_RX_SIZE 128u  /* power of two */
+#define SERIAL_TX_SIZE 128u  /* power of two */
+
+extern volatile uint32 Serial_rxOverflows;  /* bytes dropped because the RX ring was full */
+
+void Serial_Start(void);
+
+/* Takes one received byte. Returns 0 if none is waiting. */
+uint8 Serial_Read(uint8 *byte);
+
+/* Queues bytes for sending, waiting only while the TX ring is full. */
+void Serial_Write(const uint8 *data, uint32 size);
+
+/* Sleeps until an interrupt unless a received byte is already waiting. */
+void Serial_WaitForInput(void);
+
+#endif
@@ -0,0 +1,403 @@
+#include "server.h"
+#include "protocol.h"
+#include "serial.h"
+#include "rules.h"
+#include "ai.h"
+#include "ticks.h"
+#include "storage.h"
+
+static Protocol_Parser parser;
+static Rules_Board board;
+static uint16 boardHash;
+static uint8 history[2 * PROTOCOL_GAME_HOPS];  //(from, to) of the last hops played, for saved games
+static uint8 historyLength = 0;                //in hops
+static uint8 txSeq = 0;
+static uint32 handleStart = 0;  //when the board took up the frame being answered
+
+//frames are handled in SEQ order; one slot per SEQ of the window holds early ones
+static uint8 rxExpected = 0;
+static uint8 lastStatus = PROTOCOL_OK;
+static Protocol_Frame early[PROTOCOL_WINDOW];
+static uint8 earlyUsed[PROTOCOL_WINDOW];
+
+static void sendFrame(uint8 type, const uint8 *payload, uint8 length);
+static void sendAck(uint8 seq, uint8 status);
+static void sendBoard(void);
+static void boardChanged(void);
+static void remember(const uint8 *hops, uint8 count);
+static void saveGame(const Protocol_Frame *frame);
+static void loadGame(const Protocol_Frame *frame);
+static void listGames(const Protocol_Frame *frame);
+static void acceptFrame(const Protocol_Frame *frame);
+static void handleFrame(const Protocol_Frame *frame);
+
+void Server_Init(void)
+{
+    Protocol_Reset(&parser);
+    Rules_NewGame(&board);
+    boardChanged();
+}
+
+void Server_Start(void)
+{
+    //the client learns the position without asking
+    sendBoard();
+}
+
+void Server_Receive(uint8 byte)
+{
+    switch(Protocol_Feed(&parser, byte))
+    {
+    case PROTOCOL_FRAME:
+        handleStart = Ticks_Now();
+        acceptFrame(&parser.frame);
+        break;
+    case PROTOCOL_ERROR:
+        handleStart = Ticks_Now();
+        sendAck(parser.frame.seq, PROTOCOL_BAD_CRC);
+        break;
+    case PROTOCOL_BAD_LENGTH:
+        //the SEQ was never read, so there is no frame to ask for: the parser looks for the next SOF
+        break;
+    default:
+        break;
+    }
+}
+
+static void sendFrame(uint8 type, const uint8 *payload, uint8 length)
+{
+    uint8 out[PROTOCOL_MAX_FRAME];
+    uint32 size = Protocol_Encode(type, txSeq++, payload, length, out);
+    Serial_Write(out, size);
+}
+
+static void sendAck(uint8 seq, uint8 status)
+{
+    uint8 payload[PROTOCOL_ACK_SIZE];
+    uint32 spent = (Ticks_Now() - handleStart) / PROTOCOL_ACK_TIME_UNIT;
+    if(status != PROTOCOL_BAD_CRC)
+    {
+        lastStatus = status;
+    }
+    if(spent > 0xFFFFu)
+    {
+        spent = 0xFFFFu;
+    }
+    payload[0] = seq;
+    payload[1] = status;
+    payload[2] = (uint8)spent;
+    payload[3] = (uint8)(spent >> 8);
+    sendFrame(PROTOCOL_MSG_ACK, payload, PROTOCOL_ACK_SIZE);
+}
+
+static void toSnapshot(const Rules_Board *from, Protocol_Board *to)
+{
+    to->red = from->red;
+    to->black = from->black;
+    to->kings = from->kings;
+    to->turn = from->turn;
+}
+
+static void boardChanged(void)
+{
+    Protocol_Board snapshot;
+    toSnapshot(&board, &snapshot);
+    boardHash = Protocol_BoardHash(&snapshot);
+}
+
+static void remember(const uint8 *hops, uint8 count)
+{
+    uint8 i;
+    uint8 j;
+
+    for(i = 0; i < count; ++i)
+    {
+        //a full history drops its oldest hop
+        if(historyLength == PROTOCOL_GAME_HOPS)
+        {
+            for(j = 2; j < 2u * PROTOCOL_GAME_HOPS; ++j)
+            {
+                history[j - 2u] = history[j];
+            }
+            --historyLength;
+        }
+        history[2u * historyLength] = hops[2u * i];
+        history[2u * historyLength + 1u] = hops[2u * i + 1u];
+        ++historyLength;
+    }
+}
+
+static uint8 countPieces(uint32 mask)
+{
+    uint8 count = 0;
+    while(mask != 0u)
+    {
+        mask &= mask - 1u;
+        ++count;
+    }
+    return count;
+}
+
+static void sendBoard(void)
+{
+    Protocol_Board snapshot;
+    uint8 sync[PROTOCOL_SYNC_SIZE];
+    toSnapshot(&board, &snapshot);
+    Protocol_PackBoard(&snapshot, sync);
+    sendFrame(PROTOCOL_MSG_BOARD_SYNC, sync, PROTOCOL_SYNC_SIZE);
+}
+
+static void acceptFrame(const Protocol_Frame *frame)
+{
+    uint8 ahead = (uint8)(frame->seq - rxExpected);
+    uint8 holding = 0;
+    uint8 slot;
+
+    if(frame->type == PROTOCOL_MSG_HELLO)
+    {
+        //a new session: what was held back belongs to the old one
+        for(slot = 0; slot < PROTOCOL_WINDOW; ++slot)
+        {
+            earlyUsed[slot] = 0;
+        }
+        rxExpected = (uint8)(frame->seq + 1u);
+        sendAck(frame->seq, PROTOCOL_OK);
+        return;
+    }
+    if(ahead >= PROTOCOL_WINDOW)
+    {
+        //handled already, so its ack went missing
+        sendAck((uint8)(rxExpected - 1u), lastStatus);
+        return;
+    }
+    if(ahead > 0u)
+    {
+        //the first frame held back asks for the missing one, so it is not left to time out
+        for(slot = 0; slot < PROTOCOL_WINDOW; ++slot)
+        {
+            holding |= earlyUsed[slot];
+        }
+        if(!holding)
+        {
+            sendAck(rxExpected, PROTOCOL_BAD_CRC);
+        }
+        early[frame->seq % PROTOCOL_WINDOW] = *frame;
+        earlyUsed[frame->seq % PROTOCOL_WINDOW] = 1;
+        return;
+    }
+
+    handleFrame(frame);
+    ++rxExpected;
+    //the frames that came early may be next
+    slot = rxExpected % PROTOCOL_WINDOW;
+    while(earlyUsed[slot] && early[slot].seq == rxExpected)
+    {
+        earlyUsed[slot] = 0;
+        handleStart = Ticks_Now();
+        handleFrame(&early[slot]);
+        ++rxExpected;
+        slot = rxExpected % PROTOCOL_WINDOW;
+    }
+}
+
+static void handleFrame(const Protocol_Frame *frame)
+{
+    Protocol_Board snapshot;
+    Rules_Board synced;
+    uint8 move[PROTOCOL_HASH_SIZE + 2 * AI_MAX_CHAIN];
+    uint8 ping[PROTOCOL_PING_SIZE];
+    uint32 now;
+    uint8 count;
+
+    switch(frame->type)
+    {
+    case PROTOCOL_MSG_NEW_GAME:
+        Rules_NewGame(&board);
+        historyLength = 0;
+        break;
+    case PROTOCOL_MSG_MOVE:
+        if(frame->length <= PROTOCOL_HASH_SIZE || frame->length % 2u != 0u)
+        {
+            sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+            return;
+        }
+        if(((frame->payload[0] << 8) | frame->payload[1]) != boardHash)
+        {
+            //played on another position: one snapshot puts the client right
+            sendAck(frame->seq, PROTOCOL_OUT_OF_SYNC);
+            sendBoard();
+            return;
+        }
+        if(!Rules_PlayMove(&board, frame->payload + PROTOCOL_HASH_SIZE, (frame->length - PROTOCOL_HASH_SIZE) / 2u))
+        {
+            //the board is the authority: the client gets the position back to resync
+            sendAck(frame->seq, PROTOCOL_ILLEGAL_MOVE);
+            sendBoard();
+            return;
+        }
+        remember(frame->payload + PROTOCOL_HASH_SIZE, (frame->length - PROTOCOL_HASH_SIZE) / 2u);
+        break;
+    case PROTOCOL_MSG_BOARD_SYNC:
+        if(frame->length == 0u)
+        {
+            sendAck(frame->seq, PROTOCOL_OK);
+            sendBoard();
+            return;
+        }
+        if(frame->length != PROTOCOL_SYNC_SIZE || !Protocol_UnpackBoard(frame->payload, &snapshot))
+        {
+            sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+            return;
+        }
+        synced.red = snapshot.red;
+        synced.black = snapshot.black;
+        synced.kings = snapshot.kings;
+        synced.turn = snapshot.turn;
+        if(!Rules_IsValid(&synced))
+        {
+            sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+            return;
+        }
+        board = synced;
+        historyLength = 0;
+        break;
+    case PROTOCOL_MSG_SAVE:
+        saveGame(frame);
+        return;
+    case PROTOCOL_MSG_LOAD:
+        loadGame(frame);
+        return;
+    case PROTOCOL_MSG_LIST:
+        listGames(frame);
+        return;
+    case PROTOCOL_MSG_AI_MOVE:
+        if(frame->length > 1u || (frame->length == 1u && frame->payload[0] == 0u))
+        {
+            sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+            return;
+        }
+        count = Ai_FindMove(&board, frame->length == 1u ? frame->payload[0] : AI_DEFAULT_DEPTH,
+            move + PROTOCOL_HASH_SIZE);
+        if(count == 0u)
+        {
+            sendAck(frame->seq, PROTOCOL_NO_MOVE);
+            return;
+        }
+        //the move goes out like the client's: on top of the hash it was played on
+        move[0] = (uint8)(boardHash >> 8);
+        move[1] = (uint8)boardHash;
+        Rules_PlayMove(&board, move + PROTOCOL_HASH_SIZE, count);
+        remember(move + PROTOCOL_HASH_SIZE, count);
+        boardChanged();
+        sendAck(frame->seq, PROTOCOL_OK);
+        sendFrame(PROTOCOL_MSG_MOVE, move, (uint8)(PROTOCOL_HASH_SIZE + 2u * count));
+        return;
+    case PROTOCOL_MSG_PING:
+        if(frame->length != 4u)
+        {
+            sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+            return;
+        }
+        now = Ticks_Now();
+        for(count = 0; count < 4u; ++count)
+        {
+            ping[count] = frame->payload[count];
+            ping[4 + count] = (uint8)(now >> (8 * count));
+        }
+        sendAck(frame->seq, PROTOCOL_OK);
+        sendFrame(PROTOCOL_MSG_PING, ping, PROTOCOL_PING_SIZE);
+        return;
+    default:
+        sendAck(frame->seq, PROTOCOL_BAD_TYPE);
+        return;
+    }
+    boardChanged();
+    sendAck(frame->seq, PROTOCOL_OK);
+}
+
+static void saveGame(const Protocol_Frame *frame)
+{
+    Storage_Game game;
+    uint8 i;
+
+    if(frame->length < 1u || frame->length > 2u || frame->payload[0] >= PROTOCOL_SLOTS)
+    {
+        sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+        return;
+    }
+    toSnapshot(&board, &game.board);
+    game.mode = frame->length == 2u ? frame->payload[1] : 0u;
+    game.hopCount = historyLength;
+    for(i = 0; i < 2u * historyLength; ++i)
+    {
+        game.hops[i] = history[i];
+    }
+    sendAck(frame->seq, Storage_Save(frame->payload[0], &game) ? PROTOCOL_OK : PROTOCOL_FLASH_FAILED);
+}
+
+static void loadGame(const Protocol_Frame *frame)
+{
+    //one frame brings the client the whole game: position, mode and last hops
+    uint8 payload[2u + PROTOCOL_SYNC_SIZE + 2u * PROTOCOL_GAME_HOPS];
+    Storage_Game game;
+    uint8 i;
+
+    if(frame->length != 1u || frame->payload[0] >= PROTOCOL_SLOTS)
+    {
+        sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+        return;
+    }
+    if(!Storage_Load(frame->payload[0], &game))
+    {
+        sendAck(frame->seq, PROTOCOL_EMPTY_SLOT);
+        return;
+    }
+    board.red = game.board.red;
+    board.black = game.board.black;
+    board.kings = game.board.kings;
+    board.turn = game.board.turn;
+    historyLength = game.hopCount;
+    for(i = 0; i < 2u * historyLength; ++i)
+    {
+        history[i] = game.hops[i];
+    }
+    boardChanged();
+    sendAck(frame->seq, PROTOCOL_OK);
+
+    payload[0] = frame->payload[0];
+    Protocol_PackBoard(&game.board, payload + 1);
+    payload[1u + PROTOCOL_SYNC_SIZE] = game.mode;
+    for(i = 0; i < 2u * historyLength; ++i)
+    {
+        payload[2u + PROTOCOL_SYNC_SIZE + i] = history[i];
+    }
+    sendFrame(PROTOCOL_MSG_GAME, payload, (uint8)(2u + PROTOCOL_SYNC_SIZE + 2u * historyLength));
+}
+
+static void listGames(const Protocol_Frame *frame)
+{
+    uint8 payload[PROTOCOL_LIST_ENTRY_SIZE * PROTOCOL_SLOTS];
+    uint8 length = 0;
+    Storage_Game game;
+    uint8 slot;
+
+    if(frame->length != 0u)
+    {
+        sendAck(frame->seq, PROTOCOL_BAD_PAYLOAD);
+        return;
+    }
+    for(slot = 0; slot < PROTOCOL_SLOTS; ++slot)
+    {
+        if(!Storage_Load(slot, &game))
+        {
+            continue;
+        }
+        payload[length++] = slot;
+        payload[length++] = game.mode;
+        payload[length++] = game.board.turn;
+        payload[length++] = countPieces(game.board.red);
+        payload[length++] = countPieces(game.board.black);
+    }
+    sendAck(frame->seq, PROTOCOL_OK);
+    sendFrame(PROTOCOL_MSG_LIST, payload, length);
+}
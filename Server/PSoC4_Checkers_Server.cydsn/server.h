@@ -0,0 +1,20 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/*
+ * Game logic of the server: keeps the board and answers the frames of the
+ * client (see protocol.h). It only talks to the UART through serial.h, so it
+ * builds unchanged for the board and for the host simulator.
+ */
+
+#include "project.h"
+
+void Server_Init(void);
+
+/* Sends the board's snapshot; called once the UART runs. */
+void Server_Start(void);
+
+/* Takes one received byte; the frame it completes is handled and answered. */
+void Server_Receive(uint8 byte);
+
+#endif
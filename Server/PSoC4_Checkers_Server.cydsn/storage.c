@@ -0,0 +1,163 @@
+#include "storage.h"
+
+/* Record: magic, slot, sequence (32 bits), snapshot, mode, hop count, hops,
+   then the CRC of all that (high byte first). The rest of the row is 0. */
+#define RECORD_MAGIC 0xC5u
+#define RECORD_SLOT 1u
+#define RECORD_SEQUENCE 2u
+#define RECORD_BOARD 6u
+#define RECORD_MODE (RECORD_BOARD + PROTOCOL_SYNC_SIZE)
+#define RECORD_HOP_COUNT (RECORD_MODE + 1u)
+#define RECORD_HOPS (RECORD_HOP_COUNT + 1u)
+#define RECORD_CRC (RECORD_HOPS + 2u * PROTOCOL_GAME_HOPS)
+#define RECORD_SIZE (RECORD_CRC + 2u)
+
+#define NO_ROW 0xFFu
+
+/* The rows are a const array, so the linker places no code or data in them;
+   a port without a linker script (the simulator) defines STORAGE_AREA. */
+#ifndef STORAGE_AREA
+CY_ALIGN(CY_FLASH_SIZEOF_ROW) static const uint8 area[STORAGE_ROWS * CY_FLASH_SIZEOF_ROW] = { 0u };
+#define STORAGE_AREA area
+#endif
+#define FIRST_ROW (((uintptr_t)STORAGE_AREA - CY_FLASH_BASE) / CY_FLASH_SIZEOF_ROW)
+
+static uint8 latest[PROTOCOL_SLOTS];  //row of each slot's latest game
+static uint32 nextSequence;
+static uint8 nextRow;
+
+static const uint8 *rowAt(uint8 row)
+{
+    return (const uint8 *)STORAGE_AREA + row * CY_FLASH_SIZEOF_ROW;
+}
+
+static uint32 readLong(const uint8 *from)
+{
+    return from[0] | (uint32)from[1] << 8 | (uint32)from[2] << 16 | (uint32)from[3] << 24;
+}
+
+static uint8 isRecord(const uint8 *record)
+{
+    uint16 crc = Protocol_Crc16(0xFFFFu, record, RECORD_CRC);
+    return record[0] == RECORD_MAGIC && record[RECORD_SLOT] < PROTOCOL_SLOTS
+        && record[RECORD_HOP_COUNT] <= PROTOCOL_GAME_HOPS
+        && record[RECORD_CRC] == (uint8)(crc >> 8) && record[RECORD_CRC + 1u] == (uint8)crc;
+}
+
+static uint8 isLatest(uint8 row)
+{
+    uint8 slot;
+    for(slot = 0; slot < PROTOCOL_SLOTS; ++slot)
+    {
+        if(latest[slot] == row)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void Storage_Start(void)
+{
+    uint8 row;
+    uint8 slot;
+
+    for(slot = 0; slot < PROTOCOL_SLOTS; ++slot)
+    {
+        latest[slot] = NO_ROW;
+    }
+    nextSequence = 1;
+    nextRow = 0;
+
+    for(row = 0; row < STORAGE_ROWS; ++row)
+    {
+        const uint8 *record = rowAt(row);
+        uint32 sequence;
+
+        //erased rows and torn writes fail the check
+        if(!isRecord(record))
+        {
+            continue;
+        }
+        sequence = readLong(record + RECORD_SEQUENCE);
+        slot = record[RECORD_SLOT];
+        if(latest[slot] == NO_ROW || sequence > readLong(rowAt(latest[slot]) + RECORD_SEQUENCE))
+        {
+            latest[slot] = row;
+        }
+        //the rows go on in turn from the last one written
+        if(sequence >= nextSequence)
+        {
+            nextSequence = sequence + 1u;
+            nextRow = (uint8)((row + 1u) % STORAGE_ROWS);
+        }
+    }
+}
+
+uint8 Storage_Save(uint8 slot, const Storage_Game *game)
+{
+    uint8 record[CY_FLASH_SIZEOF_ROW];
+    uint8 row = nextRow;
+    uint16 crc;
+    uint32 i;
+
+    //there are more rows than slots, so one is always free
+    while(isLatest(row))
+    {
+        row = (uint8)((row + 1u) % STORAGE_ROWS);
+    }
+
+    for(i = 0; i < CY_FLASH_SIZEOF_ROW; ++i)
+    {
+        record[i] = 0;
+    }
+    record[0] = RECORD_MAGIC;
+    record[RECORD_SLOT] = slot;
+    for(i = 0; i < 4u; ++i)
+    {
+        record[RECORD_SEQUENCE + i] = (uint8)(nextSequence >> (8u * i));
+    }
+    Protocol_PackBoard(&game->board, record + RECORD_BOARD);
+    record[RECORD_MODE] = game->mode;
+    record[RECORD_HOP_COUNT] = game->hopCount;
+    for(i = 0; i < 2u * game->hopCount; ++i)
+    {
+        record[RECORD_HOPS + i] = game->hops[i];
+    }
+    crc = Protocol_Crc16(0xFFFFu, record, RECORD_CRC);
+    record[RECORD_CRC] = (uint8)(crc >> 8);
+    record[RECORD_CRC + 1u] = (uint8)crc;
+
+    //the old copy stays the latest until the new one reads back whole
+    if(CySysFlashWriteRow((uint32)(FIRST_ROW + row), record) != CY_SYS_FLASH_SUCCESS || !isRecord(rowAt(row)))
+    {
+        return 0;
+    }
+    latest[slot] = row;
+    ++nextSequence;
+    nextRow = (uint8)((row + 1u) % STORAGE_ROWS);
+    return 1;
+}
+
+uint8 Storage_Load(uint8 slot, Storage_Game *game)
+{
+    const uint8 *record;
+    uint8 i;
+
+    if(latest[slot] == NO_ROW)
+    {
+        return 0;
+    }
+    record = rowAt(latest[slot]);
+    if(!Protocol_UnpackBoard(record + RECORD_BOARD, &game->board))
+    {
+        return 0;
+    }
+    game->mode = record[RECORD_MODE];
+    game->hopCount = record[RECORD_HOP_COUNT];
+    for(i = 0; i < 2u * game->hopCount; ++i)
+    {
+        game->hops[i] = record[RECORD_HOPS + i];
+    }
+    return 1;
+}
@@ -0,0 +1,38 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+/*
+ * Saved games in rows of flash kept for them, one game per row.
+ *
+ * A save never overwrites the copy it replaces: it goes to the next row in
+ * turn that holds no slot's latest game, with a sequence number above all
+ * others. So the writes spread over every row not in use (wear leveling),
+ * and a write cut short by a reset leaves the old copy, as the new one fails
+ * its CRC. At start the rows are scanned once for each slot's latest game.
+ *
+ * Writing a row stalls the CPU for about 20 ms on the chip, and interrupts
+ * wait until it is done.
+ */
+
+#include "project.h"
+#include "protocol.h"
+
+#define STORAGE_ROWS 8u  /* more than PROTOCOL_SLOTS */
+
+typedef struct
+{
+    Protocol_Board board;
+    uint8 mode;                          /* the client's game mode, kept as is */
+    uint8 hopCount;
+    uint8 hops[2 * PROTOCOL_GAME_HOPS];  /* (from, to) of the last hops, oldest first */
+} Storage_Game;
+
+void Storage_Start(void);
+
+/* Writes a game to a slot. Returns 0 if the flash could not be written. */
+uint8 Storage_Save(uint8 slot, const Storage_Game *game);
+
+/* Reads the latest game of a slot. Returns 0 if the slot is empty. */
+uint8 Storage_Load(uint8 slot, Storage_Game *game);
+
+#endif
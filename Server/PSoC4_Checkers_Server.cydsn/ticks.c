@@ -0,0 +1,31 @@
+#include "ticks.h"
+
+static volatile uint32 milliseconds = 0;
+
+static void countMillisecond(void)
+{
+    ++milliseconds;
+}
+
+void Ticks_Start(void)
+{
+    //SysTick counts down from its reload value once per millisecond
+    CySysTickStart();
+    CySysTickSetCallback(0, countMillisecond);
+}
+
+uint32 Ticks_Now(void)
+{
+    uint32 reload = CySysTickGetReload();
+    uint32 ms;
+    uint32 value;
+
+    //read again if the millisecond ended between the two reads
+    do
+    {
+        ms = milliseconds;
+        value = CySysTickGetValue();
+    }
+    while(ms != milliseconds);
+    return ms * 1000u + (reload - value) * 1000u / (reload + 1u);
+}
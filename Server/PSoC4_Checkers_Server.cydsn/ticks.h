@@ -0,0 +1,17 @@
+#ifndef TICKS_H
+#define TICKS_H
+
+/*
+ * Microsecond clock for timing the link, built on the SysTick timer: its
+ * interrupt counts milliseconds and its counter gives the part of the
+ * current one. It wraps after about 71 minutes, so only differences count.
+ */
+
+#include "project.h"
+
+void Ticks_Start(void);
+
+/* Microseconds since Ticks_Start. */
+uint32 Ticks_Now(void);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * Unit tests and cost of the board's search (ai.c) on the host.
+ *
+ *   ai-test [games] [depth]
+ *
+ * Cortex-M0 cycles are estimated from the node count at AI_CYCLES_PER_NODE;
+ * the host time per node is printed next to it for comparison.
+ */
+
+#include "ai.h"
+#include "constants.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static uint8 square(const char *name)
+{
+    return (uint8)((name[0] - 'a') / 2 + 4 * (name[1] - '1'));
+}
+
+static Rules_Board position(const char *red, const char *black, uint8 turn)
+{
+    //squares separated by spaces; upper case for kings, e.g. "c3 D4"
+    Rules_Board board;
+    const char *p;
+    board.red = 0;
+    board.black = 0;
+    board.kings = 0;
+    board.turn = turn;
+    for(p = red; *p != '\0'; p += p[2] == ' ' ? 3 : 2)
+    {
+        char name[2] = { (char)(p[0] | 0x20), p[1] };
+        board.red |= 1u << square(name);
+        board.kings |= (p[0] < 'a') ? 1u << square(name) : 0u;
+    }
+    for(p = black; *p != '\0'; p += p[2] == ' ' ? 3 : 2)
+    {
+        char name[2] = { (char)(p[0] | 0x20), p[1] };
+        board.black |= 1u << square(name);
+        board.kings |= (p[0] < 'a') ? 1u << square(name) : 0u;
+    }
+    return board;
+}
+
+static void picksCaptures(void)
+{
+    uint8 hops[2 * AI_MAX_CHAIN];
+    Rules_Board board;
+
+    //a free man on d4 for red's c3
+    board = position("c3 g1", "d4 h8", Red);
+    assert(Ai_FindMove(&board, 4, hops) == 1u);
+    assert(hops[0] == square("c3") && hops[1] == square("e5"));
+
+    //the whole double jump, not only its first hop
+    board = position("a1", "b2 d4 h8", Red);
+    assert(Ai_FindMove(&board, 4, hops) == 2u);
+    assert(hops[1] == square("c3") && hops[3] == square("e5"));
+    assert(Rules_PlayMove(&board, hops, 2) && board.black == 1u << square("h8"));
+
+    //not into a capture: e3-f4 would be taken by g5, e3-d4 is safe
+    board = position("e3", "g5 a7", Red);
+    assert(Ai_FindMove(&board, 4, hops) == 1u);
+    assert(hops[1] == square("d4"));
+
+    //no move at all
+    board = position("", "a3 b4", Red);
+    assert(Ai_FindMove(&board, 4, hops) == 0u);
+}
+
+static uint32 randomState = 2024u;
+
+static uint32 nextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static uint8 randomMove(Rules_Board *board)
+{
+    Rules_Hop list[RULES_MAX_HOPS];
+    uint8 count = Rules_LegalHops(board, -1, list, RULES_MAX_HOPS);
+    Rules_Hop hop;
+    if(count == 0u)
+    {
+        return 0;
+    }
+    //take the first capture chain offered, otherwise a random step
+    hop = Rules_IsJump(list[0].from, list[0].to) ? list[0] : list[nextRandom() % count];
+    for(;;)
+    {
+        Rules_ApplyHop(board, hop.from, hop.to);
+        if(!Rules_IsJump(hop.from, hop.to) || Rules_LegalHops(board, (int8)hop.to, list, RULES_MAX_HOPS) == 0u)
+        {
+            break;
+        }
+        hop = list[0];
+    }
+    board->turn = board->turn == Red ? Black : Red;
+    return 1;
+}
+
+static void playsRandomGames(int games, uint8 depth)
+{
+    //red searches, black plays at random; the search must win nearly always
+    //and stay inside its node budget
+    uint32 maxNodes = 0;
+    uint16 arenaPeak = 0;
+    double nodes = 0;
+    double elapsed = 0;
+    long moves = 0;
+    int wins = 0;
+    int g;
+
+    for(g = 0; g < games; ++g)
+    {
+        Rules_Board board;
+        int ply;
+        Rules_NewGame(&board);
+        for(ply = 0; ply < 300; ++ply)
+        {
+            if(board.turn == Red)
+            {
+                uint8 hops[2 * AI_MAX_CHAIN];
+                double start = now();
+                uint8 count = Ai_FindMove(&board, depth, hops);
+                elapsed += now() - start;
+                if(count == 0u)
+                {
+                    break;
+                }
+                assert(Rules_PlayMove(&board, hops, count));
+                nodes += Ai_stats.nodes;
+                maxNodes = Ai_stats.nodes > maxNodes ? Ai_stats.nodes : maxNodes;
+                arenaPeak = Ai_stats.arenaPeak > arenaPeak ? Ai_stats.arenaPeak : arenaPeak;
+                ++moves;
+            }
+            else if(!randomMove(&board))
+            {
+                ++wins;
+                break;
+            }
+            assert(Rules_IsValid(&board));
+        }
+    }
+
+    printf("ai: depth %u, %d/%d games won against random play\n", depth, wins, games);
+    printf("ai: %ld moves, %.0f nodes per move (max %u), %.2f us per node on this host\n",
+        moves, nodes / moves, (unsigned)maxNodes, elapsed * 1e6 / nodes);
+    printf("ai: estimated Cortex-M0 cost %.1f Mcycles per move (max %.1f, budget %.1f)\n",
+        nodes / moves * AI_CYCLES_PER_NODE / 1e6, (double)maxNodes * AI_CYCLES_PER_NODE / 1e6,
+        AI_CYCLE_BUDGET / 1e6);
+    printf("ai: arena peak %u of %u hops\n", arenaPeak, AI_ARENA_SIZE);
+    assert(wins * 10 >= games * 9);
+    //only the node that trips the budget is over it
+    assert(maxNodes <= AI_NODE_BUDGET + 1u);
+    assert(arenaPeak <= AI_ARENA_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    int games = argc > 1 ? atoi(argv[1]) : 20;
+    uint8 depth = (uint8)(argc > 2 ? atoi(argv[2]) : (int)AI_DEFAULT_DEPTH);
+
+    picksCaptures();
+    playsRandomGames(games, depth);
+    printf("ai: static RAM %u bytes (undo stack %u, hop arena %u)\n",
+        (unsigned)(AI_MAX_PLY * sizeof(Rules_Board) + AI_ARENA_SIZE * sizeof(Rules_Hop) + sizeof(Ai_Stats)),
+        (unsigned)(AI_MAX_PLY * sizeof(Rules_Board)), (unsigned)(AI_ARENA_SIZE * sizeof(Rules_Hop)));
+    printf("ai: All test cases passed!\n");
+    return 0;
+}
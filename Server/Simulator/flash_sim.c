@@ -0,0 +1,73 @@
+#include "flash_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * A row write copies the row into memory and, with a file attached, writes
+ * it through to the file at once, so the image survives the process like
+ * the chip's flash survives a reset. A torn write leaves the first quarter
+ * of the row new and the rest erased.
+ */
+
+uint8 Sim_flash[CY_FLASH_NUMBER_ROWS * CY_FLASH_SIZEOF_ROW];
+uint32 Sim_flashRowWrites[CY_FLASH_NUMBER_ROWS];
+
+static FILE *image = 0;
+static uint32 tornWrites = 0;
+
+int Sim_FlashAttach(const char *path)
+{
+    if(image != 0)
+    {
+        fclose(image);
+    }
+    memset(Sim_flash, 0, sizeof Sim_flash);
+    image = fopen(path, "r+b");
+    if(image == 0)
+    {
+        image = fopen(path, "w+b");
+        if(image == 0)
+        {
+            return 0;
+        }
+    }
+    //a short or empty file reads as erased flash past its end
+    if(fread(Sim_flash, 1, sizeof Sim_flash, image) < sizeof Sim_flash && ferror(image))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+void Sim_FlashTearWrites(uint32 n)
+{
+    tornWrites = n;
+}
+
+uint32 CySysFlashWriteRow(uint32 rowNum, const uint8 rowData[])
+{
+    uint8 *row;
+
+    if(rowNum >= CY_FLASH_NUMBER_ROWS)
+    {
+        return CY_SYS_FLASH_INVALID_ADDR;
+    }
+    row = Sim_flash + rowNum * CY_FLASH_SIZEOF_ROW;
+    memcpy(row, rowData, CY_FLASH_SIZEOF_ROW);
+    if(tornWrites > 0u)
+    {
+        memset(row + CY_FLASH_SIZEOF_ROW / 4u, 0, CY_FLASH_SIZEOF_ROW - CY_FLASH_SIZEOF_ROW / 4u);
+        --tornWrites;
+    }
+    ++Sim_flashRowWrites[rowNum];
+    if(image != 0)
+    {
+        if(fseek(image, (long)(rowNum * CY_FLASH_SIZEOF_ROW), SEEK_SET) != 0
+            || fwrite(row, 1, CY_FLASH_SIZEOF_ROW, image) != CY_FLASH_SIZEOF_ROW || fflush(image) != 0)
+        {
+            return CY_SYS_FLASH_INVALID_ADDR;
+        }
+    }
+    return CY_SYS_FLASH_SUCCESS;
+}
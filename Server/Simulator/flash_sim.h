@@ -0,0 +1,21 @@
+#ifndef FLASH_SIM_H
+#define FLASH_SIM_H
+
+/*
+ * Simulator-only controls of the simulated flash (see project.h).
+ */
+
+#include "project.h"
+
+/* Keeps the flash in a file, created if it does not exist; rows written
+   since the program started are lost otherwise. Returns 0 if the file
+   cannot be used. Must be called before the firmware starts. */
+int Sim_FlashAttach(const char *path);
+
+/* Times each row was written, to check the wear. */
+extern uint32 Sim_flashRowWrites[CY_FLASH_NUMBER_ROWS];
+
+/* Cuts the next n row writes short, as a reset during the write would. */
+void Sim_FlashTearWrites(uint32 n);
+
+#endif
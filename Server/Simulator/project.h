@@ -0,0 +1,70 @@
+#ifndef PROJECT_H
+#define PROJECT_H
+
+/*
+ * Host stand-in for the project.h that PSoC Creator generates. It declares
+ * only what the firmware uses; uart_sim.c implements it on top of a file
+ * descriptor (a pty or one end of a socketpair), and flash_sim.c keeps the
+ * flash in memory and, if asked, in a file.
+ */
+
+#include <stdint.h>
+
+typedef int8_t int8;
+typedef uint8_t uint8;
+typedef int16_t int16;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+
+#define CY_ISR(name) void name(void)
+#define CY_ISR_PROTO(name) void name(void)
+typedef void (*cyisraddress)(void);
+
+/* interrupts: the simulated interrupt runs on another thread and a critical
+   section holds it off, as PRIMASK does on the chip */
+#define CyGlobalIntEnable Sim_EnableInterrupts()
+void Sim_EnableInterrupts(void);
+uint8 CyEnterCriticalSection(void);
+void CyExitCriticalSection(uint8 savedIntrStatus);
+void CySysPmSleep(void);
+
+/* SysTick: reloads every millisecond, counting down at 48 MHz */
+typedef void (*cySysTickCallback)(void);
+void CySysTickStart(void);
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function);
+uint32 CySysTickGetValue(void);
+uint32 CySysTickGetReload(void);
+
+/* flash (CyFlash.h): 32 KB in rows of 128 bytes, as on the CY8C4245; erased rows read 0 */
+#define CY_FLASH_SIZEOF_ROW 128u
+#define CY_FLASH_NUMBER_ROWS 256u
+#define CY_FLASH_BASE ((uintptr_t)Sim_flash)
+#define CY_SYS_FLASH_SUCCESS 0x00u
+#define CY_SYS_FLASH_INVALID_ADDR 0x04u
+extern uint8 Sim_flash[CY_FLASH_NUMBER_ROWS * CY_FLASH_SIZEOF_ROW];
+uint32 CySysFlashWriteRow(uint32 rowNum, const uint8 rowData[]);
+#define CY_ALIGN(align) __attribute__((aligned(align)))
+
+/* there is no linker script to place the saved games, so they take the last rows */
+#define STORAGE_AREA (Sim_flash + (CY_FLASH_NUMBER_ROWS - STORAGE_ROWS) * CY_FLASH_SIZEOF_ROW)
+
+/* UART (SCB component) */
+#define UART_FIFO_SIZE 8u
+#define UART_NO_INTR_SOURCES 0u
+#define UART_INTR_TX_NOT_FULL 0x02u
+#define UART_INTR_RX_NOT_EMPTY 0x04u
+
+void UART_Start(void);
+void UART_SetCustomInterruptHandler(cyisraddress func);
+void UART_SetRxInterruptMode(uint32 interruptMask);
+void UART_SetTxInterruptMode(uint32 interruptMask);
+uint32 UART_GetRxInterruptSourceMasked(void);
+uint32 UART_GetTxInterruptSource(void);
+uint32 UART_GetTxInterruptSourceMasked(void);
+void UART_ClearRxInterruptSource(uint32 interruptMask);
+void UART_ClearTxInterruptSource(uint32 interruptMask);
+uint32 UART_SpiUartGetRxBufferSize(void);
+uint32 UART_SpiUartReadRxData(void);
+void UART_SpiUartWriteTxData(uint32 txData);
+
+#endif
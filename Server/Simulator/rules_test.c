@@ -0,0 +1,259 @@
+/*
+ * Unit tests and timing of the rules engine (rules.c) on the host.
+ *
+ *   rules-test [games]
+ */
+
+#include "rules.h"
+#include "constants.h"
+#include "protocol.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static uint8 play(Rules_Board *board, const char *move)
+{
+    //squares joined by '-' or 'x', e.g. "c3-d4", "a3xc5xe7"
+    uint8 hops[2 * 16];
+    uint8 count = 0;
+    int from = (move[0] - 'a') / 2 + 4 * (move[1] - '1');
+    const char *p;
+    for(p = move + 2; *p != '\0' && count < 16u; p += 3)
+    {
+        int to = (p[1] - 'a') / 2 + 4 * (p[2] - '1');
+        hops[2 * count] = (uint8)from;
+        hops[2 * count + 1] = (uint8)to;
+        ++count;
+        from = to;
+    }
+    return Rules_PlayMove(board, hops, count);
+}
+
+static void capturesFollowConstants(void)
+{
+    //a red king with a black man on each diagonal: the jumps land and capture
+    //at the offsets of constants.h (odd and even are rank numbers)
+    uint8 sq;
+    for(sq = 0; sq < 32u; ++sq)
+    {
+        Rules_Hop list[RULES_MAX_HOPS];
+        int odd = (sq / 4) % 2 == 0;
+        int cap[4];
+        int half[4];
+        uint8 count;
+        uint8 i;
+        Rules_Board board;
+
+        cap[0] = rOddLeftCapJmp;
+        half[0] = odd ? rOddLeftHafJmp : rEvenLeftHafJmp;
+        cap[1] = rOddRightCapJmp;
+        half[1] = odd ? rOddRightHafJmp : rEvenRightHafJmp;
+        cap[2] = bOddLeftCapJmp;
+        half[2] = odd ? bOddLeftHafJmp : bEvenLeftHafJmp;
+        cap[3] = bOddRightCapJmp;
+        half[3] = odd ? bOddRightHafJmp : bEvenRightHafJmp;
+
+        board.red = 1u << sq;
+        board.kings = 1u << sq;
+        board.black = 0;
+        board.turn = Red;
+        for(i = 0; i < 4u; ++i)
+        {
+            int to = sq + cap[i];
+            int mid = sq + half[i];
+            //skip diagonals that run off the board (the column wraps or the row ends)
+            if(to < 0 || to > 31 || abs(to / 4 - sq / 4) != 2 || abs((to % 4) - (sq % 4)) > 1
+                || abs(mid / 4 - sq / 4) != 1)
+            {
+                cap[i] = 0;
+                continue;
+            }
+            board.black |= 1u << mid;
+        }
+
+        count = Rules_LegalHops(&board, -1, list, RULES_MAX_HOPS);
+        for(i = 0; i < 4u; ++i)
+        {
+            uint8 found = 0;
+            uint8 j;
+            if(cap[i] == 0)
+            {
+                continue;
+            }
+            for(j = 0; j < count; ++j)
+            {
+                if(list[j].to == sq + cap[i])
+                {
+                    Rules_Board after = board;
+                    Rules_ApplyHop(&after, sq, list[j].to);
+                    assert((after.black >> (sq + half[i]) & 1u) == 0u);
+                    assert(Rules_IsJump(sq, list[j].to));
+                    found = 1;
+                }
+            }
+            assert(found);
+        }
+    }
+}
+
+static void movesAreChecked(void)
+{
+    Rules_Hop list[RULES_MAX_HOPS];
+    Rules_Board board;
+    Rules_Board before;
+
+    //the opening: seven steps, no jumps
+    Rules_NewGame(&board);
+    assert(Rules_LegalHops(&board, -1, list, RULES_MAX_HOPS) == 7u);
+
+    assert(play(&board, "c3-d4") && board.turn == Black);
+    assert(play(&board, "f6-e5"));
+    assert(play(&board, "d4xf6") && board.turn == Black);
+    assert(board.red == 0x00400DFFu && board.black == 0xFFB00000u);
+
+    //illegal moves leave the board as it was
+    before = board;
+    assert(!play(&board, "e3-f4"));          //red's piece on black's turn
+    assert(!play(&board, "g7-h6"));          //onto an occupied square
+    assert(!play(&board, "h6-g5-f4"));       //a step cannot be continued
+    assert(!play(&board, "b6-c5xe3"));
+    assert(!play(&board, "e7xc5"));          //over its own piece
+    assert(board.red == before.red && board.black == before.black && board.turn == before.turn);
+
+    //men only go forward; a capture chain may stop early
+    board.red = 1u << 13;      //d4
+    board.black = (1u << 17) | (1u << 25) | (1u << 9); //c5, c7, c3
+    board.kings = 0;
+    board.turn = Red;
+    before = board;
+    assert(!play(&board, "d4-e3"));
+    assert(!play(&board, "d4xb2"));
+    assert(play(&board, "d4xb6") && board.black == ((1u << 25) | (1u << 9)));
+    //a man crowned by a jump may go on jumping as a king
+    board = before;
+    board.black = (1u << 17) | (1u << 25) | (1u << 26); //c5, c7, e7
+    assert(play(&board, "d4xb6xd8xf6"));
+    assert(board.red == 1u << 22 && board.kings == 1u << 22 && board.black == 0u);
+}
+
+static void listsAreBounded(void)
+{
+    //16 red kings on every other row would have 49 hops: no side may have more than 12,
+    //and a list never runs past its capacity
+    Rules_Hop list[RULES_MAX_HOPS + 1u];
+    Rules_Board board;
+    Protocol_Board wire;
+    uint8 snapshot[PROTOCOL_SYNC_SIZE];
+    uint8 i;
+
+    board.red = 0xF0F0F0F0u;
+    board.black = 0;
+    board.kings = board.red;
+    board.turn = Red;
+    assert(!Rules_IsValid(&board));
+    for(i = 0; i < RULES_MAX_HOPS + 1u; ++i)
+    {
+        list[i].from = 0xFFu;
+    }
+    assert(Rules_LegalHops(&board, -1, list, RULES_MAX_HOPS) == RULES_MAX_HOPS);
+    assert(list[RULES_MAX_HOPS].from == 0xFFu);
+    assert(Rules_LegalHops(&board, -1, list, 3u) == 3u && list[3].from != 0xFFu);
+
+    //nor from the wire: a snapshot of 13 black men is refused, one of 12 is not
+    wire.red = 0x1u;
+    wire.black = 0xFFF80000u;
+    wire.kings = 0;
+    wire.turn = Black;
+    Protocol_PackBoard(&wire, snapshot);
+    assert(!Protocol_UnpackBoard(snapshot, &wire));
+    wire.black = 0xFFF00000u;
+    Protocol_PackBoard(&wire, snapshot);
+    assert(Protocol_UnpackBoard(snapshot, &wire));
+    board.red = wire.red;
+    board.black = wire.black;
+    board.kings = wire.kings;
+    board.turn = wire.turn;
+    assert(Rules_IsValid(&board));
+}
+
+static uint32 randomState = 12345u;
+
+static uint32 nextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void randomGames(int games)
+{
+    //every move made of listed hops is accepted, and the pieces never overlap
+    long moves = 0;
+    double start = now();
+    int g;
+    for(g = 0; g < games; ++g)
+    {
+        Rules_Board board;
+        int ply;
+        Rules_NewGame(&board);
+        for(ply = 0; ply < 200; ++ply)
+        {
+            Rules_Hop list[RULES_MAX_HOPS];
+            Rules_Board scratch = board;
+            uint8 hops[2 * 16];
+            uint8 count = Rules_LegalHops(&board, -1, list, RULES_MAX_HOPS);
+            uint8 n = 0;
+            if(count == 0u)
+            {
+                break;
+            }
+            list[0] = list[nextRandom() % count];
+            for(;;)
+            {
+                hops[2 * n] = list[0].from;
+                hops[2 * n + 1] = list[0].to;
+                ++n;
+                if(!Rules_IsJump(list[0].from, list[0].to) || n == 16u)
+                {
+                    break;
+                }
+                Rules_ApplyHop(&scratch, list[0].from, list[0].to);
+                count = Rules_LegalHops(&scratch, (int8)list[0].to, list, RULES_MAX_HOPS);
+                if(count == 0u || nextRandom() % 4u == 0u)
+                {
+                    break;
+                }
+                list[0] = list[nextRandom() % count];
+            }
+            assert(Rules_PlayMove(&board, hops, n));
+            assert(Rules_IsValid(&board));
+            ++moves;
+        }
+    }
+    printf("rules: %d random games, %ld moves checked, %.2f us per move\n",
+        games, moves, (now() - start) * 1e6 / (moves > 0 ? moves : 1));
+}
+
+int main(int argc, char *argv[])
+{
+    int games = argc > 1 ? atoi(argv[1]) : 2000;
+
+    capturesFollowConstants();
+    movesAreChecked();
+    listsAreBounded();
+    randomGames(games);
+    printf("rules: RAM per position %u bytes, per hop list %u bytes\n",
+        (unsigned)sizeof(Rules_Board), (unsigned)(RULES_MAX_HOPS * sizeof(Rules_Hop)));
+    printf("rules: All test cases passed!\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Runs the server firmware on the host.
+ *
+ *   checkers-sim [--baud N] [--fd N] [--flash FILE]
+ *
+ * Without --fd the simulated board opens a pseudo terminal and prints the
+ * name of its device, which the client opens like the board's COM port.
+ * With --fd it talks over an inherited descriptor (e.g. a socketpair).
+ * With --flash the board's flash, and so its saved games, is kept in FILE
+ * from one run to the next.
+ */
+
+#include "uart_sim.h"
+#include "flash_sim.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+
+int main(int argc, char *argv[])
+{
+    uint32 baud = 115200u;
+    int fd = -1;
+    int i;
+
+    for(i = 1; i + 1 < argc; i += 2)
+    {
+        if(strcmp(argv[i], "--baud") == 0)
+        {
+            baud = (uint32)strtoul(argv[i + 1], 0, 10);
+        }
+        else if(strcmp(argv[i], "--fd") == 0)
+        {
+            fd = atoi(argv[i + 1]);
+        }
+        else if(strcmp(argv[i], "--flash") == 0)
+        {
+            if(!Sim_FlashAttach(argv[i + 1]))
+            {
+                perror(argv[i + 1]);
+                return 1;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    if(i < argc)
+    {
+        fprintf(stderr, "usage: %s [--baud N] [--fd N] [--flash FILE]\n", argv[0]);
+        return 2;
+    }
+
+    if(fd < 0)
+    {
+        struct termios raw;
+        int slave;
+
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if(fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+        {
+            perror("posix_openpt");
+            return 1;
+        }
+        //bytes pass through the terminal unchanged; keeping the slave open
+        //lets clients come and go without the line hanging up
+        slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+        if(slave < 0 || tcgetattr(slave, &raw) != 0)
+        {
+            perror(ptsname(fd));
+            return 1;
+        }
+        cfmakeraw(&raw);
+        tcsetattr(slave, TCSANOW, &raw);
+        printf("Simulated board on %s at %lu baud\n", ptsname(fd), (unsigned long)baud);
+        fflush(stdout);
+    }
+
+    Sim_UartAttach(fd, baud);
+    return Firmware_Main();
+}
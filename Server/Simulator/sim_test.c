@@ -0,0 +1,575 @@
+/*
+ * Scripted sessions against the simulated board.
+ *
+ *   sim-test [sessions] [baud]
+ *
+ * The firmware runs on a thread of this process and the script talks to it
+ * over a socketpair. Every request must be answered with the right ack (and
+ * board sync); the run ends with the round-trip times and the throughput.
+ * The script keeps its own copy of the board to send moves on its hash. At
+ * the end it replays random games with one frame in flight and with a full
+ * window, to compare stop-and-wait with pipelining. The board's own time
+ * on each frame comes back in its ack and is reported next to the round
+ * trip, and PING checks that the board's clock keeps time with this one.
+ * Saved games go to the simulated flash, in memory only.
+ */
+
+#include "uart_sim.h"
+#include "protocol.h"
+#include "rules.h"
+#include "constants.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static int fd;
+static uint8 seq = 0;
+static Protocol_Parser parser;
+static Rules_Board mirror;
+static unsigned long frames = 0;
+static unsigned long long bytes = 0;
+static double totalMicroseconds = 0;
+static double maxMicroseconds = 0;
+static double boardMicroseconds = 0;
+static double boardMaxMicroseconds = 0;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "sim-test: %s\n", what);
+    exit(1);
+}
+
+static void *runFirmware(void *unused)
+{
+    (void)unused;
+    Firmware_Main();
+    return 0;
+}
+
+static void sendRaw(const uint8 *data, size_t size)
+{
+    if(write(fd, data, size) != (ssize_t)size)
+    {
+        fail("write failed");
+    }
+    bytes += size;
+}
+
+static void receive(Protocol_Frame *frame)
+{
+    for(;;)
+    {
+        struct pollfd p = { 0, POLLIN, 0 };
+        uint8 byte;
+        p.fd = fd;
+        if(poll(&p, 1, 2000) != 1 || read(fd, &byte, 1) != 1)
+        {
+            fail("no answer from the board");
+        }
+        ++bytes;
+        if(Protocol_Feed(&parser, byte) == PROTOCOL_FRAME)
+        {
+            *frame = parser.frame;
+            return;
+        }
+    }
+}
+
+static void expectAck(uint8 sent, uint8 status)
+{
+    Protocol_Frame frame;
+    double spent;
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_ACK || frame.length != PROTOCOL_ACK_SIZE || frame.payload[0] != sent)
+    {
+        fail("expected an ack of the last frame");
+    }
+    if(frame.payload[1] != status)
+    {
+        fprintf(stderr, "sim-test: frame %u: status %u instead of %u\n", sent, frame.payload[1], status);
+        exit(1);
+    }
+    spent = (double)(frame.payload[2] | frame.payload[3] << 8) * PROTOCOL_ACK_TIME_UNIT;
+    boardMicroseconds += spent;
+    if(spent > boardMaxMicroseconds)
+    {
+        boardMaxMicroseconds = spent;
+    }
+}
+
+/* sends a frame (optionally with one bit flipped) and checks the ack */
+static void request(uint8 type, const uint8 *payload, uint8 length, int flipBit, uint8 status)
+{
+    uint8 out[PROTOCOL_MAX_FRAME];
+    size_t size = Protocol_Encode(type, seq, payload, length, out);
+    double start = now();
+    double elapsed;
+
+    if(flipBit >= 0)
+    {
+        out[flipBit / 8] ^= (uint8)(1u << flipBit % 8);
+    }
+    sendRaw(out, size);
+    expectAck(seq, status);
+    //a damaged frame was not taken, so its SEQ is still the one the board expects
+    if(status != PROTOCOL_BAD_CRC)
+    {
+        ++seq;
+    }
+
+    elapsed = now() - start;
+    totalMicroseconds += elapsed;
+    if(elapsed > maxMicroseconds)
+    {
+        maxMicroseconds = elapsed;
+    }
+    ++frames;
+}
+
+static Protocol_Board snapshotOf(const Rules_Board *board)
+{
+    Protocol_Board snapshot;
+    snapshot.red = board->red;
+    snapshot.black = board->black;
+    snapshot.kings = board->kings;
+    snapshot.turn = board->turn;
+    return snapshot;
+}
+
+static uint16 mirrorHash(void)
+{
+    Protocol_Board snapshot = snapshotOf(&mirror);
+    return Protocol_BoardHash(&snapshot);
+}
+
+/* sends one hop on the hash of the mirror, which follows it if the board takes it */
+static void move(uint8 from, uint8 to, uint16 hash, int flipBit, uint8 status)
+{
+    uint8 payload[PROTOCOL_HASH_SIZE + 2];
+    payload[0] = (uint8)(hash >> 8);
+    payload[1] = (uint8)hash;
+    payload[2] = from;
+    payload[3] = to;
+    request(PROTOCOL_MSG_MOVE, payload, sizeof payload, flipBit, status);
+    if(status == PROTOCOL_OK)
+    {
+        Rules_PlayMove(&mirror, payload + PROTOCOL_HASH_SIZE, 1);
+    }
+}
+
+/* receives a snapshot; it must be the mirror's */
+static void expectBoard(const char *what)
+{
+    Protocol_Frame frame;
+    Protocol_Board snapshot;
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_BOARD_SYNC || frame.length != PROTOCOL_SYNC_SIZE
+        || !Protocol_UnpackBoard(frame.payload, &snapshot))
+    {
+        fprintf(stderr, "sim-test: %s: no board sync\n", what);
+        exit(1);
+    }
+    if(snapshot.red != mirror.red || snapshot.black != mirror.black || snapshot.kings != mirror.kings
+        || snapshot.turn != mirror.turn)
+    {
+        fprintf(stderr, "sim-test: %s: the board is not the expected one\n", what);
+        exit(1);
+    }
+}
+
+/* receives a saved game; its position must be the mirror's */
+static void expectGame(uint8 slot, uint8 mode, const uint8 *hops, uint8 count)
+{
+    Protocol_Frame frame;
+    Protocol_Board snapshot;
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_GAME || frame.length != 2u + PROTOCOL_SYNC_SIZE + 2u * count
+        || frame.payload[0] != slot || !Protocol_UnpackBoard(frame.payload + 1, &snapshot))
+    {
+        fail("LOAD was not followed by the saved game");
+    }
+    if(snapshot.red != mirror.red || snapshot.black != mirror.black || snapshot.kings != mirror.kings
+        || snapshot.turn != mirror.turn || frame.payload[1 + PROTOCOL_SYNC_SIZE] != mode
+        || memcmp(frame.payload + 2 + PROTOCOL_SYNC_SIZE, hops, 2u * count) != 0)
+    {
+        fail("the loaded game is not the one saved");
+    }
+}
+
+static void session(void)
+{
+    //c3-d4, f6-e5, d4xf6
+    static const uint8 moves[3][2] = { { 9, 13 }, { 22, 18 }, { 13, 22 } };
+    static const uint8 wrongSync[4] = { 0, 0, 0, 0 };
+    static const uint8 badLength[2] = { PROTOCOL_SOF, PROTOCOL_MAX_PAYLOAD + 1u };
+    Rules_Board saved;
+    uint8 slot;
+    int i;
+
+    request(PROTOCOL_MSG_NEW_GAME, 0, 0, -1, PROTOCOL_OK);
+    Rules_NewGame(&mirror);
+    for(i = 0; i < 3; ++i)
+    {
+        move(moves[i][0], moves[i][1], mirrorHash(), -1, PROTOCOL_OK);
+    }
+    if(mirror.red != 0x00400DFFu || mirror.black != 0xFFB00000u || mirror.turn != Black)
+    {
+        fail("the moves were not played");
+    }
+    saved = mirror;
+    slot = 1;
+    request(PROTOCOL_MSG_SAVE, &slot, 1, -1, PROTOCOL_OK);
+    request(PROTOCOL_MSG_NEW_GAME, 0, 0, -1, PROTOCOL_OK);
+
+    request(PROTOCOL_MSG_LOAD, &slot, 1, -1, PROTOCOL_OK);
+    mirror = saved;
+    expectGame(slot, 0, moves[0], 3);
+
+    //the board only takes legal moves, and answers others with its position
+    move(moves[1][0], moves[1][1], mirrorHash(), -1, PROTOCOL_ILLEGAL_MOVE);
+    expectBoard("illegal move");
+
+    //a move on a stale position (as after a lost frame) is answered with the board's
+    move(moves[1][0], moves[1][1], 0x1234u, -1, PROTOCOL_OUT_OF_SYNC);
+    expectBoard("out of sync");
+    request(PROTOCOL_MSG_BOARD_SYNC, 0, 0, -1, PROTOCOL_OK);
+    expectBoard("sync request");
+
+    slot = 3;
+    request(PROTOCOL_MSG_LOAD, &slot, 1, -1, PROTOCOL_EMPTY_SLOT);
+    move(moves[0][0], moves[0][1], mirrorHash(), 8 * 5 + 3, PROTOCOL_BAD_CRC);
+    //a bad LEN is not answered, as the frame's SEQ is unknown; the next frame gets the next ack
+    sendRaw(badLength, sizeof badLength);
+    request(0x7F, 0, 0, -1, PROTOCOL_BAD_TYPE);
+    request(PROTOCOL_MSG_BOARD_SYNC, wrongSync, sizeof wrongSync, -1, PROTOCOL_BAD_PAYLOAD);
+}
+
+static void boardMoves(void)
+{
+    //the board answers AI_MOVE with the move it played, on the hash of the position before
+    uint8 depth = 2;
+    Protocol_Frame frame;
+
+    request(PROTOCOL_MSG_NEW_GAME, 0, 0, -1, PROTOCOL_OK);
+    Rules_NewGame(&mirror);
+    request(PROTOCOL_MSG_AI_MOVE, &depth, 1, -1, PROTOCOL_OK);
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_MOVE || frame.length != PROTOCOL_HASH_SIZE + 2u
+        || ((frame.payload[0] << 8) | frame.payload[1]) != mirrorHash()
+        || !Rules_PlayMove(&mirror, frame.payload + PROTOCOL_HASH_SIZE, 1))
+    {
+        fail("AI_MOVE was not followed by an opening move");
+    }
+    depth = 0;
+    request(PROTOCOL_MSG_AI_MOVE, &depth, 1, -1, PROTOCOL_BAD_PAYLOAD);
+    //the mirror kept up with the board
+    move(21, 17, mirrorHash(), -1, PROTOCOL_OK);
+}
+
+static void encodeAt(uint8 at, uint8 type, const uint8 *payload, uint8 length)
+{
+    uint8 out[PROTOCOL_MAX_FRAME];
+    sendRaw(out, Protocol_Encode(type, at, payload, length, out));
+}
+
+static void outOfOrder(void)
+{
+    //frames that come early wait for the one before them; a repeat gets the last ack again
+    uint8 slot = 2;
+    uint8 hello;
+
+    encodeAt((uint8)(seq + 1u), PROTOCOL_MSG_SAVE, &slot, 1);
+    expectAck(seq, PROTOCOL_BAD_CRC);
+    encodeAt(seq, PROTOCOL_MSG_NEW_GAME, 0, 0);
+    expectAck(seq, PROTOCOL_OK);
+    expectAck((uint8)(seq + 1u), PROTOCOL_OK);
+    encodeAt(seq, PROTOCOL_MSG_NEW_GAME, 0, 0);
+    expectAck((uint8)(seq + 1u), PROTOCOL_OK);
+    Rules_NewGame(&mirror);
+
+    //HELLO starts over at any SEQ
+    hello = (uint8)(seq + 100u);
+    encodeAt(hello, PROTOCOL_MSG_HELLO, 0, 0);
+    expectAck(hello, PROTOCOL_OK);
+    seq = (uint8)(hello + 1u);
+}
+
+static void lostFrame(void)
+{
+    //one frame of a full window is lost: the board asks for it once, at the first frame
+    //after the gap, and then handles the whole window
+    uint8 lost;
+
+    for(lost = 0; lost < PROTOCOL_WINDOW; ++lost)
+    {
+        uint8 i;
+        for(i = 0; i < PROTOCOL_WINDOW; ++i)
+        {
+            if(i != lost)
+            {
+                encodeAt((uint8)(seq + i), PROTOCOL_MSG_NEW_GAME, 0, 0);
+            }
+            if(i < lost)
+            {
+                expectAck((uint8)(seq + i), PROTOCOL_OK);
+            }
+            if(i == lost + 1u)
+            {
+                expectAck((uint8)(seq + lost), PROTOCOL_BAD_CRC);
+            }
+        }
+        encodeAt((uint8)(seq + lost), PROTOCOL_MSG_NEW_GAME, 0, 0);
+        for(i = lost; i < PROTOCOL_WINDOW; ++i)
+        {
+            expectAck((uint8)(seq + i), PROTOCOL_OK);
+        }
+        seq = (uint8)(seq + PROTOCOL_WINDOW);
+    }
+    Rules_NewGame(&mirror);
+}
+
+static uint32 readLong(const uint8 *from)
+{
+    return from[0] | (uint32)from[1] << 8 | (uint32)from[2] << 16 | (uint32)from[3] << 24;
+}
+
+static uint32 pingBoard(uint32 clientTime)
+{
+    //returns the board's clock; the client's must come back unchanged
+    uint8 payload[4];
+    Protocol_Frame frame;
+    int i;
+
+    for(i = 0; i < 4; ++i)
+    {
+        payload[i] = (uint8)(clientTime >> (8 * i));
+    }
+    request(PROTOCOL_MSG_PING, payload, sizeof payload, -1, PROTOCOL_OK);
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_PING || frame.length != PROTOCOL_PING_SIZE || readLong(frame.payload) != clientTime)
+    {
+        fail("PING was not echoed");
+    }
+    return readLong(frame.payload + 4);
+}
+
+static void clocks(void)
+{
+    //over 50 ms the board's clock may be off this one by a round trip each side
+    double start = now();
+    uint32 first = pingBoard((uint32)start);
+    uint32 second;
+    double elapsed;
+    double drift;
+    struct timespec pause = { 0, 50000000L };
+
+    nanosleep(&pause, 0);
+    second = pingBoard((uint32)now());
+    elapsed = now() - start;
+    drift = (double)(uint32)(second - first) - 50000.0;
+    if(drift < -1000.0 || drift > elapsed - 50000.0 + 1000.0)
+    {
+        fprintf(stderr, "sim-test: the board counted %u us over 50000 us\n", (unsigned)(second - first));
+        exit(1);
+    }
+    request(PROTOCOL_MSG_PING, 0, 0, -1, PROTOCOL_BAD_PAYLOAD);
+}
+
+static void savedGames(void)
+{
+    //SAVE keeps the mode and the last hops with the position, LIST sums the slots
+    //up, and LOAD brings a game back in one frame
+    static const uint8 hops[4] = { 9, 13, 22, 18 };
+    static const uint8 save[2] = { 0, 2 };
+    static const uint8 tooLong[3] = { 0, 2, 0 };
+    Rules_Board saved;
+    Protocol_Frame frame;
+    uint8 slot = 0;
+    uint8 i;
+
+    request(PROTOCOL_MSG_NEW_GAME, 0, 0, -1, PROTOCOL_OK);
+    Rules_NewGame(&mirror);
+    move(hops[0], hops[1], mirrorHash(), -1, PROTOCOL_OK);
+    move(hops[2], hops[3], mirrorHash(), -1, PROTOCOL_OK);
+    request(PROTOCOL_MSG_SAVE, save, sizeof save, -1, PROTOCOL_OK);
+    saved = mirror;
+
+    request(PROTOCOL_MSG_LIST, 0, 0, -1, PROTOCOL_OK);
+    receive(&frame);
+    if(frame.type != PROTOCOL_MSG_LIST || frame.length % PROTOCOL_LIST_ENTRY_SIZE != 0u)
+    {
+        fail("LIST was not followed by the list");
+    }
+    for(i = 0; i < frame.length && frame.payload[i] != slot; i += PROTOCOL_LIST_ENTRY_SIZE)
+    {
+    }
+    if(i == frame.length || frame.payload[i + 1] != 2u || frame.payload[i + 2] != Red
+        || frame.payload[i + 3] != 12u || frame.payload[i + 4] != 12u)
+    {
+        fail("the list does not have the game saved");
+    }
+
+    request(PROTOCOL_MSG_NEW_GAME, 0, 0, -1, PROTOCOL_OK);
+    request(PROTOCOL_MSG_LOAD, &slot, 1, -1, PROTOCOL_OK);
+    mirror = saved;
+    expectGame(slot, 2, hops, 2);
+    move(10, 14, mirrorHash(), -1, PROTOCOL_OK);
+
+    request(PROTOCOL_MSG_SAVE, tooLong, sizeof tooLong, -1, PROTOCOL_BAD_PAYLOAD);
+    request(PROTOCOL_MSG_LIST, &slot, 1, -1, PROTOCOL_BAD_PAYLOAD);
+    slot = PROTOCOL_SLOTS;
+    request(PROTOCOL_MSG_SAVE, &slot, 1, -1, PROTOCOL_BAD_PAYLOAD);
+}
+
+/* plays random games with up to 'window' frames in flight; returns frames per second */
+static double replay(int games, uint8 window)
+{
+    Protocol_Frame frame;
+    uint8 oldest = seq;
+    long sent = 0;
+    double start = now();
+    int g;
+
+    for(g = 0; g < games; ++g)
+    {
+        int ply;
+        for(ply = 0; ply <= 80; ++ply)
+        {
+            Rules_Hop list[RULES_MAX_HOPS];
+            uint8 payload[PROTOCOL_HASH_SIZE + 2];
+            uint16 hash = mirrorHash();
+            uint8 count = Rules_LegalHops(&mirror, -1, list, RULES_MAX_HOPS);
+
+            //wait for an ack while the window is full
+            while((uint8)(seq - oldest) >= window)
+            {
+                receive(&frame);
+                if(frame.type != PROTOCOL_MSG_ACK || frame.payload[1] != PROTOCOL_OK)
+                {
+                    fail("a replayed frame was not taken");
+                }
+                oldest = (uint8)(frame.payload[0] + 1u);
+            }
+            if(ply == 0 || ply == 80 || count == 0u)
+            {
+                if(ply > 0)
+                {
+                    break;
+                }
+                encodeAt(seq++, PROTOCOL_MSG_NEW_GAME, 0, 0);
+                Rules_NewGame(&mirror);
+                ++sent;
+                continue;
+            }
+            //one hop per move: a capture chain may stop after its first jump
+            list[0] = list[(uint8)(ply * 7u) % count];
+            payload[0] = (uint8)(hash >> 8);
+            payload[1] = (uint8)hash;
+            payload[2] = list[0].from;
+            payload[3] = list[0].to;
+            encodeAt(seq++, PROTOCOL_MSG_MOVE, payload, sizeof payload);
+            Rules_PlayMove(&mirror, payload + PROTOCOL_HASH_SIZE, 1);
+            ++sent;
+        }
+    }
+    while(oldest != seq)
+    {
+        receive(&frame);
+        if(frame.type != PROTOCOL_MSG_ACK || frame.payload[1] != PROTOCOL_OK)
+        {
+            fail("a replayed frame was not taken");
+        }
+        oldest = (uint8)(frame.payload[0] + 1u);
+    }
+    return sent / ((now() - start) / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    int sessions = argc > 1 ? atoi(argv[1]) : 100;
+    uint32 baud = argc > 2 ? (uint32)strtoul(argv[2], 0, 10) : 0u;
+    int line[2];
+    pthread_t firmware;
+    double start;
+    double seconds;
+    int i;
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, line) != 0)
+    {
+        fail("socketpair failed");
+    }
+    Sim_UartAttach(line[0], baud);
+    fd = line[1];
+    Protocol_Reset(&parser);
+    pthread_create(&firmware, 0, runFirmware, 0);
+
+    //the board announces its position when it starts
+    Rules_NewGame(&mirror);
+    expectBoard("startup");
+
+    boardMoves();
+    outOfOrder();
+    lostFrame();
+    clocks();
+    savedGames();
+    frames = 0;
+    bytes = 0;
+    totalMicroseconds = 0;
+    maxMicroseconds = 0;
+    boardMicroseconds = 0;
+    boardMaxMicroseconds = 0;
+
+    start = now();
+    for(i = 0; i < sessions; ++i)
+    {
+        session();
+    }
+    seconds = (now() - start) / 1e6;
+
+    if(baud == 0u)
+    {
+        printf("%d sessions without line timing: ", sessions);
+    }
+    else
+    {
+        printf("%d sessions at %lu baud: ", sessions, (unsigned long)baud);
+    }
+    printf("%lu frames, %.0f frames/s, %.1f KB/s\n", frames, frames / seconds, bytes / seconds / 1024);
+    printf("per move: %u bytes to the board, %u back\n",
+        (unsigned)(PROTOCOL_OVERHEAD + PROTOCOL_HASH_SIZE + 2u), (unsigned)(PROTOCOL_OVERHEAD + PROTOCOL_ACK_SIZE));
+    printf("round trip: mean %.1f us, max %.1f us; RX FIFO overflows: %lu\n",
+        totalMicroseconds / frames, maxMicroseconds, (unsigned long)Sim_rxFifoOverflows);
+    printf("on the board: mean %.1f us, max %.1f us\n", boardMicroseconds / frames, boardMaxMicroseconds);
+    //the board's time is part of the round trip, so it cannot take longer
+    if(boardMicroseconds > totalMicroseconds)
+    {
+        fail("the board's time does not fit in the round trip");
+    }
+
+    if(baud != 0u)
+    {
+        //a move is 10 bytes of 10 bits, so the line carries at most baud / 100 of them a second
+        double single = replay(5, 1);
+        double windowed = replay(5, PROTOCOL_WINDOW);
+        printf("replay: %.0f frames/s stop-and-wait, %.0f frames/s with %u in flight (line limit %.0f)\n",
+            single, windowed, PROTOCOL_WINDOW, baud / 10.0 / (PROTOCOL_OVERHEAD + PROTOCOL_HASH_SIZE + 2u));
+        if(windowed < 1.5 * single)
+        {
+            fail("pipelining did not speed up the replay");
+        }
+    }
+    return Sim_rxFifoOverflows == 0u ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/*
+ * Unit tests of the saved games in flash (storage.c) on the host, on a
+ * flash image in a temporary file.
+ *
+ *   storage-test [saves]
+ *
+ * The firmware is restarted by attaching the image again and scanning it,
+ * as after a reset of the chip.
+ */
+
+#include "storage.h"
+#include "flash_sim.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRST_ROW (CY_FLASH_NUMBER_ROWS - STORAGE_ROWS)
+
+static char path[] = "/tmp/storage-test-XXXXXX";
+
+static Storage_Game gameAfter(uint8 hops)
+{
+    //the start position, with a history of 'hops' made-up hops
+    Storage_Game game;
+    uint8 i;
+    memset(&game, 0, sizeof game);
+    game.board.red = 0x00000FFFu;
+    game.board.black = 0xFFF00000u;
+    game.board.turn = hops % 2u == 0u ? 'r' : 'b';
+    game.mode = (uint8)(hops % 3u + 1u);
+    game.hopCount = hops < PROTOCOL_GAME_HOPS ? hops : PROTOCOL_GAME_HOPS;
+    for(i = 0; i < 2u * game.hopCount; ++i)
+    {
+        game.hops[i] = (uint8)((hops + i) % 32u);
+    }
+    return game;
+}
+
+static int sameGame(const Storage_Game *a, const Storage_Game *b)
+{
+    return a->board.red == b->board.red && a->board.black == b->board.black && a->board.kings == b->board.kings
+        && a->board.turn == b->board.turn && a->mode == b->mode && a->hopCount == b->hopCount
+        && memcmp(a->hops, b->hops, 2u * a->hopCount) == 0;
+}
+
+static void restart(void)
+{
+    assert(Sim_FlashAttach(path));
+    Storage_Start();
+}
+
+static void savesAndLoads(void)
+{
+    Storage_Game game = gameAfter(5);
+    Storage_Game loaded;
+    uint8 slot;
+
+    restart();
+    for(slot = 0; slot < PROTOCOL_SLOTS; ++slot)
+    {
+        assert(!Storage_Load(slot, &loaded));
+    }
+    assert(Storage_Save(2, &game));
+    assert(Storage_Load(2, &loaded) && sameGame(&game, &loaded));
+    assert(!Storage_Load(1, &loaded));
+
+    //a full history, and a later save of the same slot wins
+    game = gameAfter(40);
+    assert(Storage_Save(2, &game));
+    assert(Storage_Load(2, &loaded) && sameGame(&game, &loaded));
+
+    //the games outlive a reset
+    restart();
+    assert(Storage_Load(2, &loaded) && sameGame(&game, &loaded));
+    assert(!Storage_Load(0, &loaded));
+}
+
+static void tornWrites(void)
+{
+    //a save cut short is reported and leaves the slot's last game, also after a reset
+    Storage_Game kept = gameAfter(7);
+    Storage_Game torn = gameAfter(8);
+    Storage_Game loaded;
+
+    assert(Storage_Save(1, &kept));
+    Sim_FlashTearWrites(1);
+    assert(!Storage_Save(1, &torn));
+    assert(Storage_Load(1, &loaded) && sameGame(&kept, &loaded));
+    restart();
+    assert(Storage_Load(1, &loaded) && sameGame(&kept, &loaded));
+    assert(Storage_Save(1, &torn));
+    assert(Storage_Load(1, &loaded) && sameGame(&torn, &loaded));
+}
+
+static void spreadsWear(uint32 saves)
+{
+    //one slot saved over and over, with resets now and then: the writes go round every
+    //row that holds no slot's latest game, and the games of the other slots stay
+    Storage_Game other;
+    Storage_Game loaded;
+    uint32 before[STORAGE_ROWS];
+    uint32 most = 0;
+    uint32 i;
+
+    assert(Storage_Load(2, &other));
+    for(i = 0; i < STORAGE_ROWS; ++i)
+    {
+        before[i] = Sim_flashRowWrites[FIRST_ROW + i];
+    }
+    for(i = 0; i < saves; ++i)
+    {
+        Storage_Game game = gameAfter((uint8)i);
+        assert(Storage_Save(0, &game));
+        if(i % 97u == 0u)
+        {
+            restart();
+        }
+    }
+    for(i = 0; i < STORAGE_ROWS; ++i)
+    {
+        uint32 writes = Sim_flashRowWrites[FIRST_ROW + i] - before[i];
+        most = writes > most ? writes : most;
+    }
+    printf("storage: %lu saves of one slot, at most %lu writes to a row of %u\n",
+        (unsigned long)saves, (unsigned long)most, STORAGE_ROWS);
+    //slots 1 and 2 hold two rows; the other rows share the writes evenly
+    assert(most <= saves / (STORAGE_ROWS - 2u) + 1u);
+    assert(Storage_Load(2, &loaded) && sameGame(&other, &loaded));
+    for(i = 0; i < FIRST_ROW; ++i)
+    {
+        assert(Sim_flashRowWrites[i] == 0u);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32 saves = argc > 1 ? (uint32)strtoul(argv[1], 0, 10) : 6000u;
+    int fd = mkstemp(path);
+
+    assert(fd >= 0);
+    close(fd);
+    savesAndLoads();
+    tornWrites();
+    spreadsWear(saves);
+    remove(path);
+    printf("storage: All test cases passed!\n");
+    return 0;
+}
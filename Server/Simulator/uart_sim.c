@@ -0,0 +1,375 @@
+#include "uart_sim.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * The hardware FIFOs are 8 bytes deep, as on the chip. One thread moves
+ * bytes from the file descriptor into the RX FIFO and another moves them from
+ * the TX FIFO out, each waiting a byte time per byte when a baud rate is set.
+ * Whenever a FIFO changes, the interrupt handler runs on that thread with
+ * irqLock held. A critical section of the firmware takes the same lock, so it
+ * holds the interrupt off like PRIMASK does, and sleeping waits for the next
+ * interrupt like WFI does. The SysTick interrupt runs the same way on a thread
+ * of its own.
+ */
+
+volatile uint32 Sim_rxFifoOverflows = 0;
+
+//recursive, as the interrupt handlers call back into the functions that take it
+static pthread_mutex_t irqLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_cond_t interrupted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t txFilled = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t txDrained = PTHREAD_COND_INITIALIZER;
+
+static int lineFd = -1;
+static long byteNanoseconds = 0;
+static int interruptsEnabled = 0;
+static cyisraddress handler = 0;
+static uint32 rxMask = UART_NO_INTR_SOURCES;
+static uint32 txMask = UART_NO_INTR_SOURCES;
+
+#define SYSTICK_RELOAD 47999u
+
+static cySysTickCallback tickCallback = 0;
+static struct timespec lastTick;
+
+static uint8 rxFifo[UART_FIFO_SIZE];
+static uint32 rxStart = 0;
+static uint32 rxCount = 0;
+static uint8 txFifo[UART_FIFO_SIZE];
+static uint32 txStart = 0;
+static uint32 txCount = 0;
+
+static uint32 rxSources(void)
+{
+    return rxCount > 0u ? UART_INTR_RX_NOT_EMPTY : 0u;
+}
+
+static uint32 txSources(void)
+{
+    return txCount < UART_FIFO_SIZE ? UART_INTR_TX_NOT_FULL : 0u;
+}
+
+static void raiseInterrupt(void)
+{
+    pthread_mutex_lock(&irqLock);
+    if(interruptsEnabled && handler != 0 && ((rxSources() & rxMask) != 0u || (txSources() & txMask) != 0u))
+    {
+        handler();
+    }
+    pthread_cond_broadcast(&interrupted);
+    pthread_mutex_unlock(&irqLock);
+}
+
+static void waitByteTime(struct timespec *next)
+{
+    struct timespec now;
+
+    if(byteNanoseconds == 0)
+    {
+        return;
+    }
+    //an idle line does not bank time for later bytes, but a busy one keeps
+    //its pace when a sleep overshoots
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if((now.tv_sec - next->tv_sec) * 1000000000L + (now.tv_nsec - next->tv_nsec) > byteNanoseconds)
+    {
+        *next = now;
+    }
+    next->tv_nsec += byteNanoseconds;
+    while(next->tv_nsec >= 1000000000L)
+    {
+        next->tv_nsec -= 1000000000L;
+        ++next->tv_sec;
+    }
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, next, 0) == EINTR)
+    {
+    }
+}
+
+static void *receiveLine(void *unused)
+{
+    struct timespec next = { 0, 0 };
+    uint8 buf[256];
+    (void)unused;
+
+    for(;;)
+    {
+        ssize_t i;
+        ssize_t n = read(lineFd, buf, sizeof buf);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            exit(0);  //the client went away
+        }
+        for(i = 0; i < n; ++i)
+        {
+            waitByteTime(&next);
+            pthread_mutex_lock(&irqLock);
+            if(rxCount == UART_FIFO_SIZE)
+            {
+                ++Sim_rxFifoOverflows;
+            }
+            else
+            {
+                rxFifo[(rxStart + rxCount) % UART_FIFO_SIZE] = buf[i];
+                ++rxCount;
+            }
+            pthread_mutex_unlock(&irqLock);
+            raiseInterrupt();
+        }
+    }
+    return 0;
+}
+
+static void *transmitLine(void *unused)
+{
+    struct timespec next = { 0, 0 };
+    uint8 buf[UART_FIFO_SIZE];
+    (void)unused;
+
+    for(;;)
+    {
+        uint32 i;
+        uint32 n = 0;
+
+        pthread_mutex_lock(&irqLock);
+        while(txCount == 0u)
+        {
+            pthread_cond_wait(&txFilled, &irqLock);
+        }
+        //with timing, the FIFO gives up one byte per byte time
+        while(txCount > 0u && (n == 0u || byteNanoseconds == 0))
+        {
+            buf[n++] = txFifo[txStart];
+            txStart = (txStart + 1u) % UART_FIFO_SIZE;
+            --txCount;
+        }
+        pthread_cond_broadcast(&txDrained);
+        pthread_mutex_unlock(&irqLock);
+        raiseInterrupt();
+
+        waitByteTime(&next);
+        for(i = 0; i < n; )
+        {
+            ssize_t written = write(lineFd, buf + i, n - i);
+            if(written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(written <= 0)
+            {
+                exit(0);
+            }
+            i += (uint32)written;
+        }
+    }
+    return 0;
+}
+
+static void *countTicks(void *unused)
+{
+    struct timespec next;
+    (void)unused;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for(;;)
+    {
+        next.tv_nsec += 1000000L;
+        if(next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            ++next.tv_sec;
+        }
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0) == EINTR)
+        {
+        }
+        pthread_mutex_lock(&irqLock);
+        //the counter restarts when the interrupt is taken, so time never runs backwards
+        clock_gettime(CLOCK_MONOTONIC, &lastTick);
+        if(interruptsEnabled && tickCallback != 0)
+        {
+            tickCallback();
+        }
+        pthread_cond_broadcast(&interrupted);
+        pthread_mutex_unlock(&irqLock);
+    }
+    return 0;
+}
+
+void CySysTickStart(void)
+{
+    pthread_t thread;
+    clock_gettime(CLOCK_MONOTONIC, &lastTick);
+    pthread_create(&thread, 0, countTicks, 0);
+    pthread_detach(thread);
+}
+
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function)
+{
+    cySysTickCallback previous = tickCallback;
+    (void)number;
+    tickCallback = function;
+    return previous;
+}
+
+uint32 CySysTickGetValue(void)
+{
+    struct timespec now;
+    long elapsed;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&irqLock);
+    elapsed = (now.tv_sec - lastTick.tv_sec) * 1000000000L + (now.tv_nsec - lastTick.tv_nsec);
+    pthread_mutex_unlock(&irqLock);
+    //a late interrupt leaves the counter at zero
+    if(elapsed >= 1000000L)
+    {
+        return 0;
+    }
+    return SYSTICK_RELOAD - (uint32)(elapsed * (SYSTICK_RELOAD + 1u) / 1000000L);
+}
+
+uint32 CySysTickGetReload(void)
+{
+    return SYSTICK_RELOAD;
+}
+
+void Sim_UartAttach(int fd, uint32 baud)
+{
+    lineFd = fd;
+    byteNanoseconds = baud == 0u ? 0 : (long)(10 * 1000000000LL / baud);
+}
+
+void Sim_EnableInterrupts(void)
+{
+    pthread_mutex_lock(&irqLock);
+    interruptsEnabled = 1;
+    pthread_mutex_unlock(&irqLock);
+    raiseInterrupt();
+}
+
+uint8 CyEnterCriticalSection(void)
+{
+    pthread_mutex_lock(&irqLock);
+    return 0;
+}
+
+void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    (void)savedIntrStatus;
+    pthread_mutex_unlock(&irqLock);
+}
+
+void CySysPmSleep(void)
+{
+    //called inside a critical section, so the lock is held once
+    pthread_cond_wait(&interrupted, &irqLock);
+}
+
+void UART_Start(void)
+{
+    pthread_t thread;
+
+    if(lineFd < 0)
+    {
+        fprintf(stderr, "UART_Start: no line attached\n");
+        exit(1);
+    }
+    pthread_create(&thread, 0, receiveLine, 0);
+    pthread_detach(thread);
+    pthread_create(&thread, 0, transmitLine, 0);
+    pthread_detach(thread);
+}
+
+void UART_SetCustomInterruptHandler(cyisraddress func)
+{
+    pthread_mutex_lock(&irqLock);
+    handler = func;
+    pthread_mutex_unlock(&irqLock);
+}
+
+void UART_SetRxInterruptMode(uint32 interruptMask)
+{
+    pthread_mutex_lock(&irqLock);
+    rxMask = interruptMask;
+    pthread_mutex_unlock(&irqLock);
+    raiseInterrupt();
+}
+
+void UART_SetTxInterruptMode(uint32 interruptMask)
+{
+    pthread_mutex_lock(&irqLock);
+    txMask = interruptMask;
+    pthread_mutex_unlock(&irqLock);
+    if(interruptMask != UART_NO_INTR_SOURCES)
+    {
+        raiseInterrupt();
+    }
+}
+
+uint32 UART_GetRxInterruptSourceMasked(void)
+{
+    return rxSources() & rxMask;
+}
+
+uint32 UART_GetTxInterruptSource(void)
+{
+    return txSources();
+}
+
+uint32 UART_GetTxInterruptSourceMasked(void)
+{
+    return txSources() & txMask;
+}
+
+void UART_ClearRxInterruptSource(uint32 interruptMask)
+{
+    //the sources are levels, as on the chip: they stay set while their condition holds
+    (void)interruptMask;
+}
+
+void UART_ClearTxInterruptSource(uint32 interruptMask)
+{
+    (void)interruptMask;
+}
+
+uint32 UART_SpiUartGetRxBufferSize(void)
+{
+    return rxCount;
+}
+
+uint32 UART_SpiUartReadRxData(void)
+{
+    uint8 byte = 0;
+
+    pthread_mutex_lock(&irqLock);
+    if(rxCount > 0u)
+    {
+        byte = rxFifo[rxStart];
+        rxStart = (rxStart + 1u) % UART_FIFO_SIZE;
+        --rxCount;
+    }
+    pthread_mutex_unlock(&irqLock);
+    return byte;
+}
+
+void UART_SpiUartWriteTxData(uint32 txData)
+{
+    pthread_mutex_lock(&irqLock);
+    while(txCount == UART_FIFO_SIZE)
+    {
+        pthread_cond_wait(&txDrained, &irqLock);
+    }
+    txFifo[(txStart + txCount) % UART_FIFO_SIZE] = (uint8)txData;
+    ++txCount;
+    pthread_cond_signal(&txFilled);
+    pthread_mutex_unlock(&irqLock);
+}
@@ -0,0 +1,22 @@
+#ifndef UART_SIM_H
+#define UART_SIM_H
+
+/*
+ * Simulator-only controls of the simulated UART (see project.h).
+ */
+
+#include "project.h"
+
+/* Connects the UART to a file descriptor. With a baud rate, every byte takes
+   10 bit times (8N1) on the line in each direction; 0 disables the timing.
+   Must be called before the firmware starts. The process exits when the
+   other end closes. */
+void Sim_UartAttach(int fd, uint32 baud);
+
+/* Bytes lost because the 8-byte hardware RX FIFO was full. */
+extern volatile uint32 Sim_rxFifoOverflows;
+
+/* The firmware's main(), renamed when main.c is built for the host. */
+int Firmware_Main(void);
+
+#endif